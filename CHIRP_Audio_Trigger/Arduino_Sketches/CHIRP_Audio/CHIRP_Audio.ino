@@ -7,19 +7,20 @@
  * - Supports new CHIRP serial commands and legacy MP3 Trigger commands
  * - Multiple MP3 and AAC Decoders (Helix) running on Core 0
  * - Ring Buffers in PSRAM (default 512KB per stream) for glitch-free playback
- * - MP3 and AAC decoders also in PSRAM (~25KB per MP3 decoder and ~70KB per AAC decoder)
+ * - MP3 and AAC decoders share one PSRAM pool (~25KB per MP3 decoder and ~70KB per AAC decoder)
  * - Automatic mixing on Core 1
  * - Dynamic resource allocation for decoders
  * - Robust WAV/MP3/AAC file handling with auto-stop
  * - Sound file manifest handling (so your droid knows what sounds are available)
  *
  * File Format Notes:
- * The system expects sound files to have a 44.1 kHz sample rate (CD quality).
- * Most files you come across will be at this rate, but 48 kHz files have become more
- * common of late. I recommend resampling any 48 kHz files prior to trying to play them
- * with the CHIRP Audio Trigger. It will play 48kHz, but then will be slowed ~92% and not
- * sound good.
+ * The output runs at 44.1 kHz (CD quality). Files at other rates (8 kHz - 48 kHz, e.g.
+ * 22.05 kHz or 48 kHz) are converted on the fly by a per-stream resampler on Core 1, so
+ * they no longer need to be resampled beforehand. 44.1 kHz files skip the resampler and
+ * are the cheapest to play. See #RESAMPLER in CHIRP.INI for the quality setting.
  * To keep filesizes down, it's recommended to use mono WAV files. Stereo MP3's are fine.
+ * Mono and 22.05 kHz sources are buffered in their native format (the mixer upmixes them),
+ * so a stream buffer holds 2-4x more playback time for them than for 44.1 kHz stereo.
  * AAC files should be raw .aac files or AAC-LC in an .m4a or .mp4 containers.
  *
  * SD Card Structure for Droid Use:
@@ -38,8 +39,12 @@
  *   SD:/1A_R2D2/disagree.wav
  *   SD:/1A_R2D2/happy_01.wav
  *   SD:/1A_R2D2/happy_02.wav
- * Sound Bank 1 files can be synced from the SD card to flash memory at startup, allowing
+ * Sound Bank 1 files can be synced from the SD card to flash memory, allowing
  * these sounds to always be available with minimal system overhead needed.
+ * Only files whose size or modify time changed since the last sync are copied again.
+ * The copying runs in the background after boot, in the gaps between sounds, so the
+ * droid is usable right away: each sound plays from the SD card until its flash copy
+ * is done. SYNC reports the progress.
  * Different pages of sounds are defined by the letter in the folder name following the
  * Sound Bank number. File names should be kept short as possible while keeping them
  * identifiable to the user. For example...
@@ -53,15 +58,37 @@
  *   SD:/3A_Effects/servo02.mp3
  * 
  * CHIRP Serial Commands:
- * PLAY : play a sound
- * STOP : stop a stream or all streams
+ * Arguments are comma-separated; an empty one keeps its default and the ones after it still count
+ * (PLAY:3,,,80 plays Bank 1, Page A at volume 80).
+ * PLAY : play a sound (optional 5th argument: start offset in ms, e.g. PLAY:3,2,A,80,90000;
+ *        optional 6th: priority class E/V/M, e.g. PLAY:3,2,A,80,,M). Replies ERR:BUSY when every
+ *        stream plays something of a higher class (see #BANK_CLASSES)
+ * QUEUE: play a sound after the one on a stream, gapless or with an equal-power crossfade
+ *        (QUEUE:stream,index,bank,page,fadeMs,loop - starts at once on an idle stream, loop=1 repeats it)
+ * STOP : stop a stream or all streams (and clears what was queued on it). Optional fade-out in ms
+ *        (STOP:0,500 or STOP:*,500), the stream stops once it has faded to silence
+ * SEEK : jump a playing stream to a position in ms (SEEK:stream,ms)
+ * FX   : filter and speed of what a stream plays (FX:stream,filter,speed - filter N/H/R as in
+ *        #BANK_FILTERS, speed 50-200 percent moves pitch and tempo together, e.g. FX:1,R,120)
  * VOL  : set volume from 0 (silent) to 99 (max)
- * CHRP : play a basic sound chirp
+ * CHRP : play a basic sound chirp (CHRP:StartHz,EndHz,DurationMs,Volume), a one-note SYN
+ * SYN  : play a synthesized sequence, notes back to back (SYN:patch,startHz,endHz,ms,vol;... -
+ *        a step "-,ms" is a rest, a "+" in front of a note plays it together with the one before
+ *        (chords), e.g. SYN:1,2400,,60;-,30;2,1800,3200,120;+3,900,,120). Several sequences can
+ *        play at once, then ERR:BUSY. SYN: on its own stops all synth notes
+ * SYNA : add steps to the next SYN, for sequences longer than one command line
+ * SYNP : set up synth patch 0-7 (SYNP:slot,wave,attackMs,decayMs,sustain%,releaseMs,mod,ratio%,depth -
+ *        wave S(ine)/T(riangle)/Q (square)/W (saw)/N(oise), mod N(one)/F(M)/R(ing) by a sine at ratio%
+ *        of the note, depth = FM index x100 or ring mix %). Defaults: 0 beep, 1 blip, 2 warble,
+ *        3 chatter, 4 raspberry, 5 buzz, 6 whistle, 7 ping. Patches reset at boot
  * GMAN : Get Manifest of sound banks
  * LIST : Get a list of Sound Banks and Pages
  * GNME : Get Name of a sound in a provided sound bank and page
- * STAT : display the Status of each stream
- * MUSB : MSC USB mode (SD card contents will be accessible via USB)
+ * STAT : display the Status of each stream (includes the playback position in ms, for resuming)
+ * SYNC : Bank 1 flash sync progress (SYNC:RUNNING|DONE|OFF,variantsOnFlash,variants)
+ * PERF : report profiling counters (mixer load, SD/flash read and decode latency, buffer low-water marks, underruns); PERF:RESET clears them
+ * MUSB : MSC USB mode (SD card contents will be accessible via USB). SD streams stop, flash and RAM
+ *        Bank 1 sounds and serial control keep working while files are copied
  *
  * Legacy MP3 Trigger Serial Commands:
  * T : Trigger by sound file number (ASCII)
@@ -74,11 +101,19 @@
  *
  * PSRAM Note:
  * The system can be configured for more streams and larger buffers than PSRAM will allow, so be conservative.
- * Each stream will require a big chunk of PSRAM for its buffer, a little for an MP3 decoder and a little more for an AAC decoder.
- * The RevA CHIRP Audio Trigger board has only 2MB of PSRAM; this will allow 3 streams with 512KB buffers 3*(512+25+70)
+ * Each stream will require a big chunk of PSRAM for its buffer, plus a 16KB staging buffer for large SD reads and ~12KB of
+ * M4A sample tables (allocated the first time the stream plays an M4A). Decoders come out of the shared #DECODER_POOL_KB pool,
+ * which by default holds one AAC decoder (~70KB) per stream.
+ * The RevA CHIRP Audio Trigger board has only 2MB of PSRAM; this will allow 3 streams with 512KB buffers 3*(512+70+16+12)
  * The RevB board has 8MB of PSRAM, which will allow up to 13 streams with 512KB buffers (more than the CPU can handle)
+ * Bank filenames take another 80KB (a 64KB name pool plus a table for up to 4096 files).
  * If you're playing around with lots of streams, be sure to reduce your buffer size to accomodate the PSRAM your board has.
  * 
+ * CHIRP.IDX:
+ * The firmware caches the file lists of the bank folders in CHIRP.IDX (SD card root) and only rescans
+ * folders whose files were added, deleted, renamed or changed since the last boot (this works
+ * after editing the card in a card reader too). Delete it to force a full rescan.
+ * 
  * CHIRP.INI:
  * The CHIRP.INI file allows you to configure various aspects of the CHIRP Audio Trigger firmware.
  * It is stored in the root of the SD card.
@@ -88,12 +123,46 @@
  *   Sets the baud rate for the serial control interface.
  * #USE_FLASH_BANK1 [0 or 1, Default: 1]
  *   Enables/disables use of onboard flash memory for Bank 1 sounds. Setting to 0 may save startup time if not needed.
+ * #BANK1_ADPCM [0 or 1, Default: 0]
+ *   1 = Store Bank 1 WAVs (16-bit) in flash as 4:1 IMA-ADPCM WAVs, encoded during the boot sync, so about four
+ *   times as many variants fit. Costs some fidelity (fine for droid vocals) and a little Core 0 decode time.
+ *   Changing it re-syncs the Bank 1 WAVs.
  * #LEGACY_MONOPHONIC [0 or 1, Default: 1]
  *   Controls behavior of the legacy T command. 0 = Polyphonic (sounds mix). 1 = Monophonic (stop & play).
  * #MAX_STREAMS [1-10, Default: 3]
  *   Maximum number of simultaneous audio streams. Increasing this uses more RAM/CPU.
  * #STREAM_BUFFER_SIZE [SMALL, MEDIUM, LARGE or custom number. Default: LARGE (512KB)]
  *   Size of the audio buffer per stream. Use MEDIUM or LARGE for high-bitrate files if you experience stuttering.
+ * #RESAMPLER [LINEAR or POLYPHASE, Default: LINEAR]
+ *   Sample rate conversion for files that aren't 44.1 kHz. POLYPHASE (8-tap filter) sounds cleaner
+ *   but costs ~4x the Core 1 time of LINEAR per resampled stream.
+ * #BANK1_RAM [0 or 1, Default: 0]
+ *   1 = Load the whole active Bank 1 page into PSRAM at boot (converted to 44.1 kHz), so Bank 1 sounds play
+ *   straight from memory without touching flash or SD. Meant for the 8MB RevB board; falls back to normal
+ *   streaming if the page doesn't fit. Replaces the warm cache when active.
+ * #WARM_CACHE_KB [0-4096, Default: 128]
+ *   PSRAM kept for the first ~100ms of Bank 1 WAV sounds, so triggers start without waiting on the file
+ *   (about 17KB per cached variant, least recently played ones are dropped when full). 0 disables it.
+ *   On the 2MB RevA board with 3 LARGE streams, lower this if the startup log reports an allocation failure.
+ * #DECODER_POOL_KB [0-2048, Default: 0 (one AAC decoder per stream)]
+ *   PSRAM shared by the MP3 and AAC decoders. Decoders are created the first time a stream needs one and
+ *   reused by later streams; idle ones of the other kind are dropped to make room. A stream whose decoder
+ *   doesn't fit isn't played, so keep room for as many compressed streams as you play at once.
+ * #BANK_CLASSES [7 comma separated letters: SD root, then Banks 1-6. Default: M,V,E,E,E,E,E]
+ *   Priority class a bank's sounds play with unless PLAY gives one: E = effects, V = vocals, M = music
+ *   (lowest to highest). When all streams are busy, a new sound fades out and takes the lowest-class
+ *   stream of its own class or below, the oldest one first; if there is none it isn't played.
+ * #BANK_RESERVE [7 comma separated counts: SD root, then Banks 1-6. Default: 0,0,0,0,0,0,0]
+ *   Streams kept free for a bank: other banks don't use them, and a bank below its count may take
+ *   any stream regardless of class (e.g. 0,1,0,0,0,0,0 so droid vocals always get a stream).
+ * #BANK_FILTERS [7 comma separated letters: SD root, then Banks 1-6. Default: N,N,N,N,N,N,N]
+ *   Filter a bank's sounds play through: N = none, H = small-speaker high-pass (250 Hz),
+ *   R = droid radio band-pass (1.8 kHz). Each filtered stream costs Core 1 time (see PERF:FX).
+ * #LIMITER [0 or 1, Default: 0]
+ *   1 = Look-ahead limiter on the mix instead of hard clipping when several loud sounds overlap.
+ *   Cheap, but check PERF:MIX headroom with many streams.
+ * #LIMITER_DRIVE_DB [0-12, Default: 0]
+ *   Gain into the limiter, for more loudness on small speakers (only with #LIMITER 1).
  * 
  */
 
@@ -112,14 +181,14 @@ void calculateGlobalChecksum() {
     // 1. Checksum Bank 1 (Flash) variant filenames
     for (int i = 0; i < bank1SoundCount; i++) {
         for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-            crc.update(bank1Sounds[i].variants[v], strlen(bank1Sounds[i].variants[v]));
+            crc.update(bank1Variant(bank1Sounds[i], v), strlen(bank1Variant(bank1Sounds[i], v)));
         }
     }
 
     // 2. Checksum Banks 2-6 (SD) filenames
     for (int i = 0; i < sdBankCount; i++) {
         for (int f = 0; f < sdBanks[i].fileCount; f++) {
-            crc.update(sdBanks[i].files[f], strlen(sdBanks[i].files[f]));
+            crc.update(sdBankFile(&sdBanks[i], f), strlen(sdBankFile(&sdBanks[i], f)));
         }
     }
 
@@ -130,19 +199,6 @@ void calculateGlobalChecksum() {
 // ===================================
 // SETUP (Core 0)
 // ===================================
-#ifdef DEBUG
-// Performance Stats (from audio_playback.cpp)
-extern volatile uint32_t totalSdReadTime;
-extern volatile uint32_t maxSdReadTime;
-extern volatile uint32_t sdReadCount;
-
-extern volatile uint32_t totalDecodeTime;
-extern volatile uint32_t maxDecodeTime;
-extern volatile uint32_t decodeCount;
-
-extern volatile uint32_t bufferUnderrunCount;
-#endif
-
 void setup() {
     // 1. Safe State for SD Card (Deselect)
     pinMode(SD_CS, OUTPUT);
@@ -180,18 +236,6 @@ void setup() {
 
 
 
-#ifdef DEBUG
-// Performance Stats (from audio_playback.cpp)
-extern volatile uint32_t totalSdReadTime;
-extern volatile uint32_t maxSdReadTime;
-extern volatile uint32_t sdReadCount;
-
-extern volatile uint32_t totalDecodeTime;
-extern volatile uint32_t maxDecodeTime;
-extern volatile uint32_t decodeCount;
-
-extern volatile uint32_t bufferUnderrunCount;
-#endif
     
     // Buttons
     pinMode(PIN_BTN_NAV, INPUT_PULLUP);
@@ -262,50 +306,28 @@ extern volatile uint32_t bufferUnderrunCount;
     // Initialize Audio System
     initAudioSystem(); // Uses maxStreams set by parseIniFile
 
-    // Allocate MP3 decoders in PSRAM (Dynamic)
-    Serial.print("Allocating MP3 decoders in PSRAM... ");
-    for (int i = 0; i < maxMp3Decoders; i++) {
-        mp3Decoders[i] = new (pmalloc(sizeof(MP3DecoderHelix))) MP3DecoderHelix(mp3DataCallback);
-        if (!mp3Decoders[i]) {
-            Serial.printf("Decoder %d FAILED! ", i);
-        } else {
-            Serial.printf("Decoder %d OK. ", i);
-        }
-    }
-    Serial.println();
-
-    // Allocate AAC decoders in PSRAM (Dynamic)
-    Serial.print("Allocating AAC decoders in PSRAM... ");
-    for (int i = 0; i < maxMp3Decoders; i++) {
-        // Small delay to prevent rush/power spikes
-        delay(10); 
-        aacDecoders[i] = new (pmalloc(sizeof(AACDecoderHelix))) AACDecoderHelix(aacDataCallback);
-        if (!aacDecoders[i]) {
-            Serial.printf("AAC Decoder %d FAILED! ", i);
-        } else {
-            Serial.printf("AAC Decoder %d OK. ", i);
-        }
-    }
-    Serial.println();
     delay(50); // Settlement delay
 
 
-    // Scan for Valid Bank 1 Pages
-    Serial.println("\n=== Scanning Valid Bank 1 Pages ===");
-    scanValidBank1Pages();
-                  
-    // Scan Bank 1 on SD
-    Serial.println("\n=== Scanning Bank 1 (SD Card) ===");
-    scanBank1();
+    // Scan the SD card (all banks in one pass, cached in SD_INDEX_PATH)
+    Serial.println("\n=== Scanning SD Card ===");
+    scanSDCard();
     Serial.printf("Found %d sounds in Bank 1\n", bank1SoundCount);
     
     // Play Firmware Update Feedback
     playFirmwareUpdateFeedback(fwUpdated);
 
-    // Sync Bank 1 to Flash
+    // Sync Bank 1 to Flash (only the diff here, the copying runs from loop())
     Serial.println("\n=== Syncing Bank 1 to Flash ===");
-    if (!syncBank1ToFlash()) {
-        Serial.println("WARNING: Bank 1 sync incomplete");
+    if (!beginBank1Sync()) {
+        Serial.println("WARNING: Bank 1 plays from the SD card");
+    }
+
+    // Load Bank 1 into PSRAM (#BANK1_RAM), else pre-buffer its heads
+    // (from flash for the variants already synced, the SD card for the rest)
+    Serial.println("\n=== Warming Bank 1 Cache ===");
+    if (!initBank1Ram()) {
+        initWarmCache();
     }
     
     // Re-check flash usage
@@ -315,9 +337,8 @@ extern volatile uint32_t bufferUnderrunCount;
                   fsInfo.totalBytes / 1024,
                   (fsInfo.usedBytes * 100.0) / fsInfo.totalBytes);
 
-    // Scan SD banks (2-6)
-    Serial.println("\n=== Scanning Banks 2-6 (SD Card) ===");
-    scanSDBanks();
+    // SD banks (2-6), found by scanSDCard()
+    Serial.println("\n=== Banks 2-6 (SD Card) ===");
     Serial.printf("Found %d bank directories\n", sdBankCount);
     
     for (int i = 0; i < sdBankCount; i++) {
@@ -335,21 +356,20 @@ extern volatile uint32_t bufferUnderrunCount;
     // 1. Checksum Bank 1 (Flash) variant filenames
     for (int i = 0; i < bank1SoundCount; i++) {
         for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-            crc.update(bank1Sounds[i].variants[v], strlen(bank1Sounds[i].variants[v]));
+            crc.update(bank1Variant(bank1Sounds[i], v), strlen(bank1Variant(bank1Sounds[i], v)));
         }
     }
     // 2. Checksum Banks 2-6 (SD) filenames
     for (int i = 0; i < sdBankCount; i++) {
         for (int f = 0; f < sdBanks[i].fileCount; f++) {
-            crc.update(sdBanks[i].files[f], strlen(sdBanks[i].files[f]));
+            crc.update(sdBankFile(&sdBanks[i], f), strlen(sdBankFile(&sdBanks[i], f)));
         }
     }
     globalFilenameChecksum = crc.finalize();
     Serial.println(globalFilenameChecksum);
     
-    // Scan Root Tracks for Legacy Compatibility
-    Serial.println("\n=== Scanning Root Tracks (Legacy) ===");
-    scanRootTracks();
+    // Root Tracks for Legacy Compatibility
+    Serial.printf("Found %d root tracks for legacy compatibility.\n", rootTrackCount);
     
     // Enable Audio Output (Unmute)
     g_allowAudio = true;
@@ -361,10 +381,13 @@ extern volatile uint32_t bufferUnderrunCount;
     Serial.println("  PLAY:1,2,B,80  Play Bank 2, Page B, Sound 1, Vol 80");
     Serial.println("  STOP:0           Stop stream 0");
     Serial.println("  STOP:* Stop all streams");
+    Serial.println("  STOP:0,500       Fade stream 0 out over 500ms, then stop");
     Serial.println("  VOL:1,50         Set stream 1 volume to 50");
     Serial.println("  LIST             List all banks");
     Serial.println("  CHRP:500,100,500,50"); //CHRP:StartHz,EndHz,DurationMs,Volume
+    Serial.println("  SYN:1,2400,,60;-,30;2,1800,3200,120  Synth beeps (patch,startHz,endHz,ms,vol;...)");
     Serial.println("  CCRC             Clear sounds from flash ram"); //CHRP:StartHz,EndHz,DurationMs,Volume
+    Serial.println("  SYNC             Bank 1 flash sync progress");
 
     Serial.println();
     
@@ -390,7 +413,7 @@ void loop() {
     updateRuntimeLEDs();
     
     // Try to send queued Serial2 messages (up to 5 per loop iteration)
-    // Only sends when CPU is not busy with MP3 decoding
+    // Only sends when no stream is close to running dry
     trySendQueuedMessages(5);
     
     // --- Button Handling ---
@@ -500,37 +523,31 @@ void loop() {
         lastRevState = revState;
     }
     
+    // --- Voice Feedback ---
+    // Starts / appends the next queued prompt clip
+    serviceVoice();
+    
     // --- Main Audio Task ---
     // Reads from files and fills ring buffers for all active streams
     fillStreamBuffers();
     
+    // Load the PCM head of the last Bank 1 sound that missed the warm cache
+    serviceWarmCache();
+    
+    // MSC mode: the USB host's next slice of SD card time
+    serviceMSC();
+    
+    // Copy the next piece of Bank 1 to flash (in the gaps between sounds)
+    serviceBank1Sync();
+    
     // Debug: Monitor Buffer Status (every 1s)
     #ifdef DEBUG
     static uint32_t lastDebugTime = 0;
     if (millis() - lastDebugTime > 1000) {
         lastDebugTime = millis();
         
-        // Print Performance Stats
-        if (sdReadCount > 0 || decodeCount > 0) {
-            uint32_t avgSd = sdReadCount > 0 ? totalSdReadTime / sdReadCount : 0;
-            uint32_t avgDec = decodeCount > 0 ? totalDecodeTime / decodeCount : 0;
-            
-            Serial.printf("PERF: SD Avg:%d us Max:%d us (%d) | DEC Avg:%d us Max:%d us (%d) | Under:%d\n",
-                avgSd, maxSdReadTime, sdReadCount,
-                avgDec, maxDecodeTime, decodeCount,
-                bufferUnderrunCount);
-                
-            // Reset
-            totalSdReadTime = 0;
-            maxSdReadTime = 0;
-            sdReadCount = 0;
-            totalDecodeTime = 0;
-            maxDecodeTime = 0;
-            decodeCount = 0;
-            // Don't reset underrun count immediately so we can see it accumulate? 
-            // Actually, per-second rate is better.
-            bufferUnderrunCount = 0;
-        }
+        // Print Performance Stats (same as the PERF command)
+        perfReport(Serial);
 
         if (streams) {
             for (int i = 0; i < maxStreams; i++) {
@@ -546,20 +563,13 @@ void loop() {
     }
     #endif
     
-    // Check for stop requests (auto-stop)
+    // Check for stop requests (auto-stop, set by fillStreamBuffers() once a
+    // stream has drained). Drained or faded out already, so no de-click fade.
     for (int i = 0; i < maxStreams; i++) {
-        // 1. Explicit stop request
         if (streams && streams[i].stopRequested) {
-            stopStream(i);
+            stopStream(i, 0);
             streams[i].stopRequested = false;
         }
-        
-        // 2. Auto-stop when file finished AND buffer empty
-        if (streams[i].active && streams[i].fileFinished) {
-            if (streams[i].ringBuffer->availableForRead() == 0) {
-                stopStream(i);
-            }
-        }
     }
     
     // Debug: System Stats (every 5s)
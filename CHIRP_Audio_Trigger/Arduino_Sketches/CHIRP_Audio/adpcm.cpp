@@ -0,0 +1,215 @@
+// IMA-ADPCM (Core 0)
+// 4:1 storage for Bank 1 in flash (#BANK1_ADPCM). The boot sync encodes
+// 16-bit PCM WAVs into standard IMA-ADPCM WAVs (format 0x0011, the block
+// layout Windows and SoX use), so a synced file still opens elsewhere.
+// Every block starts with each channel's predictor and step index and
+// decodes on its own: streams read one block per refill step and seek to
+// the block in front of the requested frame. Decoding is a table lookup, a
+// few adds and a clamp per sample.
+#include "config.h"
+
+bool bank1Adpcm = false;
+
+static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t indexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct AdpcmChannel {
+    int32_t predictor;
+    int32_t index;
+};
+
+// Applies one nibble to the channel state, returns the new sample
+static inline int16_t decodeNibble(AdpcmChannel &c, uint8_t n) {
+    int32_t step = stepTable[c.index];
+    int32_t delta = step >> 3;
+    if (n & 4) delta += step;
+    if (n & 2) delta += step >> 1;
+    if (n & 1) delta += step >> 2;
+    c.predictor += (n & 8) ? -delta : delta;
+    if (c.predictor > 32767) c.predictor = 32767;
+    else if (c.predictor < -32768) c.predictor = -32768;
+    c.index += indexTable[n];
+    if (c.index < 0) c.index = 0;
+    else if (c.index > 88) c.index = 88;
+    return (int16_t)c.predictor;
+}
+
+// Nibble closest to `sample`; the state moves exactly as the decoder's will
+static inline uint8_t encodeNibble(AdpcmChannel &c, int32_t sample) {
+    int32_t step = stepTable[c.index];
+    int32_t diff = sample - c.predictor;
+    uint8_t n = 0;
+    if (diff < 0) {
+        n = 8;
+        diff = -diff;
+    }
+    if (diff >= step) { n |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { n |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) n |= 1;
+    decodeNibble(c, n);
+    return n;
+}
+
+// Frames in a block of `blockAlign` bytes: the header sample plus 8 per
+// 4-byte group of each channel
+uint32_t adpcmBlockFrames(uint32_t blockAlign, uint8_t channels) {
+    uint32_t head = 4u * channels;
+    if (blockAlign < head) return 0;
+    return 1 + ((blockAlign - head) / head) * 8;
+}
+
+// ===================================
+// Decode
+// ===================================
+// Decodes one block (`bytes` may be short for the last one) into `out` as
+// interleaved frames. Returns the frames decoded, at most samplesPerBlock.
+uint32_t adpcmDecodeBlock(const uint8_t* in, uint32_t bytes, uint8_t channels, uint16_t samplesPerBlock, int16_t* out) {
+    uint32_t head = 4u * channels;
+    if (bytes < head || samplesPerBlock == 0) return 0;
+
+    AdpcmChannel c[2];
+    for (int ch = 0; ch < channels; ch++) {
+        const uint8_t* h = in + ch * 4;
+        c[ch].predictor = (int16_t)(h[0] | (h[1] << 8));
+        c[ch].index = (h[2] > 88) ? 88 : h[2];
+        out[ch] = (int16_t)c[ch].predictor;
+    }
+
+    uint32_t groups = (bytes - head) / head;
+    if (1 + groups * 8 > samplesPerBlock) groups = (samplesPerBlock - 1) / 8;
+
+    // Per group: 4 bytes (8 samples, low nibble first) of each channel in turn
+    const uint8_t* p = in + head;
+    int16_t* frame = out + channels;
+    for (uint32_t g = 0; g < groups; g++) {
+        for (int ch = 0; ch < channels; ch++) {
+            int16_t* dst = frame + ch;
+            for (int b = 0; b < 4; b++) {
+                uint8_t v = *p++;
+                *dst = decodeNibble(c[ch], v & 0x0F);
+                dst += channels;
+                *dst = decodeNibble(c[ch], v >> 4);
+                dst += channels;
+            }
+        }
+        frame += 8 * channels;
+    }
+    return 1 + groups * 8;
+}
+
+// ===================================
+// Encode (flash sync)
+// ===================================
+// Encodes up to ADPCM_BLOCK_FRAMES interleaved frames into one block of
+// ADPCM_BLOCK_BYTES * channels bytes; a short last block is padded with
+// silence. `index` carries each channel's step index from block to block.
+uint32_t adpcmEncodeBlock(const int16_t* pcm, uint32_t frames, uint8_t channels, uint8_t* index, uint8_t* out) {
+    AdpcmChannel c[2];
+    for (int ch = 0; ch < channels; ch++) {
+        int16_t first = frames ? pcm[ch] : 0;
+        c[ch].predictor = first;
+        c[ch].index = index[ch];
+        uint8_t* h = out + ch * 4;
+        h[0] = (uint8_t)(first & 0xFF);
+        h[1] = (uint8_t)((uint16_t)first >> 8);
+        h[2] = (uint8_t)c[ch].index;
+        h[3] = 0;
+    }
+
+    uint8_t* p = out + 4 * channels;
+    for (uint32_t f = 1; f < ADPCM_BLOCK_FRAMES; f += 8) {
+        for (int ch = 0; ch < channels; ch++) {
+            for (uint32_t k = 0; k < 8; k += 2) {
+                int32_t s0 = (f + k < frames) ? pcm[(f + k) * channels + ch] : 0;
+                int32_t s1 = (f + k + 1 < frames) ? pcm[(f + k + 1) * channels + ch] : 0;
+                uint8_t lo = encodeNibble(c[ch], s0);
+                uint8_t hi = encodeNibble(c[ch], s1);
+                *p++ = lo | (hi << 4);
+            }
+        }
+    }
+
+    for (int ch = 0; ch < channels; ch++) index[ch] = (uint8_t)c[ch].index;
+    return ADPCM_BLOCK_BYTES * channels;
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+// RIFF, fmt (20 bytes), fact and data chunk headers for `frames` frames in
+// blocks from adpcmEncodeBlock(). Writes ADPCM_HEADER_BYTES to `out` and
+// returns the size the data chunk will have.
+uint32_t adpcmWavHeader(uint8_t* out, uint8_t channels, uint32_t sampleRate, uint32_t frames) {
+    uint32_t blockAlign = ADPCM_BLOCK_BYTES * channels;
+    uint32_t blocks = (frames + ADPCM_BLOCK_FRAMES - 1) / ADPCM_BLOCK_FRAMES;
+    uint32_t dataBytes = blocks * blockAlign;
+
+    memcpy(out, "RIFF", 4);
+    put32(out + 4, ADPCM_HEADER_BYTES - 8 + dataBytes);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    put32(out + 16, 20);
+    put16(out + 20, WAVE_FORMAT_IMA_ADPCM);
+    put16(out + 22, channels);
+    put32(out + 24, sampleRate);
+    put32(out + 28, (uint32_t)(((uint64_t)sampleRate * blockAlign) / ADPCM_BLOCK_FRAMES)); // Bytes/sec
+    put16(out + 32, (uint16_t)blockAlign);
+    put16(out + 34, 4);  // Bits per sample
+    put16(out + 36, 2);  // Extra fmt bytes
+    put16(out + 38, ADPCM_BLOCK_FRAMES);
+    memcpy(out + 40, "fact", 4);
+    put32(out + 44, 4);
+    put32(out + 48, frames);
+    memcpy(out + 52, "data", 4);
+    put32(out + 56, dataBytes);
+    return dataBytes;
+}
+
+// ===================================
+// Read Into Memory (warm cache, RAM bank)
+// ===================================
+// Decodes whole blocks from the file's current position (a block boundary)
+// until `maxFrames` frames are in `dst`. Stops early at the end of the data.
+// Caller holds the file's mutex.
+template <typename F>
+static uint32_t adpcmReadFramesImpl(F &f, const WavLayout &l, int16_t* dst, uint32_t maxFrames) {
+    static uint8_t block[ADPCM_MAX_BLOCK_ALIGN];
+    static int16_t pcm[ADPCM_MAX_BLOCK_SAMPLES];
+    if (l.blockAlign == 0 || l.blockAlign > ADPCM_MAX_BLOCK_ALIGN) return 0;
+    if (maxFrames > l.frames) maxFrames = l.frames;
+
+    uint32_t got = 0;
+    while (got < maxFrames) {
+        int n = f.read(block, l.blockAlign);
+        if (n <= 0) break;
+        uint32_t frames = adpcmDecodeBlock(block, n, l.channels, l.samplesPerBlock, pcm);
+        if (frames == 0) break;
+        if (frames > maxFrames - got) frames = maxFrames - got;
+        memcpy(dst + got * l.channels, pcm, frames * l.channels * 2);
+        got += frames;
+    }
+    return got;
+}
+
+uint32_t adpcmReadFrames(File &f, const WavLayout &l, int16_t* dst, uint32_t maxFrames) {
+    return adpcmReadFramesImpl(f, l, dst, maxFrames);
+}
+uint32_t adpcmReadFrames(FsFile &f, const WavLayout &l, int16_t* dst, uint32_t maxFrames) {
+    return adpcmReadFramesImpl(f, l, dst, maxFrames);
+}
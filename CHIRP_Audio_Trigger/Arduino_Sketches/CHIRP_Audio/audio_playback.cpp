@@ -4,52 +4,6 @@
 #include <string.h>
 #include <math.h>
 
-// =================================================================================
-//  UNIFIED MIXER LOGIC + CHIRP GENERATOR
-// =================================================================================
-
-// Mixer configuration
-#define STREAM0_FADE_MS      5     
-#ifndef SAMPLE_RATE
-#define SAMPLE_RATE 44100
-#endif
-#define STREAM0_FADE_SAMPLES ((SAMPLE_RATE * STREAM0_FADE_MS) / 1000)
-
-// --- SINE LOOKUP TABLE ---
-// A full 256-value sine wave (0..255 corresponds to 0..360 degrees)
-// Values are signed 8-bit (-127 to 127) to save space, scaled up during mixing.
-const int8_t SINE_LUT[256] = {
-    0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45,
-    48, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
-    90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 110, 112, 113, 115, 116,
-    117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
-    127, 127, 127, 127, 126, 126, 126, 125, 125, 124, 123, 122, 122, 121, 120, 118,
-    117, 116, 115, 113, 112, 110, 109, 107, 106, 104, 102, 100, 98, 96, 94, 92,
-    90, 88, 85, 83, 81, 78, 76, 73, 71, 68, 65, 63, 60, 57, 54, 51,
-    48, 45, 42, 39, 36, 33, 30, 27, 24, 21, 18, 15, 12, 9, 6, 3,
-    0, -3, -6, -9, -12, -15, -18, -21, -24, -27, -30, -33, -36, -39, -42, -45,
-    -48, -51, -54, -57, -60, -63, -65, -68, -71, -73, -76, -78, -81, -83, -85, -88,
-    -90, -92, -94, -96, -98, -100, -102, -104, -106, -107, -109, -110, -112, -113, -115, -116,
-    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
-    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
-    -117, -116, -115, -113, -112, -110, -109, -107, -106, -104, -102, -100, -98, -96, -94, -92,
-    -90, -88, -85, -83, -81, -78, -76, -73, -71, -68, -65, -63, -60, -57, -54, -51,
-    -48, -45, -42, -39, -36, -33, -30, -27, -24, -21, -18, -15, -12, -9, -6, -3
-};
-
-// --- CHIRP STATE ---
-struct ChirpState {
-    bool active;
-    uint32_t phase;         // Current phase accumulator
-    uint32_t phaseInc;      // Current frequency increment per sample
-    uint32_t targetInc;     // Target frequency increment
-    int32_t sweepStep;      // How much to change phaseInc per sample
-    uint32_t samplesLeft;   // Duration counter
-    uint8_t volume;         // 0..255
-};
-
-// Global Chirp Instance (volatile for thread safety between Core0/1)
-volatile ChirpState chirp = {false, 0, 0, 0, 0, 0, 0};
 
 // ===================================
 // Global Audio Objects
@@ -59,7 +13,6 @@ volatile ChirpState chirp = {false, 0, 0, 0, 0, 0, 0};
 // ===================================
 // Configurable Globals
 int maxStreams = DEFAULT_MAX_STREAMS;
-int maxMp3Decoders = DEFAULT_MAX_STREAMS;
 int streamBufferSize = (DEFAULT_STREAM_BUFFER_KB * 1024) / 2; // Samples (16-bit) -> KB * 1024 / 2 bytes
 int streamBufferMask = 0; // Calculated in init
 
@@ -67,29 +20,6 @@ int streamBufferMask = 0; // Calculated in init
 // Pointers for Dynamic Allocation
 AudioStream* streams = nullptr;
 RingBuffer* streamBuffers = nullptr;
-MP3DecoderHelix** mp3Decoders = nullptr;
-bool* mp3DecoderInUse = nullptr;
-
-// Context for the callback (since library doesn't pass user data through write)
-// Context for the callback (since library doesn't pass user data through write)
-volatile int currentDecodingStream = -1;
-
-// AAC Globals
-AACDecoderHelix** aacDecoders = nullptr;
-bool* aacDecoderInUse = nullptr;
-
-#ifdef DEBUG
-// Performance Counters
-volatile uint32_t totalSdReadTime = 0;
-volatile uint32_t maxSdReadTime = 0;
-volatile uint32_t sdReadCount = 0;
-
-volatile uint32_t totalDecodeTime = 0;
-volatile uint32_t maxDecodeTime = 0;
-volatile uint32_t decodeCount = 0;
-
-volatile uint32_t bufferUnderrunCount = 0;
-#endif
 
 // ===================================
 // Initialize Audio System
@@ -101,6 +31,7 @@ void initAudioSystem() {
     // Calulate Mask (Must be Power of 2 - 1)
     // NOTE: streamBufferSize is ensured to be Power of 2 by INI parser or default
     streamBufferMask = streamBufferSize - 1;
+    initResampler();
 
     Serial.printf("Initializing Audio System: %d Streams, Buffer %d KB (Mask: 0x%X)\n", maxStreams, (streamBufferSize * 2) / 1024, streamBufferMask);
 
@@ -108,8 +39,8 @@ void initAudioSystem() {
     // 1. Allocate Array Structures
     streams = new AudioStream[maxStreams];
     streamBuffers = new RingBuffer[maxStreams];
-    mp3Decoders = new MP3DecoderHelix*[maxMp3Decoders];
-    mp3DecoderInUse = new bool[maxMp3Decoders];
+
+    initMixer();
 
     // Initialize Streams
     for (int i = 0; i < maxStreams; i++) {
@@ -119,7 +50,13 @@ void initAudioSystem() {
         streams[i].decoderIndex = -1;
         streams[i].ringBuffer = &streamBuffers[i];
         streams[i].stopRequested = false;
+        streams[i].fadingOut = false;
         streams[i].fileFinished = false;
+        streams[i].joinFrames = 0;
+        streams[i].ownerBank = 0;
+        streams[i].streamClass = STREAM_CLASS_EFFECTS;
+        streams[i].claimTime = 0;
+        resetStreamQueue(&streams[i]);
         
         // Allocate Buffer in PSRAM
         // streamBufferSize samples * 2 bytes
@@ -135,533 +72,612 @@ void initAudioSystem() {
             // Allocation Failed!
             Serial.printf("Stream %d: ERROR - PSRAM Allocation Failed!\n", i);
         }
+        
+        // SD Staging Buffer in PSRAM
+        streams[i].staging = (uint8_t*)pmalloc(STREAM_STAGING_SIZE);
+        streams[i].stagingLen = 0;
+        streams[i].stagingPos = 0;
+        if (!streams[i].staging) {
+            Serial.printf("Stream %d: ERROR - Staging buffer allocation failed, using direct SD reads\n", i);
+        }
         delay(10); // Prevent power spike / bus contention during burst allocation
     }
     
-    // Initialize Decoder Pool Flags
-    for (int i = 0; i < maxMp3Decoders; i++) {
-        mp3DecoderInUse[i] = false;
-        mp3Decoders[i] = nullptr; // Will be allocated later in setup()
-    }
-    
-    // Initialize AAC Decoder Pool Flags (using same count as MP3 for now)
-    aacDecoders = new AACDecoderHelix*[maxMp3Decoders];
-    aacDecoderInUse = new bool[maxMp3Decoders];
-    for (int i = 0; i < maxMp3Decoders; i++) {
-        aacDecoderInUse[i] = false;
-        aacDecoders[i] = nullptr; 
+    // MP3 / AAC decoders are constructed on demand in one PSRAM arena
+    initDecoderPool();
+
+    perfInit();
+}
+
+
+// ===================================
+// SD Staging Buffer (Core 0)
+// ===================================
+// SD streams read large chunks into a per-stream staging buffer, so one
+// SdFat call (and SPI transaction) moves several KB instead of a single
+// 512-byte sector. Decoders and the WAV path are then fed from staging.
+
+// Picks the next SD read size for a stream: ~250ms of audio at the stream's
+// byte rate, clamped to SD_READ_MIN_BYTES..STREAM_STAGING_SIZE. When the ring
+// buffer is running low the read is kept short, so the decoder gets data (and
+// the card is released) sooner. The read is trimmed to end on a sector
+// boundary so every following read starts sector-aligned (the WAV path joins
+// a frame split across two reads).
+static uint32_t chooseSdReadSize(AudioStream* s, uint32_t filePos) {
+    uint32_t size = s->bytesPerSec / 4;
+    if (size < SD_READ_MIN_BYTES) size = SD_READ_MIN_BYTES;
+    if (size > STREAM_STAGING_SIZE) size = STREAM_STAGING_SIZE;
+
+    if (s->ringBuffer->availableForRead() < streamBufferSize / 4 && size > SD_READ_MIN_BYTES * 2) {
+        size = SD_READ_MIN_BYTES * 2;
     }
+
+    uint32_t end = (filePos + size) & ~(uint32_t)511;
+    if (end > filePos) size = end - filePos;
+    return size;
 }
 
-// Simple inline helpers
-static inline int32_t i16_to_i32(int16_t s) { return (int32_t)s; }
-static inline int16_t i32_to_i16(int32_t v) { if (v > 32767) return 32767; if (v < -32768) return -32768; return (int16_t)v; }
+// Copies up to `len` bytes of the stream's SD file into dst, refilling the
+// staging buffer when it runs dry. Sets fileFinished at end of file.
+// Returns the number of bytes copied.
+static int readSdStaged(AudioStream* s, int streamIdx, uint8_t* dst, int len) {
+    if (s->stagingPos >= s->stagingLen) {
+        int bytesRead = 0;
+        uint8_t* target = s->staging ? s->staging : dst;
+
+        if (s->sdFile) {
+            uint32_t size = s->staging ? chooseSdReadSize(s, s->sdFile.position()) : (uint32_t)len;
+            bytesRead = sdIoRead(s->sdFile, target, size, SD_IO_STREAM);
+        }
+
+        if (bytesRead <= 0) {
+            s->fileFinished = true;
+            #ifdef DEBUG
+            log_message(String("Stream ") + streamIdx + ": SD EOF detected");
+            #endif
+            return 0;
+        }
+
+        // No staging buffer (allocation failed): data went straight to dst
+        if (!s->staging) return bytesRead;
+
+        s->stagingPos = 0;
+        s->stagingLen = bytesRead;
+    }
+
+    int n = s->stagingLen - s->stagingPos;
+    if (n > len) n = len;
+    memcpy(dst, s->staging + s->stagingPos, n);
+    s->stagingPos += n;
+    return n;
+}
 
 // ===================================
-// Fill Stream Buffers (Core 0)
+// MP3 Frame Feed (Core 0)
 // ===================================
-// This function iterates through all active streams, reads data from their
-// respective files (Flash or SD), decodes it (if MP3), and pushes it into
-// the stream's Ring Buffer.
-// the stream's Ring Buffer.
-void fillStreamBuffers() {
-    // Safety check
-    if (!streams) return;
+// MP3 streams are handed to the decoder one whole frame at a time, straight
+// out of the staging buffer (SD and flash alike): the header at the read
+// position gives the frame length, the header after it confirms the sync,
+// and exactly that frame goes to write(). The decoder never holds a partial
+// frame to resync on, and a step decodes at most MP3_FRAMES_PER_STEP frames,
+// so its cost and ring space are bounded. Anything that isn't a frame (ID3
+// tags, junk, free-format streams) is passed through unparsed as before.
 
-    for (int i = 0; i < maxStreams; i++) {
-        AudioStream* s = &streams[i];
-        
-        if (!s->active || s->fileFinished) continue;
+// Makes at least `need` bytes available from stagingPos, moving the unread
+// tail to the front and reading after it. Returns -1 if nothing had to be
+// read, otherwise the bytes read (0 = end of file).
+static int topUpStaging(AudioStream* s, uint32_t need) {
+    uint32_t avail = s->stagingLen - s->stagingPos;
+    if (avail >= need) return -1;
+    if (s->stagingPos > 0) {
+        memmove(s->staging, s->staging + s->stagingPos, avail);
+        s->stagingPos = 0;
+        s->stagingLen = avail;
+    }
+    uint32_t room = STREAM_STAGING_SIZE - s->stagingLen;
+    int bytesRead = 0;
 
-        // Safety: If MSC is active, do NOT touch SD card streams!
-        if (g_mscActive && (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD)) {
-            continue; 
+    if (s->type == STREAM_TYPE_MP3_SD) {
+        if (s->sdFile) {
+            uint32_t pos = s->sdFile.position();
+            uint32_t size = chooseSdReadSize(s, pos);
+            if (size > room) {
+                size = room;
+                uint32_t end = (pos + size) & ~(uint32_t)511;
+                if (end > pos) size = end - pos;
+            }
+            bytesRead = sdIoRead(s->sdFile, s->staging + s->stagingLen, size, SD_IO_STREAM);
         }
+    } else {
+        mutex_enter_blocking(&flash_mutex);
+        if (s->flashFile) {
+            uint32_t tStart = perfNow();
+            bytesRead = s->flashFile.read(s->staging + s->stagingLen, room < MP3_FLASH_READ_BYTES ? room : MP3_FLASH_READ_BYTES);
+            perfRead(false, perfNow() - tStart);
+        }
+        mutex_exit(&flash_mutex);
+    }
+
+    if (bytesRead < 0) bytesRead = 0;
+    s->stagingLen += bytesRead;
+    return bytesRead;
+}
+
+// Length of the frame at `p`, 0 if `p` isn't a frame, -1 if more data is
+// needed to tell. At end of file the last frame needs no header after it.
+static int mp3FrameAt(const uint8_t* p, uint32_t avail, bool eof) {
+    Mp3FrameHeader hdr, next;
+    if (avail < 4) return eof ? 0 : -1;
+    if (!parseMp3Header(p, hdr) || hdr.frameLen > MP3_MAX_FRAME_BYTES) return 0;
+    if (avail >= hdr.frameLen + 4) return parseMp3Header(p + hdr.frameLen, next) ? (int)hdr.frameLen : 0;
+    if (!eof) return -1;
+    return (avail == hdr.frameLen) ? (int)hdr.frameLen : 0;
+}
+
+// One refill step. Returns true if any file data was read or decoded.
+static bool feedMp3Frames(AudioStream* s, int i) {
+    MP3DecoderHelix* dec = poolMp3(s->decoderIndex);
+    if (!dec) return false;
+
+    bool progress = false;
+    uint32_t skipped = 0;
+    int frames = 0;
+    while (frames < MP3_FRAMES_PER_STEP && skipped < MP3_SKIP_BYTES_PER_STEP) {
+        int got = topUpStaging(s, MP3_MAX_FRAME_BYTES + 4);
+        bool eof = (got == 0);
+        if (got > 0) progress = true;
+
+        uint32_t avail = s->stagingLen - s->stagingPos;
+        if (avail == 0) {
+            if (eof) {
+                s->fileFinished = true;
+                #ifdef DEBUG
+                log_message(String("Stream ") + i + ": MP3 EOF detected");
+                #endif
+            }
+            break;
+        }
+
+        const uint8_t* p = s->staging + s->stagingPos;
+        int len = mp3FrameAt(p, avail, eof);
+        if (len < 0) break; // Short read, the rest of the frame comes next step
+        if (len > 0) {
+            frames++;
+        } else {
+            // Not a frame: up to the next sync candidate goes through as-is
+            const uint8_t* sync = (const uint8_t*)memchr(p + 1, 0xFF, avail - 1);
+            len = sync ? (int)(sync - p) : (int)avail;
+            skipped += len;
+        }
+
+        perfDecodeBegin(i);
+        dec->write(p, len);
+        s->stagingPos += len;
+        progress = true;
+    }
+    return progress;
+}
+
+// ===================================
+// Refill Scheduler (Core 0)
+// ===================================
+// Streams are refilled by urgency rather than in index order: each round the
+// stream with the least buffered audio (time-to-empty = ring fill / rate)
+// gets a burst of decode steps, until the budget for this loop() is spent.
+// A stream whose ring cannot take the worst-case output of one step is
+// skipped. The smallest time-to-empty seen is kept for isCpuBusy() and the
+// LEDs to throttle themselves against.
+volatile uint32_t refillUrgencyMs = REFILL_IDLE_MS;
+
+// Free ring space (samples) needed before a step, so everything one step can
+// decode fits without being dropped by pushPcm.
+static int stepHeadroom(AudioStream* s) {
+    switch (s->type) {
+        case STREAM_TYPE_MP3_SD:
+        case STREAM_TYPE_MP3_FLASH:
+            // MP3_FRAMES_PER_STEP frames (+1 completed by skipped data), or 512
+            // unstaged bytes at low bitrates
+            return (MP3_FRAMES_PER_STEP + 1) * 1152 * 2;
+        case STREAM_TYPE_AAC_SD:
+        case STREAM_TYPE_AAC_FLASH:
+            return 16384; // 512-1024 input bytes at low bitrates can hold several frames
+        case STREAM_TYPE_M4A_SD:
+        case STREAM_TYPE_M4A_FLASH:
+            return 4096;  // One access unit: 1024 stereo frames (2048 with SBR)
+        case STREAM_TYPE_ADPCM_FLASH:
+            return s->adpcmSamplesPerBlock * s->channels; // One block
+        default:
+            return 2048;  // WAV: 256 samples per step
+    }
+}
+
+// Milliseconds of audio buffered for a stream at its native rate.
+// Streams whose format is not known yet (first frame not decoded) report 0.
+uint32_t streamBufferMs(AudioStream* s) {
+    if (s->sampleRate == 0 || s->channels == 0) return 0;
+    uint32_t samplesPerSec = s->sampleRate * s->channels;
+    return (uint32_t)(((uint64_t)s->ringBuffer->availableForRead() * 1000) / samplesPerSec);
+}
+
+// Stream can be refilled this loop (active, data left, SD not lent to USB)
+static bool refillEligible(AudioStream* s) {
+    if (!s->active || s->fileFinished) return false;
+    if (g_mscActive && isSdStream(s)) return false;
+    return true;
+}
+
+// ===================================
+// Deferred Open (Core 0)
+// ===================================
+// Opens the file of a stream that started from the warm cache and positions
+// it just past the cached PCM. If the file is gone the cached head still
+// plays out and the stream then stops as usual.
+static bool openPendingFile(AudioStream* s, int i) {
+    s->openPending = false;
+    bool ok = false;
+    
+    if (s->type == STREAM_TYPE_WAV_FLASH || s->type == STREAM_TYPE_ADPCM_FLASH) {
+        mutex_enter_blocking(&flash_mutex);
+        s->flashFile = LittleFS.open(s->filename, "r");
+        ok = s->flashFile && s->flashFile.seek(s->openPos);
+        mutex_exit(&flash_mutex);
+    } else {
+        sdIoBegin(SD_IO_STREAM);
+        s->sdFile = sd.open(s->filename, FILE_READ);
+        ok = s->sdFile && s->sdFile.seek(s->openPos);
+        sdIoEnd();
+    }
+    
+    if (!ok) {
+        log_message(String("Stream ") + i + ": ERROR - Deferred open failed");
+        s->fileFinished = true;
+    }
+    return ok;
+}
+
+// ===================================
+// Refill Step (Core 0)
+// ===================================
+// Reads one chunk from the stream's file (Flash or SD), decodes it (MP3/AAC)
+// and pushes the PCM into the stream's Ring Buffer.
+// Returns true if any file data was consumed.
+static bool refillStep(AudioStream* s, int i) {
+    bool progress = false;
+    if (s->openPending && !openPendingFile(s, i)) return false;
+
+    if ((s->type == STREAM_TYPE_MP3_SD || s->type == STREAM_TYPE_MP3_FLASH) && s->staging) {
+        // --- MP3 (SD or Flash), whole frames from staging ---
+        if (s->decoderIndex != -1) progress = feedMp3Frames(s, i);
+
+    } else if (s->type == STREAM_TYPE_MP3_SD) {
+        // --- MP3 (SD, no staging buffer) ---
+        uint8_t mp3Buf[512]; 
+        int bytesRead = readSdStaged(s, i, mp3Buf, sizeof(mp3Buf));
+        progress = bytesRead > 0;
         
-        // Check if buffer needs data
-        int available = s->ringBuffer->availableForWrite();
-        
-        #ifdef DEBUG
-        // Check for underruns (if active and buffer empty)
-        if (s->active && !s->fileFinished && s->ringBuffer->availableForRead() == 0) {
-            bufferUnderrunCount++;
+        if (bytesRead > 0 && s->decoderIndex != -1) {
+            perfDecodeBegin(i);
+            poolMp3(s->decoderIndex)->write(mp3Buf, bytesRead);
         }
-        #endif
         
-        if (s->type == STREAM_TYPE_MP3_SD) {
-            // --- MP3 (SD) ---
-            // MP3 frames can be large. Low bitrate frames can be many samples per byte.
-            // Safety margin increased to 16384 to be absolutely sure.
-            if (available > 16384) {
-                uint8_t mp3Buf[512]; 
-                int bytesRead = 0;
-                
-                mutex_enter_blocking(&sd_mutex);
-                if (s->sdFile) {
-                    #ifdef DEBUG
-                    uint32_t tStart = micros();
-                    #endif
-                    bytesRead = s->sdFile.read(mp3Buf, sizeof(mp3Buf));
-                    #ifdef DEBUG
-                    uint32_t tDur = micros() - tStart;
-                    totalSdReadTime += tDur;
-                    if (tDur > maxSdReadTime) maxSdReadTime = tDur;
-                    sdReadCount++;
-                    #endif
-                    if (bytesRead == 0) {
-                        if (!s->sdFile.available()) {
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": MP3 EOF detected (read 0)");
-                            #endif
-                        } else {
-                             #ifdef DEBUG
-                             log_message(String("Stream ") + i + ": MP3 read 0 but available!");
-                             #endif
-                        }
-                    }
-                }
-                mutex_exit(&sd_mutex);
-                
-                if (bytesRead > 0 && s->decoderIndex != -1) {
-                    // Set global context before writing
-                    currentDecodingStream = i;
-                    #ifdef DEBUG
-                    uint32_t tStart = micros();
-                    #endif
-                    mp3Decoders[s->decoderIndex]->write(mp3Buf, bytesRead);
+    } else if (s->type == STREAM_TYPE_MP3_FLASH) {
+        // --- MP3 (Flash, no staging buffer) ---
+        uint8_t mp3Buf[512]; 
+        int bytesRead = 0;
+        
+        mutex_enter_blocking(&flash_mutex);
+        if (s->flashFile) {
+            uint32_t tStart = perfNow();
+            bytesRead = s->flashFile.read(mp3Buf, sizeof(mp3Buf));
+            perfRead(false, perfNow() - tStart);
+            if (bytesRead == 0) {
+                if (!s->flashFile.available()) {
+                    s->fileFinished = true;
                     #ifdef DEBUG
-                    uint32_t tDur = micros() - tStart;
-                    totalDecodeTime += tDur;
-                    if (tDur > maxDecodeTime) maxDecodeTime = tDur;
-                    decodeCount++;
+                    log_message(String("Stream ") + i + ": MP3 (Flash) EOF detected (read 0)");
                     #endif
-                    currentDecodingStream = -1;
-                }
-            }
-            
-        } else if (s->type == STREAM_TYPE_MP3_FLASH) {
-            // --- MP3 (Flash) ---
-            if (available > 16384) {
-                uint8_t mp3Buf[512]; 
-                int bytesRead = 0;
-                
-                mutex_enter_blocking(&flash_mutex);
-                if (s->flashFile) {
-                    bytesRead = s->flashFile.read(mp3Buf, sizeof(mp3Buf));
-                    if (bytesRead == 0) {
-                        if (!s->flashFile.available()) {
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": MP3 (Flash) EOF detected (read 0)");
-                            #endif
-                        }
-                    }
-                }
-                mutex_exit(&flash_mutex);
-                
-                if (bytesRead > 0 && s->decoderIndex != -1) {
-                    // Set global context before writing
-                    currentDecodingStream = i;
-                    mp3Decoders[s->decoderIndex]->write(mp3Buf, bytesRead);
-                    currentDecodingStream = -1;
                 }
             }
+        }
+        mutex_exit(&flash_mutex);
+        progress = bytesRead > 0;
+        
+        if (bytesRead > 0 && s->decoderIndex != -1) {
+            perfDecodeBegin(i);
+            poolMp3(s->decoderIndex)->write(mp3Buf, bytesRead);
+        }
 
-        } else if (s->type == STREAM_TYPE_AAC_SD) {
-            // --- AAC (SD) ---
-            if (available > 16384) {
-                uint8_t aacBuf[1024]; 
-                int bytesRead = 0;
-                
-                mutex_enter_blocking(&sd_mutex);
-                if (s->sdFile) {
-                    bytesRead = s->sdFile.read(aacBuf, sizeof(aacBuf));
-                    if (bytesRead == 0) {
-                        if (!s->sdFile.available()) {
-                             s->fileFinished = true;
-                        }
-                    }
-                }
-                mutex_exit(&sd_mutex);
-                
-                if (bytesRead > 0 && s->decoderIndex != -1) {
-                    currentDecodingStream = i;
-                    aacDecoders[s->decoderIndex]->write(aacBuf, bytesRead);
-                    currentDecodingStream = -1;
+    } else if (s->type == STREAM_TYPE_AAC_SD) {
+        // --- AAC (SD) ---
+        uint8_t aacBuf[1024]; 
+        int bytesRead = readSdStaged(s, i, aacBuf, sizeof(aacBuf));
+        progress = bytesRead > 0;
+        
+        if (bytesRead > 0 && s->decoderIndex != -1) {
+            perfDecodeBegin(i);
+            poolAac(s->decoderIndex)->write(aacBuf, bytesRead);
+        }
+    } else if (s->type == STREAM_TYPE_AAC_FLASH) {
+        // --- AAC (Flash) ---
+        uint8_t aacBuf[512]; 
+        int bytesRead = 0;
+        
+        mutex_enter_blocking(&flash_mutex);
+        if (s->flashFile) {
+            uint32_t tStart = perfNow();
+            bytesRead = s->flashFile.read(aacBuf, sizeof(aacBuf));
+            perfRead(false, perfNow() - tStart);
+            if (bytesRead == 0) {
+                if (!s->flashFile.available()) {
+                    s->fileFinished = true;
                 }
             }
-        } else if (s->type == STREAM_TYPE_AAC_FLASH) {
-            // --- AAC (Flash) ---
-            if (available > 16384) {
-                uint8_t aacBuf[512]; 
-                int bytesRead = 0;
-                
-                mutex_enter_blocking(&flash_mutex);
-                if (s->flashFile) {
-                    bytesRead = s->flashFile.read(aacBuf, sizeof(aacBuf));
-                    if (bytesRead == 0) {
-                        if (!s->flashFile.available()) {
-                            s->fileFinished = true;
-                        }
-                    }
-                }
-                mutex_exit(&flash_mutex);
-                
-                if (bytesRead > 0 && s->decoderIndex != -1) {
-                    currentDecodingStream = i;
-                    aacDecoders[s->decoderIndex]->write(aacBuf, bytesRead);
-                    currentDecodingStream = -1;
+        }
+        mutex_exit(&flash_mutex);
+        progress = bytesRead > 0;
+        
+        if (bytesRead > 0 && s->decoderIndex != -1) {
+            perfDecodeBegin(i);
+            poolAac(s->decoderIndex)->write(aacBuf, bytesRead);
+        }
+    } else if (s->type == STREAM_TYPE_M4A_SD || s->type == STREAM_TYPE_M4A_FLASH) {
+        // --- M4A (Container) ---
+         uint8_t m4aBuf[2048]; 
+         
+         // Lock appropriate mutex
+         if (s->type == STREAM_TYPE_M4A_SD) sdIoBegin(SD_IO_STREAM);
+         else mutex_enter_blocking(&flash_mutex);
+         
+         uint32_t tStart = perfNow();
+         size_t bytesRead = s->mp4Parser.readNextFrame(m4aBuf, sizeof(m4aBuf));
+         perfRead(s->type == STREAM_TYPE_M4A_SD, perfNow() - tStart);
+         
+         if (s->type == STREAM_TYPE_M4A_SD) sdIoEnd();
+         else mutex_exit(&flash_mutex);
+         
+         progress = bytesRead > 0;
+         if (bytesRead == 0) {
+             s->fileFinished = true;
+             #ifdef DEBUG
+             log_message(String("Stream ") + i + ": M4A EOF");
+             #endif
+         } else {
+             if (s->decoderIndex != -1) {
+                perfDecodeBegin(i);
+                poolAac(s->decoderIndex)->write(m4aBuf, bytesRead);
+             }
+         }
+    } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH) {
+        // --- WAV (SD or Flash) ---
+        // PCM is stored in its native layout, so 512 bytes read = 256 samples.
+        int16_t wavBuf[256]; // 512 bytes, read as little-endian PCM
+        int bytesRead = 0;
+        
+        if (s->type == STREAM_TYPE_WAV_SD) {
+            // Staged reads end on a sector, not a frame: when the data doesn't
+            // start on a frame boundary mod 512 the last piece of a fill splits
+            // a frame, so the rest of it comes from the next fill
+            uint32_t frameBytes = s->channels * 2;
+            bytesRead = readSdStaged(s, i, (uint8_t*)wavBuf, sizeof(wavBuf));
+            uint32_t split = bytesRead % frameBytes;
+            if (split && !s->fileFinished) {
+                bytesRead += readSdStaged(s, i, (uint8_t*)wavBuf + bytesRead, frameBytes - split);
+            }
+        } else {
+            mutex_enter_blocking(&flash_mutex);
+            if (s->flashFile) {
+                uint32_t tStart = perfNow();
+                bytesRead = s->flashFile.read((uint8_t*)wavBuf, sizeof(wavBuf));
+                perfRead(false, perfNow() - tStart);
+                if (bytesRead == 0) { 
+                    s->fileFinished = true;
+                    #ifdef DEBUG
+                    log_message(String("Stream ") + i + ": WAV (Flash) EOF detected");
+                    #endif
                 }
             }
-        } else if (s->type == STREAM_TYPE_M4A_SD || s->type == STREAM_TYPE_M4A_FLASH) {
-            // --- M4A (Container) ---
-            if (available > 4096) { 
-                 uint8_t m4aBuf[2048]; 
-                 
-                 // Lock appropriate mutex
-                 if (s->type == STREAM_TYPE_M4A_SD) mutex_enter_blocking(&sd_mutex);
-                 else mutex_enter_blocking(&flash_mutex);
-                 
-                 size_t bytesRead = s->mp4Parser.readNextFrame(m4aBuf, sizeof(m4aBuf));
-                 
-                 if (s->type == STREAM_TYPE_M4A_SD) mutex_exit(&sd_mutex);
-                 else mutex_exit(&flash_mutex);
-                 
-                 if (bytesRead == 0) {
-                     s->fileFinished = true;
-                     #ifdef DEBUG
-                     log_message(String("Stream ") + i + ": M4A EOF");
-                     #endif
-                 } else {
-                     if (s->decoderIndex != -1) {
-                        currentDecodingStream = i;
-                        aacDecoders[s->decoderIndex]->write(m4aBuf, bytesRead);
-                        currentDecodingStream = -1;
-                     }
-                 }
+            mutex_exit(&flash_mutex);
+        }
+        
+        progress = bytesRead > 0;
+        if (bytesRead > 0) {
+            // Stored as-is (native channels and rate), the mixer upmixes/resamples
+            int samples = bytesRead / 2;
+            int pushed = pushStreamPcm(s, wavBuf, samples, s->channels, s->sampleRate);
+            if (pushed < samples && !s->restartPending) {
+                log_message(String("Stream ") + i + ": WAV ring full, " + (samples - pushed) + " samples dropped");
             }
-        } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH) {
-            // --- WAV (SD or Flash) ---
-            // WAV is simpler, we read small chunks.
-            // We need enough space for the expanded data.
-            // Worst case: Mono 22.05kHz -> Stereo 44.1kHz = 4x expansion.
-            // 512 bytes read = 256 samples input -> 1024 samples output.
-            // To be safe and avoid any boundary issues, we check for 2048 samples.
-            if (available > 2048) {
-                uint8_t wavBuf[512];
-                int bytesRead = 0;
-                
-                if (s->type == STREAM_TYPE_WAV_SD) {
-                    mutex_enter_blocking(&sd_mutex);
-                    if (s->sdFile) {
-                        bytesRead = s->sdFile.read(wavBuf, sizeof(wavBuf));
-                        if (bytesRead == 0) { 
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": WAV (SD) EOF detected");
-                            #endif
-                        }
-                    }
-                    mutex_exit(&sd_mutex);
-                } else {
-                    mutex_enter_blocking(&flash_mutex);
-                    if (s->flashFile) {
-                        bytesRead = s->flashFile.read(wavBuf, sizeof(wavBuf));
-                        if (bytesRead == 0) { 
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": WAV (Flash) EOF detected");
-                            #endif
-                        }
-                    }
-                    mutex_exit(&flash_mutex);
-                }
-                
-                if (bytesRead > 0) {
-                    int samples = bytesRead / 2;
-                    
-                    // Handle 22.05kHz upsampling (duplicate samples)
-                    if (s->sampleRate == 22050) {
-                         if (s->channels == 2) {
-                              // STEREO -> UPSAMPLE (Duplicate frame)
-                              // Process in pairs (L+R) and duplicate each frame
-                              // Input: L0, R0, L1, R1...
-                              // Output: L0, R0, L0, R0, L1, R1, L1, R1...
-                              for (int k = 0; k < samples; k += 2) {
-                                  if (k + 1 >= samples) break; // Should not happen if aligned
-                                  
-                                  int16_t left = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                                  int16_t right = (int16_t)(wavBuf[(k+1)*2] | (wavBuf[(k+1)*2+1] << 8));
-                                  
-                                  // Frame 1
-                                  if (!s->ringBuffer->push(left)) break;
-                                  if (!s->ringBuffer->push(right)) break;
-                                  // Frame 2 (Duplicate)
-                                  if (!s->ringBuffer->push(left)) break;
-                                  if (!s->ringBuffer->push(right)) break;
-                              }
-                         } else {
-                             // MONO -> STEREO (Duplicate) -> UPSAMPLE (Duplicate again)
-                             // Total 4 pushes per input sample
-                             for (int k = 0; k < samples; k++) {
-                                 int16_t sample = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                                 if (!s->ringBuffer->push(sample)) break; // L1
-                                 if (!s->ringBuffer->push(sample)) break; // R1
-                                 if (!s->ringBuffer->push(sample)) break; // L2
-                                 if (!s->ringBuffer->push(sample)) break; // R2
-                             }
-                         }
-                         
-                    } else {
-                        // Normal 44.1kHz handling
-                        for (int k = 0; k < samples; k++) {
-                            int16_t sample = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                            
-                            if (s->channels == 1) {
-                                // MONO -> STEREO (Duplicate)
-                                s->ringBuffer->push(sample); // Left
-                                s->ringBuffer->push(sample); // Right
-                            } else {
-                                // STEREO (Pass through)
-                                s->ringBuffer->push(sample);
-                            }
-                        }
-                    }
-                }
+        }
+    } else if (s->type == STREAM_TYPE_ADPCM_FLASH) {
+        // --- IMA-ADPCM (Flash) ---
+        // One block per step, decoded outside the mutex: 1024 bytes read
+        // for 1017 stereo frames (4068 bytes as PCM).
+        static uint8_t blockBuf[ADPCM_MAX_BLOCK_ALIGN];
+        static int16_t pcmBuf[ADPCM_MAX_BLOCK_SAMPLES];
+        int bytesRead = 0;
+        
+        if (s->adpcmFramesLeft > 0) {
+            mutex_enter_blocking(&flash_mutex);
+            if (s->flashFile) {
+                uint32_t tStart = perfNow();
+                bytesRead = s->flashFile.read(blockBuf, s->adpcmBlockAlign);
+                perfRead(false, perfNow() - tStart);
             }
+            mutex_exit(&flash_mutex);
         }
         
-        // Auto-stop if finished and buffer empty
-        if (s->fileFinished && s->ringBuffer->availableForRead() == 0) {
-            s->stopRequested = true;
+        progress = bytesRead > 0;
+        uint32_t frames = (bytesRead > 0) ? adpcmDecodeBlock(blockBuf, bytesRead, s->channels, s->adpcmSamplesPerBlock, pcmBuf) : 0;
+        if (frames > s->adpcmFramesLeft) frames = s->adpcmFramesLeft;
+        s->adpcmFramesLeft -= frames;
+        
+        // Seek landed on the block in front of the requested frame
+        uint32_t drop = (s->discardFrames < frames) ? s->discardFrames : frames;
+        s->discardFrames -= drop;
+        if (frames > drop) {
+            pushStreamPcm(s, pcmBuf + drop * s->channels, (frames - drop) * s->channels, s->channels, s->sampleRate);
+        }
+        if (frames == 0 || s->adpcmFramesLeft == 0) {
+            s->fileFinished = true;
+            #ifdef DEBUG
+            log_message(String("Stream ") + i + ": ADPCM (Flash) EOF detected");
+            #endif
         }
     }
+    
+    return progress;
 }
 
-// Integer-only Hard Limiter
-static inline void applyFastLimiter(int32_t &l, int32_t &r) {
-    if (l > 32767) l = 32767;
-    else if (l < -32768) l = -32768;
-
-    if (r > 32767) r = 32767;
-    else if (r < -32768) r = -32768;
-}
-
-namespace Mixer {
-    // ===================================
-    // Mixer (Core 1)
-    // ===================================
-    // Mixes samples from all active streams and sends to I2S.
-    inline void processSample() {
-        int32_t mixedLeft = 0;
-        int32_t mixedRight = 0;
-
-        // 1. Mix Streams
-        if (streams) {
-            for (int i = 0; i < maxStreams; i++) {
-            if (streams[i].active && streams[i].ringBuffer->availableForRead() >= 2) {
-                // Pop stereo samples (L, R)
-                int16_t l = streams[i].ringBuffer->pop();
-                int16_t r = streams[i].ringBuffer->pop();
-                
-                // Apply Volume
-                // Gain is 0..256 (volume * master)
-                // We'll do a simple float multiply for flexibility first, then optimize later if needed.
-                // Or stick to int math: volume is float 0..1.0
-                
-                int32_t volFixed = (int32_t)(streams[i].volume * 256.0f);
-                
-                // Ramp Up (Fade In) over 50ms to prevent pops
-                uint32_t elapsed = millis() - streams[i].startTime;
-                if (elapsed < 50) {
-                     int32_t ramp = (elapsed * 256) / 50;
-                     if (ramp > 256) ramp = 256;
-                     volFixed = (volFixed * ramp) >> 8;
-                }
+// ===================================
+// Fill Stream Buffers (Core 0)
+// ===================================
+// Main loop task: runs refill bursts for the most urgent stream until
+// REFILL_BUDGET_US is used up or no stream has room for another step.
+void fillStreamBuffers() {
+    // Safety check
+    if (!streams) return;
 
-                int32_t gain = (volFixed * masterAttenMultiplier) >> 8; // Result 0..256 approx
-                
-                mixedLeft += ((int32_t)l * gain) >> 8;
-                mixedRight += ((int32_t)r * gain) >> 8;
+    uint32_t tStart = micros();
+    
+    for (int round = 0; round < REFILL_MAX_ROUNDS; round++) {
+        // 1. Rank: pick the eligible stream closest to running dry
+        int best = -1;
+        uint32_t bestMs = 0;
+        uint32_t minMs = REFILL_IDLE_MS;
+        
+        for (int i = 0; i < maxStreams; i++) {
+            AudioStream* s = &streams[i];
+            if (!refillEligible(s)) continue;
+            
+            uint32_t ms = streamBufferMs(s);
+            if (ms < minMs) minMs = ms;
+            
+            // Low-water mark, once the stream has started playing
+            if (round == 0 && s->playedFrames > 0) perfBufferLevel(i, ms);
+            
+            if (s->ringBuffer->availableForWrite() <= stepHeadroom(s)) continue;
+            if (best == -1 || ms < bestMs) {
+                best = i;
+                bestMs = ms;
             }
         }
+        if (round == 0) refillUrgencyMs = minMs;
+        if (best == -1) break; // Everyone is full (or idle)
+        
+        // 2. Burst: several steps for that stream while it has room
+        AudioStream* s = &streams[best];
+        for (int step = 0; step < REFILL_BURST_STEPS; step++) {
+            if (!refillStep(s, best)) break;
+            if (s->fileFinished || s->ringBuffer->availableForWrite() <= stepHeadroom(s)) break;
+            if (micros() - tStart > REFILL_BUDGET_US) break;
+        }
+        
+        if (micros() - tStart > REFILL_BUDGET_US) break;
     }
-
-        // --- CHIRP / TONE GENERATOR ---
-        if (chirp.active) {
-            if (chirp.samplesLeft > 0) {
-                // 1. Get Sine Value from LUT (index 0-255)
-                uint8_t index = (chirp.phase >> 24); 
-                int32_t sample = (int32_t)SINE_LUT[index];
-
-                // 2. Scale up: LUT is +/- 127. 
-                // We want standard audio levels (+/- 32000ish).
-                // Shift << 8 gives +/- 32512.
-                sample = sample << 8;
-
-                // 3. Apply Volume (0-255)
-                // sample * vol >> 8
-                sample = (sample * chirp.volume) >> 8;
-
-                // 4. Mix
-                mixedLeft += sample;
-                mixedRight += sample;
-
-                // 5. Advance Phase
-                chirp.phase += chirp.phaseInc;
-
-                // 6. Sweep Frequency
-                if (chirp.sweepStep != 0) {
-                    chirp.phaseInc += chirp.sweepStep;
-                    if (chirp.sweepStep > 0 && chirp.phaseInc > chirp.targetInc) chirp.phaseInc = chirp.targetInc;
-                    if (chirp.sweepStep < 0 && chirp.phaseInc < chirp.targetInc) chirp.phaseInc = chirp.targetInc;
-                }
-
-                chirp.samplesLeft--;
-            } else {
-                chirp.active = false;
-            }
+    
+    // Move finished streams on to their queued item
+    serviceStreamQueues();
+    
+    // Auto-stop if finished and buffer empty, or faded out
+    for (int i = 0; i < maxStreams; i++) {
+        AudioStream* s = &streams[i];
+        if (s->active && s->fadingOut && !mixerVoiceActive(i)) {
+            s->stopRequested = true;
+            continue;
         }
+        if (!s->active || !s->fileFinished || s->restartPending || voiceHoldsStream(i)) continue;
+        bool drained = (s->type == STREAM_TYPE_PCM_RAM) ? (s->ramPos >= s->ramFrames)
+                                                       : (s->ringBuffer->availableForRead() == 0);
+        if (drained) s->stopRequested = true;
+    }
+}
 
-        // Fast Limiter
-
-        i2s.write16(i32_to_i16(mixedLeft), i32_to_i16(mixedRight));
+// ===================================
+// I2S Output (Core 1)
+// ===================================
+namespace Mixer {
+    // Pushes a rendered block into the I2S DMA buffers.
+    // i2s.write() returns early when all DMA buffers are full, so keep
+    // feeding it until the whole block has been queued.
+    inline void writeBlock(const uint32_t* block, int frames) {
+        const uint8_t* p = (const uint8_t*)block;
+        size_t remaining = frames * sizeof(uint32_t);
+        while (remaining > 0) {
+            size_t written = i2s.write(p, remaining);
+            p += written;
+            remaining -= written;
+        }
     }
-} 
+}
+
 
 
 // ===================================
-// HELPER: Trigger a Chirp
+// Post-Seek Trim (Core 0)
 // ===================================
-// startFreq: Start Frequency in Hz
-// endFreq:   End Frequency in Hz
-// durationMs: Duration in Milliseconds
-// vol:        Volume (0-255)
-void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol = 128) {
-    if (durationMs <= 0) return;
-    
-    double incPerHz = 4294967296.0 / (double)SAMPLE_RATE;
-    uint32_t startInc = (uint32_t)(startFreq * incPerHz);
-    uint32_t endInc = (uint32_t)(endFreq * incPerHz);
-    
-    uint32_t totalSamples = (durationMs * SAMPLE_RATE) / 1000;
-    
-    int32_t step = 0;
-    if (totalSamples > 0) {
-        step = (int32_t)((double)((int64_t)endInc - (int64_t)startInc) / (double)totalSamples);
+// Drops the decoded frames between the frame boundary a seek landed on and
+// the requested position. discardFrames is rescaled once if the decoder's
+// output rate differs from the container rate it was computed at (SBR).
+// Advances pcm/len past the dropped frames; returns false if nothing is left.
+static bool discardDecoded(AudioStream* s, int16_t*& pcm, size_t& len, int channels, uint32_t rate) {
+    if (s->discardRate != 0 && rate != 0 && rate != s->discardRate) {
+        s->discardFrames = (uint32_t)(((uint64_t)s->discardFrames * rate) / s->discardRate);
     }
-
-    chirp.active = false; // Pause
-    chirp.phase = 0;
-    chirp.phaseInc = startInc;
-    chirp.targetInc = endInc;
-    chirp.sweepStep = step;
-    chirp.samplesLeft = totalSamples;
-    chirp.volume = vol;
-    chirp.active = true; // Go
+    s->discardRate = 0;
+    
+    uint32_t frames = len / channels;
+    uint32_t drop = (s->discardFrames < frames) ? s->discardFrames : frames;
+    s->discardFrames -= drop;
+    pcm += drop * channels;
+    len -= drop * channels;
+    return len > 0;
 }
 
-
 // ===================================
 // MP3 Decoder Callback
 // ===================================
 void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref) {
-    // Use global context since library doesn't pass user data through write() correctly
-    int streamIdx = currentDecodingStream;
-    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
-    
-    RingBuffer* rb = streams[streamIdx].ringBuffer;
+    // The decoder pool sets the stream as the decoder's reference
+    AudioStream* s = (AudioStream*)ref;
+    if (!s || !streams) return;
+    int streamIdx = s - streams;
     
     // Check channels from decoder info
     int channels = info.nChans;
+    if (channels < 1 || channels > 2) return;
+    perfDecodeFrame(streamIdx);
     
-    // Debug: Check sample rate mismatch
-    static int lastSampleRate = 0;
-    if (info.samprate != lastSampleRate && info.samprate != 0) {
-        lastSampleRate = info.samprate;
-    }
-    if (streams[streamIdx].sampleRate == 0 && info.samprate != 0) {
-        streams[streamIdx].sampleRate = info.samprate;
-    }
-    // Handle 22.05kHz upsampling vs Normal 44.1kHz
-    if (info.samprate == 22050) {
-        // --- 22.05kHz Handling ---
-        if (channels == 2) {
-             // Stereo: Process in pairs (L, R) and duplicate the frame
-             for (size_t i = 0; i < len; i += 2) {
-                 if (i + 1 >= len) break;
-                 
-                 int16_t left = pcm_buffer[i];
-                 int16_t right = pcm_buffer[i+1];
-                 
-                 // Frame 1
-                 if (!rb->push(left)) break;
-                 if (!rb->push(right)) break;
-                 // Frame 2 (Duplicate)
-                 if (!rb->push(left)) break;
-                 if (!rb->push(right)) break;
-             }
-        } else {
-            // Mono: Duplicate sample 4 times (L1, R1, L2, R2)
-             for (size_t i = 0; i < len; i++) {
-                int16_t sample = pcm_buffer[i];
-                if (!rb->push(sample)) break; // L1
-                if (!rb->push(sample)) break; // R1
-                if (!rb->push(sample)) break; // L2
-                if (!rb->push(sample)) break; // R2
-                if (!rb->push(sample)) break; // R2
-             }
-        }
-    } else {
-        // --- Normal 44.1kHz Handling ---
-        if (channels == 1) {
-             // MONO -> STEREO (Duplicate)
-            for (size_t i = 0; i < len; i++) {
-                int16_t sample = pcm_buffer[i];
-                if (!rb->push(sample)) break; // Left
-                if (!rb->push(sample)) break; // Right
-            }
-        } else {
-             // STEREO (Pass through)
-            for (size_t i = 0; i < len; i++) {
-                rb->push(pcm_buffer[i]);
-            }
-        }
+    // Lock the stream's PCM layout on the first decoded frame.
+    // These fields are published to the mixer by the ring buffer commit below.
+    if (s->sampleRate == 0 && info.samprate != 0) {
+        s->channels = channels;
+        s->sampleRate = info.samprate;
     }
+    if (info.bitrate > 0) s->bytesPerSec = info.bitrate / 8;
+    if (s->discardFrames > 0 && !discardDecoded(s, pcm_buffer, len, channels, info.samprate)) return;
+    pushStreamPcm(s, pcm_buffer, len, channels, info.samprate);
 }
 
 // ===================================
 // AAC Decoder Callback
 // ===================================
 void aacDataCallback(AACFrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref) {
-    int streamIdx = currentDecodingStream;
-    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
-
-    RingBuffer* rb = streams[streamIdx].ringBuffer;
+    AudioStream* s = (AudioStream*)ref;
+    if (!s || !streams) return;
+    int streamIdx = s - streams;
     int channels = info.nChans;
+    if (channels < 1 || channels > 2) return;
+    perfDecodeFrame(streamIdx);
     
-    if (streams[streamIdx].sampleRate == 0 && info.sampRateOut != 0) {
-        streams[streamIdx].sampleRate = info.sampRateOut;
-    }
-    
-    // Basic Handling (Assuming 44.1kHz mostly, or letting I2S handle slight mismatch if not too far off)
-    // TODO: Add 22kHz support if needed, similar to MP3
-    
-    // Hoist channel check out of loop
-    if (channels == 1) {
-        // MONO -> STEREO (Duplicate)
-        for (size_t i = 0; i < len; i++) {
-            int16_t sample = pcm_buffer[i];
-            if (!rb->push(sample)) break; // Left
-            if (!rb->push(sample)) break; // Right
-        }
-    } else {
-         // STEREO (Pass through)
-        for (size_t i = 0; i < len; i++) {
-             rb->push(pcm_buffer[i]);
-        }
+    // Lock the stream's PCM layout on the first decoded frame (output rate,
+    // so HE-AAC/SBR reports the rate after reconstruction)
+    if (s->sampleRate == 0 && info.sampRateOut != 0) {
+        s->channels = channels;
+        s->sampleRate = info.sampRateOut;
     }
+    if (info.bitRate > 0) s->bytesPerSec = info.bitRate / 8;
+    if (s->discardFrames > 0 && !discardDecoded(s, pcm_buffer, len, channels, info.sampRateOut)) return;
+    pushStreamPcm(s, pcm_buffer, len, channels, info.sampRateOut);
 }
 
 
@@ -670,6 +686,8 @@ void aacDataCallback(AACFrameInfo &info, int16_t *pcm_buffer, size_t len, void*
 // ===================================
 void setup1() {
     // Core 1 setup
+    // Size the I2S DMA buffers to match the mixer block (one 32-bit word per stereo frame)
+    i2s.setBuffers(MIXER_DMA_BUFFERS, MIXER_BLOCK_FRAMES);
 }
 
 
@@ -678,6 +696,7 @@ void setup1() {
 // ===================================
 void loop1() {
     bool isRunning = false;
+    static uint32_t mixBlock[MIXER_BLOCK_FRAMES];
 
     while (true) {
         if (g_allowAudio) {
@@ -685,12 +704,16 @@ void loop1() {
                 i2s.begin(SAMPLE_RATE);
                 isRunning = true;
             }
-            Mixer::processSample();
+            uint32_t tStart = perfNow();
+            Mixer::processBlock(mixBlock, MIXER_BLOCK_FRAMES);
+            perfMixBlock(perfNow() - tStart);
+            Mixer::writeBlock(mixBlock, MIXER_BLOCK_FRAMES);
         } else {
             if (isRunning) {
                 i2s.end();
                 isRunning = false;
             }
+            Mixer::applyCommands();
             delay(1);
         }
     }
@@ -698,38 +721,12 @@ void loop1() {
 
 
 // ===================================
-// Start Stream Playback
+// Open Stream Source (Core 0)
 // ===================================
-bool startStream(int streamIdx, const char* filename) {
-    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return false;
-    
-    // Safety: If MSC active, block SD streams
-    // We check file type later, but checking here is cleaner if we know it isn't flash.
-    // However, we identify flash via filename prefix.
-    bool isFlash = (strncmp(filename, "/flash/", 7) == 0);
-    
-    if (g_mscActive && !isFlash) {
-        log_message(String("Stream ") + streamIdx + ": Blocked (MSC Active)");
-        return false;
-    }
-
-    // Ensure I2S is active
-    g_allowAudio = true;
-    
-    stopStream(streamIdx); // Ensure stopped first
-    
-    AudioStream* s = &streams[streamIdx];
-    
-    // Determine file type and location
-    // bool isFlash = (strncmp(filename, "/flash/", 7) == 0); // Declared at top of function
-    AudioFormat format = getAudioFormat(filename);
-    
-    // Safety check for unknown format
-    if (format == FORMAT_UNKNOWN) {
-        log_message(String("Stream ") + streamIdx + ": ERROR - Unknown audio format: " + filename);
-        return false;
-    }
-    
+// Opens `filename` on a stream for refills: file handles, M4A parser, a
+// decoder from the pool, the stream type and (WAV) its PCM layout. Used when
+// a stream starts and when a queued item takes over (stream_queue.cpp).
+bool openStreamSource(AudioStream* s, int streamIdx, const char* filename, AudioFormat format, bool isFlash) {
     if (isFlash) {
         if (format == FORMAT_MP3 || format == FORMAT_AAC || format == FORMAT_M4A) {
              // --- Compressed Audio from Flash ---
@@ -742,32 +739,10 @@ bool startStream(int streamIdx, const char* filename) {
             }
 
             // --- Decoder Setup ---
-            int decoderIdx = -1;
-            
-            if (format == FORMAT_MP3) {
-                for (int i = 0; i < maxMp3Decoders; i++) {
-                    if (!mp3DecoderInUse[i]) {
-                        decoderIdx = i;
-                        mp3DecoderInUse[i] = true;
-                        break;
-                    }
-                }
-                if (decoderIdx != -1) {
-                    s->type = STREAM_TYPE_MP3_FLASH;
-                    if (mp3Decoders[decoderIdx]) mp3Decoders[decoderIdx]->begin();
-                }
-            } else {
-                 for (int i = 0; i < maxMp3Decoders; i++) {
-                    if (!aacDecoderInUse[i]) {
-                        decoderIdx = i;
-                        aacDecoderInUse[i] = true;
-                        break;
-                    }
-                }
-                if (decoderIdx != -1) {
-                    s->type = STREAM_TYPE_AAC_FLASH;
-                    if (aacDecoders[decoderIdx]) aacDecoders[decoderIdx]->begin();
-                }
+            int decoderIdx = acquireDecoder(format == FORMAT_MP3 ? DECODER_MP3 : DECODER_AAC, s);
+            if (decoderIdx != -1) {
+                s->type = (format == FORMAT_MP3) ? STREAM_TYPE_MP3_FLASH : STREAM_TYPE_AAC_FLASH;
+                restartDecoder(decoderIdx);
             }
             
             if (decoderIdx == -1) {
@@ -793,11 +768,29 @@ bool startStream(int streamIdx, const char* filename) {
                 return false;
             }
             
+            // IMA-ADPCM (stored by the sync with #BANK1_ADPCM)
+            WavLayout layout;
+            if (readWavLayout(s->flashFile, layout, true) && layout.blockAlign) {
+                s->dataStart = layout.dataStart;
+                s->dataSize = layout.dataSize;
+                s->channels = layout.channels;
+                s->sampleRate = layout.sampleRate;
+                s->adpcmBlockAlign = layout.blockAlign;
+                s->adpcmSamplesPerBlock = layout.samplesPerBlock;
+                s->adpcmFrames = layout.frames;
+                s->adpcmFramesLeft = layout.frames;
+                s->type = STREAM_TYPE_ADPCM_FLASH;
+                mutex_exit(&flash_mutex);
+                return true;
+            }
+            
             // Read Header & Find Data Chunk
             WAVHeader header;
+            s->flashFile.seek(0);
             s->flashFile.read((uint8_t*)&header, sizeof(WAVHeader));
             
             // Check for "data" chunk (basic check)
+            s->dataSize = header.dataSize;
             if (strncmp(header.data, "data", 4) != 0) {
                 s->flashFile.seek(12);
                 char chunkID[4];
@@ -808,12 +801,14 @@ bool startStream(int streamIdx, const char* filename) {
                     s->flashFile.read((uint8_t*)&chunkSize, 4);
                     
                     if (strncmp(chunkID, "data", 4) == 0) {
+                        s->dataSize = chunkSize;
                         break; 
                     } else {
                         s->flashFile.seek(s->flashFile.position() + chunkSize);
                     }
                 }
             }
+            s->dataStart = s->flashFile.position();
             
             s->channels = header.numChannels;
             s->sampleRate = header.sampleRate;
@@ -824,11 +819,11 @@ bool startStream(int streamIdx, const char* filename) {
         }
     } else {
         // --- SD Card File ---
-        mutex_enter_blocking(&sd_mutex);
+        sdIoBegin(SD_IO_STREAM);
         s->sdFile = sd.open(filename, FILE_READ);
         if (!s->sdFile) {
             log_message(String("Stream ") + streamIdx + ": ERROR - Could not open SD file");
-            mutex_exit(&sd_mutex);
+            sdIoEnd();
             return false;
         }
         
@@ -843,7 +838,7 @@ bool startStream(int streamIdx, const char* filename) {
                 if (!s->mp4Parser.open(filename, false)) { // false = SD
                     log_message(String("Stream ") + streamIdx + ": ERROR - Failed to parse M4A");
                     s->sdFile.close();
-                    mutex_exit(&sd_mutex);
+                    sdIoEnd();
                     return false;
                 }
                 detectedType = STREAM_TYPE_M4A_SD;
@@ -853,48 +848,27 @@ bool startStream(int streamIdx, const char* filename) {
                 detectedType = STREAM_TYPE_AAC_SD;
             }
             
-            // Allocate Decoder
-            if (format == FORMAT_MP3) {
-                 for (int i = 0; i < maxMp3Decoders; i++) {
-                    if (!mp3DecoderInUse[i]) {
-                        decoderIdx = i;
-                        mp3DecoderInUse[i] = true;
-                        break;
-                    }
-                }
-            } else {
-                 // AAC or M4A
-                 for (int i = 0; i < maxMp3Decoders; i++) {
-                    if (!aacDecoderInUse[i]) {
-                        decoderIdx = i;
-                        aacDecoderInUse[i] = true;
-                        break;
-                    }
-                }
-            }
+            // Allocate Decoder (AAC for M4A too)
+            decoderIdx = acquireDecoder(format == FORMAT_MP3 ? DECODER_MP3 : DECODER_AAC, s);
             
             if (decoderIdx == -1) {
                 log_message(String("Stream ") + streamIdx + ": ERROR - No decoders available");
                 if (detectedType == STREAM_TYPE_M4A_SD) s->mp4Parser.close();
                 s->sdFile.close();
-                mutex_exit(&sd_mutex);
+                sdIoEnd();
                 return false;
             }
             
             s->type = detectedType;
             s->decoderIndex = decoderIdx;
+            restartDecoder(decoderIdx);
             
-            if (format == FORMAT_MP3) {
-                 if (mp3Decoders[decoderIdx]) mp3Decoders[decoderIdx]->begin();
-            } else {
-                 if (aacDecoders[decoderIdx]) aacDecoders[decoderIdx]->begin();
-            }
-            
+            // PCM layout is locked by the decoder callback on the first frame
             s->channels = 2; 
             s->sampleRate = 0; 
+            s->bytesPerSec = DEFAULT_COMPRESSED_BYTES_PER_SEC; // Refined from the decoded bitrate
             if (detectedType == STREAM_TYPE_M4A_SD) {
-                s->sampleRate = s->mp4Parser.getSampleRate();
-                s->channels = s->mp4Parser.getChannels();
+                log_message(String("  M4A Track: Rate: ") + s->mp4Parser.getSampleRate() + "Hz, Ch: " + s->mp4Parser.getChannels());
             }
  
             
@@ -904,6 +878,7 @@ bool startStream(int streamIdx, const char* filename) {
             WAVHeader header;
             s->sdFile.read((uint8_t*)&header, sizeof(WAVHeader));
             
+            s->dataSize = header.dataSize;
             if (strncmp(header.data, "data", 4) != 0) {
                 s->sdFile.seek(12);
                 char chunkID[4];
@@ -914,12 +889,14 @@ bool startStream(int streamIdx, const char* filename) {
                     s->sdFile.read((uint8_t*)&chunkSize, 4);
                     
                     if (strncmp(chunkID, "data", 4) == 0) {
+                        s->dataSize = chunkSize;
                         break; 
                     } else {
                         s->sdFile.seek(s->sdFile.position() + chunkSize);
                     }
                 }
             }
+            s->dataStart = s->sdFile.position();
             
             s->channels = header.numChannels;
             s->sampleRate = header.sampleRate;
@@ -927,38 +904,139 @@ bool startStream(int streamIdx, const char* filename) {
             
             s->type = STREAM_TYPE_WAV_SD;
             s->decoderIndex = -1;
+            s->bytesPerSec = s->sampleRate * s->channels * 2;
         }
-        mutex_exit(&sd_mutex);
+        sdIoEnd();
+    }
+    return true;
+}
+
+
+// ===================================
+// Start Stream Playback
+// ===================================
+bool startStream(int streamIdx, const char* filename, uint32_t startMs) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return false;
+    
+    // Safety: If MSC active, block SD streams
+    // We check file type later, but checking here is cleaner if we know it isn't flash.
+    // However, we identify flash via filename prefix.
+    bool isFlash = (strncmp(filename, "/flash/", 7) == 0);
+    
+    if (g_mscActive && !isFlash) {
+        log_message(String("Stream ") + streamIdx + ": Blocked (MSC Active)");
+        return false;
+    }
+
+    // Ensure I2S is active
+    g_allowAudio = true;
+    
+    stopStream(streamIdx); // Ensure stopped first
+    
+    AudioStream* s = &streams[streamIdx];
+    
+    // Determine file type and location
+    // bool isFlash = (strncmp(filename, "/flash/", 7) == 0); // Declared at top of function
+    AudioFormat format = getAudioFormat(filename);
+    
+    // Safety check for unknown format
+    if (format == FORMAT_UNKNOWN) {
+        log_message(String("Stream ") + streamIdx + ": ERROR - Unknown audio format: " + filename);
+        return false;
+    }
+    
+    // --- RAM-resident Bank 1 ---
+    // Played by the mixer straight from the arena: no file, ring or refill
+    if (startRamStream(s, filename, startMs)) {
+        strncpy(s->filename, filename, sizeof(s->filename) - 1);
+        resamplerReset(&s->resampler);
+        s->openPending = false;
+        s->discardFrames = 0;
+        s->active = true;
+        s->startTime = millis();
+        mixerStart(streamIdx, s->volume, MIXER_FADE_IN_MS);
+        log_message(String("Stream ") + streamIdx + ": Playing " + filename + " from RAM (" + s->ramFrames + " frames, Ch: " + s->channels + ")");
+        return true;
+    }
+    
+    // --- Warm Cache (Bank 1 WAV) ---
+    // Layout comes from the cache and the file is opened on the first refill,
+    // so the stream goes active without touching the filesystem.
+    WarmCacheHit warm;
+    bool warmHit = (format == FORMAT_WAV && startMs == 0 && warmCacheLookup(filename, warm));
+    s->openPending = false;
+    
+    if (warmHit) {
+        s->type = isFlash ? STREAM_TYPE_WAV_FLASH : STREAM_TYPE_WAV_SD;
+        s->decoderIndex = -1;
+        s->channels = warm.channels;
+        s->sampleRate = warm.sampleRate;
+        s->dataStart = warm.dataStart;
+        s->dataSize = warm.dataSize;
+        s->bytesPerSec = s->sampleRate * s->channels * 2;
+        s->openPending = true;
+        s->openPos = warm.dataStart + warm.pcmBytes;
+        if (warm.blockAlign) {
+            // Cached PCM is whole blocks, the file picks up at the next one
+            uint32_t cached = warm.pcmBytes / (warm.channels * 2);
+            uint32_t blocks = (cached + warm.samplesPerBlock - 1) / warm.samplesPerBlock;
+            s->type = STREAM_TYPE_ADPCM_FLASH;
+            s->adpcmBlockAlign = warm.blockAlign;
+            s->adpcmSamplesPerBlock = warm.samplesPerBlock;
+            s->adpcmFrames = warm.frames;
+            s->adpcmFramesLeft = (warm.frames > cached) ? warm.frames - cached : 0;
+            s->openPos = warm.dataStart + blocks * warm.blockAlign;
+        }
+    } else if (!openStreamSource(s, streamIdx, filename, format, isFlash)) {
+        return false;
     }
     
     strncpy(s->filename, filename, sizeof(s->filename) - 1);
     s->ringBuffer->clear();
-    s->active = true;
+    resamplerReset(&s->resampler);
+    s->stagingLen = 0;
+    s->stagingPos = 0;
     s->fileFinished = false;
+    s->startOffsetMs = 0;
+    s->playedFrames = 0;
+    s->joinFrames = 0;
+    s->discardFrames = 0;
+    
+    // Start Offset (before the mixer sees the stream)
+    if (startMs > 0 && !seekStreamFile(s, startMs)) {
+        log_message(String("Stream ") + streamIdx + ": Can't seek to " + startMs + "ms, playing from start");
+    }
+    
+    // Cached head goes in before the mixer sees the stream
+    if (warmHit && warm.pcm) {
+        pushPcm(s->ringBuffer, warm.pcm, warm.pcmBytes / 2, s->channels, s->channels);
+    }
+    
+    s->active = true;
     s->startTime = millis(); // Log start time
+    mixerStart(streamIdx, s->volume, MIXER_FADE_IN_MS);
     
-    log_message(String("Stream ") + streamIdx + ": Playing " + filename + " (Start: " + s->startTime + "ms)");
+    log_message(String("Stream ") + streamIdx + ": Playing " + filename + " (Start: " + s->startTime + "ms, Offset: " + s->startOffsetMs + "ms)");
     
-    if (format == FORMAT_MP3 || format == FORMAT_AAC || format == FORMAT_M4A) {
+    if (warmHit) {
+        log_message(String("  Format: ") + (warm.blockAlign ? "IMA-ADPCM" : "WAV") + " (warm cache, " + warm.pcmBytes + " bytes), Rate: " + s->sampleRate + "Hz, Ch: " + s->channels);
+    } else if (s->type == STREAM_TYPE_ADPCM_FLASH) {
+        log_message(String("  Format: IMA-ADPCM, Rate: ") + s->sampleRate + "Hz, Ch: " + s->channels + ", Align: " + s->adpcmBlockAlign);
+    } else if (format == FORMAT_MP3 || format == FORMAT_AAC || format == FORMAT_M4A) {
         log_message(String("  Format: Compressed, Rate: ") + (s->sampleRate > 0 ? String(s->sampleRate) : "Unknown") + "Hz, Ch: " + s->channels);
     } else {
         // Read details for WAV debugging
         uint16_t bits = 0;
         uint16_t align = 0;
         if (s->type == STREAM_TYPE_WAV_SD) {
-             mutex_enter_blocking(&sd_mutex);
+             sdIoBegin(SD_IO_STREAM);
              if (s->sdFile) {
-                 s->sdFile.seek(34); // bitsPerSample
-                 s->sdFile.read(&bits, 2);
-                 s->sdFile.seek(32); // blockAlign
-                 s->sdFile.read(&align, 2);
-                 s->sdFile.seek(44);
-                 uint32_t pos = s->sdFile.position();
+                 uint32_t pos = s->sdFile.position(); // Data start or the seek target
                  s->sdFile.seek(34); s->sdFile.read(&bits, 2);
                  s->sdFile.seek(32); s->sdFile.read(&align, 2);
                  s->sdFile.seek(pos);
              }
-             mutex_exit(&sd_mutex);
+             sdIoEnd();
         } else if (s->type == STREAM_TYPE_WAV_FLASH) {
              mutex_enter_blocking(&flash_mutex);
              if (s->flashFile) {
@@ -976,30 +1054,80 @@ bool startStream(int streamIdx, const char* filename) {
 
 
 // ===================================
-// Stop Stream Playback
+// Take a Stream off the Mixer (Core 0)
 // ===================================
-void stopStream(int streamIdx) {
-    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
+// Fades the stream out over `fadeMs` and returns once Core 1 has stopped
+// reading it, so its ring can be cleared. The wait is bounded; a mixer that
+// doesn't finish the fade in time is stopped outright. While audio is off
+// nothing renders the fade, so the stream is cut.
+static void takeOffMixer(int streamIdx, uint32_t fadeMs) {
+    if (!g_allowAudio) fadeMs = 0;
+    mixerSync(mixerStop(streamIdx, fadeMs));
+    if (fadeMs == 0) return;
+    
+    uint32_t t0 = millis();
+    while (mixerVoiceActive(streamIdx)) {
+        if (millis() - t0 > fadeMs + MIXER_SYNC_TIMEOUT_MS) {
+            mixerSync(mixerStop(streamIdx));
+            break;
+        }
+        delayMicroseconds(100);
+    }
+}
+
+// ===================================
+// Seek Stream (Core 0)
+// ===================================
+// Jumps a playing stream to `ms`. The stream is taken off the mixer (and
+// Core 1 has let go of its ring) before the ring is cleared, then refilled
+// from the new position and restarted with the usual fade-in.
+bool seekStream(int streamIdx, uint32_t ms) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return false;
     AudioStream* s = &streams[streamIdx];
+    if (!s->active) return false;
     
-    if (!s->active && s->type == STREAM_TYPE_INACTIVE) return;
+    takeOffMixer(streamIdx, MIXER_STOP_FADE_MS);
+    s->fadingOut = false;
+    s->xfadeLen = 0; // Overlap goes with the ring
+    s->xfadeDone = 0;
+    s->joinFrames = 0;
     
-    s->active = false;
+    bool ok = true;
+    if (s->type == STREAM_TYPE_PCM_RAM) {
+        seekRamStream(s, ms);
+    } else {
+        s->ringBuffer->clear();
+        resamplerReset(&s->resampler);
+        if (s->openPending) openPendingFile(s, streamIdx);
+        ok = seekStreamFile(s, ms);
+    }
+    
+    s->startTime = millis();
+    mixerStart(streamIdx, s->volume, MIXER_FADE_IN_MS);
     
-    // Release Decoder
+    if (ok) log_message(String("Stream ") + streamIdx + ": Seek to " + ms + "ms");
+    else log_message(String("Stream ") + streamIdx + ": Seek to " + ms + "ms failed, restarted");
+    return ok;
+}
+
+// Current playback position in the file (ms), from what the mixer has consumed
+uint32_t streamPositionMs(AudioStream* s) {
+    if (!s->active || s->sampleRate == 0) return s->startOffsetMs;
+    uint32_t played = s->playedFrames;
+    played = (played > s->joinFrames) ? played - s->joinFrames : 0; // Queued file not reached yet: 0
+    return s->startOffsetMs + (uint32_t)(((uint64_t)played * 1000) / s->sampleRate);
+}
+
+
+// ===================================
+// Close Stream Source (Core 0)
+// ===================================
+// Gives the stream's decoder back to the pool and closes its files. The ring
+// and mixer state are left alone.
+void closeStreamSource(AudioStream* s) {
+    // Release Decoder (kept in the pool for the next stream of its kind)
     if (s->decoderIndex != -1) {
-        if (s->type == STREAM_TYPE_MP3_SD || s->type == STREAM_TYPE_MP3_FLASH) {
-            if (mp3Decoders[s->decoderIndex]) {
-                mp3Decoders[s->decoderIndex]->end();
-            }
-            mp3DecoderInUse[s->decoderIndex] = false;
-        } else if (s->type == STREAM_TYPE_AAC_SD || s->type == STREAM_TYPE_AAC_FLASH || 
-                   s->type == STREAM_TYPE_M4A_SD || s->type == STREAM_TYPE_M4A_FLASH) {
-            if (aacDecoders[s->decoderIndex]) {
-                aacDecoders[s->decoderIndex]->end();
-            }
-            aacDecoderInUse[s->decoderIndex] = false;
-        }
+        releaseDecoder(s->decoderIndex);
         s->decoderIndex = -1;
     }
     
@@ -1009,20 +1137,109 @@ void stopStream(int streamIdx) {
          // Parser closes the file handles
     } else {
         // Raw Files (WAV/MP3/AAC)
-        if (s->type == STREAM_TYPE_WAV_FLASH || s->type == STREAM_TYPE_MP3_FLASH || s->type == STREAM_TYPE_AAC_FLASH) {
+        if (s->type == STREAM_TYPE_WAV_FLASH || s->type == STREAM_TYPE_ADPCM_FLASH ||
+            s->type == STREAM_TYPE_MP3_FLASH || s->type == STREAM_TYPE_AAC_FLASH) {
             mutex_enter_blocking(&flash_mutex);
             if (s->flashFile) s->flashFile.close();
             mutex_exit(&flash_mutex);
         } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD || s->type == STREAM_TYPE_AAC_SD) {
-            mutex_enter_blocking(&sd_mutex);
+            sdIoBegin(SD_IO_STREAM);
             if (s->sdFile) s->sdFile.close();
-            mutex_exit(&sd_mutex);
+            sdIoEnd();
         }
     }
     
     s->type = STREAM_TYPE_INACTIVE;
+}
+
+
+// ===================================
+// Stop Stream Playback
+// ===================================
+void stopStream(int streamIdx, uint32_t fadeMs) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
+    AudioStream* s = &streams[streamIdx];
+    
+    if (!s->active && s->type == STREAM_TYPE_INACTIVE) return;
+    
+    // Core 1 must be done with the ring before it is cleared below
+    s->active = false;
+    s->fadingOut = false;
+    takeOffMixer(streamIdx, fadeMs);
+    
+    closeStreamSource(s);
+    resetStreamQueue(s);
+    s->openPending = false;
     s->ringBuffer->clear();
     
     uint32_t duration = millis() - s->startTime;
     log_message(String("Stream ") + streamIdx + ": Stopped (Duration: " + duration + "ms)");
-}
\ No newline at end of file
+}
+
+
+// ===================================
+// Fade Out, then Stop (Core 0)
+// ===================================
+// Starts a fade-out and returns; the stream keeps playing (and refilling)
+// under it and is stopped from fillStreamBuffers() once Core 1 has faded it
+// to silence. Whatever was queued on the stream is dropped.
+void fadeOutStream(int streamIdx, uint32_t fadeMs) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
+    AudioStream* s = &streams[streamIdx];
+    if (!s->active) return;
+    if (fadeMs == 0 || !g_allowAudio) {
+        stopStream(streamIdx);
+        return;
+    }
+    
+    resetStreamQueue(s);
+    s->fadingOut = true;
+    mixerStop(streamIdx, fadeMs);
+    log_message(String("Stream ") + streamIdx + ": Fading out (" + fadeMs + "ms)");
+}
+
+// ===================================
+// Set Stream Volume (Core 0)
+// ===================================
+// Ramps to the new volume over MIXER_GAIN_RAMP_MS. A longer fade in progress
+// (e.g. the start fade-in) carries on to the new volume instead.
+void setStreamVolume(int streamIdx, float volume) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
+    streams[streamIdx].volume = volume;
+    mixerSetGain(streamIdx, volume);
+}
+
+
+// ===================================
+// Append File to Stream (Core 0)
+// ===================================
+// Continues a finished SD WAV stream with the PCM of another file of the same
+// layout, so it follows the last sample already in the ring with no gap or
+// fade-in. Returns false (stream left finished) if the file is missing or its
+// channels / rate differ.
+bool appendStreamFile(int streamIdx, const char* filename) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return false;
+    AudioStream* s = &streams[streamIdx];
+    if (!s->active || !s->fileFinished || s->type != STREAM_TYPE_WAV_SD) return false;
+    
+    WavLayout layout;
+    sdIoBegin(SD_IO_STREAM);
+    if (s->sdFile) s->sdFile.close();
+    s->sdFile = sd.open(filename, FILE_READ);
+    bool ok = s->sdFile && readWavLayout(s->sdFile, layout) &&
+              layout.channels == s->channels && layout.sampleRate == s->sampleRate;
+    if (!ok && s->sdFile) s->sdFile.close();
+    sdIoEnd();
+    if (!ok) return false;
+    
+    strncpy(s->filename, filename, sizeof(s->filename) - 1);
+    s->filename[sizeof(s->filename) - 1] = '\0';
+    s->dataStart = layout.dataStart;
+    s->dataSize = layout.dataSize;
+    s->stagingLen = 0;
+    s->stagingPos = 0;
+    s->fileFinished = false;
+    
+    log_message(String("Stream ") + streamIdx + ": Appended " + filename);
+    return true;
+}
@@ -37,6 +37,10 @@ using namespace libhelix;
 #define PIN_BTN_FWD 16 // Next
 #define PIN_BTN_REV 18 // Prev
 
+// Runtime Profiling (PERF command), 0 compiles the hooks out
+#define PERF_ENABLE 1
+#define PERF_HIST_BINS 16 // Power-of-two latency bins, the last one holds >= 32ms
+
 // Development Mode
 #define DEV_MODE true
 #define DEV_SYNC_LIMIT 100
@@ -47,10 +51,106 @@ using namespace libhelix;
 #define DEFAULT_MAX_STREAMS 3
 #define DEFAULT_STREAM_BUFFER_KB 512
 
+// Mixer Configuration (Core 1)
+#define MIXER_BLOCK_FRAMES 128 // Stereo frames rendered per mixer block (64-256)
+#define MIXER_DMA_BUFFERS 3    // I2S DMA buffers, each holding one mixer block
+#define MIXER_QUEUE_SIZE 32    // Core 0 -> Core 1 commands in flight (power of 2)
+#define MIXER_FADE_IN_MS 50    // Ramp at stream start/seek, prevents pops
+#define MIXER_STOP_FADE_MS 5   // De-click ramp when a stream is stopped
+#define MIXER_GAIN_RAMP_MS 10  // Ramp for volume changes
+#define MIXER_FADE_MAX_MS 10000 // Longest fade (STOP fade-out, FADE)
+#define MIXER_SYNC_TIMEOUT_MS 20 // Longest Core 0 waits on the mixer
+#define RESAMPLER_TAPS 8       // Polyphase resampler FIR length (even)
+
+// Synth (CHRP / SYN tones, rendered on Core 1)
+#define SYNTH_VOICES 6         // Notes sounding at once
+#define SYNTH_PATCHES 8        // SYNP slots
+#define SYNTH_SEQUENCES 4      // SYN sequences playing at once
+#define SYNTH_MAX_STEPS 32     // Notes / rests per sequence
+
+// M4A Sample Table Cache (entries per PSRAM window, per stream)
+#define MP4_STSZ_WINDOW 2048 // 8KB, ~46s of 44.1kHz AAC per window
+#define MP4_STCO_WINDOW 512  // 2KB
+#define MP4_STSC_WINDOW 128  // 1.5KB (12 bytes per entry)
+
+// SD Streaming
+#define STREAM_STAGING_SIZE (16 * 1024) // Per-stream SD staging buffer in PSRAM (max read size)
+#define SD_READ_MIN_BYTES 4096           // Smallest staged SD read
+#define DEFAULT_COMPRESSED_BYTES_PER_SEC 40000 // 320kbps, until the decoder reports the bitrate
+
+// MP3 Frame Feed (Core 0)
+#define MP3_FRAMES_PER_STEP 4      // Whole frames handed to the decoder per refill step
+#define MP3_MAX_FRAME_BYTES 1448   // Largest Layer III frame (320kbps at 32kHz, 160kbps at 8kHz) + padding
+#define MP3_FLASH_READ_BYTES 4096  // Staging refill size for flash MP3 streams
+#define MP3_SKIP_BYTES_PER_STEP 4096 // Non-frame data (tags) passed through per step
+
+// SD I/O Service (Core 0): lower-priority work yields to SD streams with less than this buffered
+#define SD_IO_FILE_YIELD_MS 100  // INI, voice prompts, warm cache
+#define SD_IO_BULK_YIELD_MS 250  // Flash sync copies, CRCs, RAM bank load
+#define SD_IO_SCAN_YIELD_MS 500  // Directory walks
+#define SD_IO_SLICE_BYTES 8192   // Longest single read below stream priority
+#define SD_IO_MSC_SLICE_US 4000  // Card time per loop() pass for USB host transfers (MSC mode)
+
+// MSC Mode (Core 0)
+#define MSC_BATCH_SECTORS 16     // Sectors per card command (read-ahead and write-combining)
+#define MSC_WRITE_IDLE_MS 20     // Combined writes still waiting are written after this
+
+// Voice Feedback (Core 0)
+#define VOICE_STREAM 0        // Stream the /0_System prompts play on
+#define VOICE_QUEUE_SIZE 96   // Queued clips and pauses
+#define VOICE_LEAD_IN_MS 120  // Wait after unmuting before the first clip (prevents a pop)
+
+// Stream Allocation (Core 0)
+#define STREAM_STEAL_FADE_MS 15 // Fade-out of a stream taken for a new sound
+
+// Stream Queue (Core 0)
+#define STREAM_XFADE_MAX_MS 10000 // Longest QUEUE crossfade
+#define STREAM_XFADE_GUARD_MS 50  // Crossfade stays this far ahead of the mixer's read position
+#define STREAM_XFADE_STEPS 256    // Equal-power curve table resolution
+
+// Refill Scheduler (Core 0)
+#define REFILL_BUDGET_US 3000  // Max time fillStreamBuffers() spends per loop (checked between steps)
+#define REFILL_BURST_STEPS 4   // Decode steps given to the most urgent stream per round
+#define REFILL_MAX_ROUNDS 8    // Ranking rounds per loop
+#define REFILL_URGENT_MS 250   // Below this much buffered audio, non-audio work backs off
+#define REFILL_IDLE_MS 60000   // Urgency reported when nothing is streaming
+
+// Warm Cache (Bank 1 trigger latency)
+#define DEFAULT_WARM_CACHE_KB 128 // PSRAM for cached PCM heads (#WARM_CACHE_KB), 0 = off
+#define WARM_CACHE_MS 100         // PCM cached per variant (at 44.1kHz stereo)
+
+// RAM-resident Bank 1 (#BANK1_RAM)
+#define BANK1_RAM_RESERVE (256 * 1024) // PSRAM left free after loading the arena
+
+// IMA-ADPCM Bank 1 in Flash (#BANK1_ADPCM)
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+#define ADPCM_BLOCK_BYTES 512       // Per channel, for files the sync encodes
+#define ADPCM_BLOCK_FRAMES 1017     // Frames in one of those blocks
+#define ADPCM_HEADER_BYTES 60       // RIFF + fmt + fact + data headers the sync writes
+#define ADPCM_MAX_BLOCK_ALIGN 2048  // Largest block a stream accepts
+#define ADPCM_MAX_BLOCK_SAMPLES 4096 // Decoded samples in such a block (4089 mono)
+
+// Bank 1 Flash Sync
+#define FLASH_MANIFEST_PATH "/flash.man" // Outside /flash so pruning never removes it
+#define FLASH_MANIFEST_MAGIC 0x324E4D43  // "CMN2"
+#define SYNC_STEP_BYTES 4096             // Read/written per sync step, one LittleFS block
+#define SYNC_QUIET_MS 300                // Silence before the sync writes flash
+#define SYNC_STEP_BUDGET_US 2000         // Sync steps per loop() pass, at most
+#define SYNC_SAVE_EVERY 16               // Copies between manifest saves
+
 // Bank/File Limits
 #define MAX_SOUNDS 100
-#define MAX_SD_BANKS 20
-#define MAX_FILES_PER_BANK 100
+#define MAX_SD_BANKS (5 * 27)      // Banks 2-6, each unpaged or pages A-Z
+#define MAX_LIBRARY_FILES 4096     // Bank 1 variants + Bank 2-6 files, all banks together
+#define NAME_POOL_SIZE (64 * 1024) // Packed filenames (PSRAM)
+#define BANK1_NAME_MAX 31          // Bank 1 filenames are also /flash names
+#define SD_NAME_MAX 63
+
+// SD Card Index (boot scan cache)
+#define SD_INDEX_PATH "/CHIRP.IDX"
+#define SD_INDEX_MAGIC 0x58444943 // "CIDX"
+#define SD_INDEX_VERSION 2
+#define SD_INDEX_MAX_FOLDERS (MAX_SD_BANKS + 1) // Banks 2-6 plus the active Bank 1 page
 
 // Outgoing Serial Message Queue
 #define SERIAL2_QUEUE_SIZE 16
@@ -75,9 +175,22 @@ struct WAVHeader {
     uint32_t dataSize;
 };
 
+// PCM layout of a WAV file (from readWavLayout)
+struct WavLayout {
+    uint8_t channels;
+    uint32_t sampleRate;
+    uint32_t dataStart;  // File offset of the first PCM byte
+    uint32_t dataSize;   // Bytes in the data chunk
+    uint16_t blockAlign; // IMA-ADPCM block bytes, 0 for 16-bit PCM
+    uint16_t samplesPerBlock; // IMA-ADPCM frames per block
+    uint32_t frames;     // Frames of audio (decoded, for IMA-ADPCM)
+};
+
+// Filenames live in the name pool (sd_index.cpp); banks hold a range of
+// its name table. Use bank1Variant() / sdBankFile() to read them.
 struct SoundFile {
     char basename[16];
-    char variants[25][32];
+    uint16_t firstVariant;
     int variantCount;
     int lastVariantPlayed; // For non-repeating random
 };
@@ -86,7 +199,7 @@ struct SDBank {
     uint8_t bankNum;
     char page;
     char dirName[32];
-    char files[MAX_FILES_PER_BANK][64];
+    uint16_t firstFile;
     int fileCount;
 };
 
@@ -112,7 +225,7 @@ extern SdFat sd;
 extern I2S i2s;
 
 // Thread Safety
-extern mutex_t sd_mutex;
+extern mutex_t sd_mutex; // Only taken by sd_io.cpp, use sdIoBegin()/sdIoRead()
 extern mutex_t flash_mutex;
 extern mutex_t log_mutex;
 
@@ -144,9 +257,6 @@ extern volatile int16_t masterAttenMultiplier;
 #define TEST_TONE_FREQ 440
 #define PHASE_INCREMENT ((uint32_t)TEST_TONE_FREQ << 16) / SAMPLE_RATE
 
-// MP3 Decoder
-extern MP3DecoderHelix* mp3Decoder;
-
 // Configuration
 extern long baudRate;
 
@@ -172,7 +282,6 @@ extern bool legacyMonophonic;
 
 // Global Configuration Variables
 extern int maxStreams;
-extern int maxMp3Decoders;
 extern int streamBufferSize; // Size in SAMPLES (not bytes)
 extern int streamBufferMask; // Mask for bitwise wrapping (size - 1)
 
@@ -185,7 +294,9 @@ enum StreamType {
     STREAM_TYPE_AAC_SD,
     STREAM_TYPE_AAC_FLASH,
     STREAM_TYPE_M4A_SD,
-    STREAM_TYPE_M4A_FLASH
+    STREAM_TYPE_M4A_FLASH,
+    STREAM_TYPE_ADPCM_FLASH, // IMA-ADPCM WAV in flash (#BANK1_ADPCM)
+    STREAM_TYPE_PCM_RAM    // Bank 1 clip in the PSRAM arena (#BANK1_RAM)
 };
 
 enum AudioFormat {
@@ -197,6 +308,10 @@ enum AudioFormat {
     FORMAT_OGG
 };
 
+// Single-producer (Core 0) / single-consumer (Core 1) ring of int16 samples.
+// The producer owns writePos and the consumer owns readPos. Each side loads
+// the other's position with acquire and publishes its own with release, so
+// sample data written before a commit is visible to the other core.
 struct RingBuffer {
     int16_t* buffer; // Pointer to PSRAM
     volatile int readPos;
@@ -205,36 +320,102 @@ struct RingBuffer {
     // Helper to get available write space
     int availableForWrite() {
         if (!buffer) return 0;
-        int currentLevel = (writePos - readPos + streamBufferSize) & streamBufferMask;
+        int r = __atomic_load_n(&readPos, __ATOMIC_ACQUIRE);
+        int w = __atomic_load_n(&writePos, __ATOMIC_ACQUIRE);
+        int currentLevel = (w - r + streamBufferSize) & streamBufferMask;
         return (streamBufferSize - 1) - currentLevel;
     }
     
     // Helper to get available samples to read
     int availableForRead() {
         if (!buffer) return 0;
-        return (writePos - readPos + streamBufferSize) & streamBufferMask;
+        int r = __atomic_load_n(&readPos, __ATOMIC_ACQUIRE);
+        int w = __atomic_load_n(&writePos, __ATOMIC_ACQUIRE);
+        return (w - r + streamBufferSize) & streamBufferMask;
     }
     
     bool push(int16_t sample) {
         if (!buffer) return false;
         
         int nextWrite = (writePos + 1) & streamBufferMask;
-        if (nextWrite == readPos) {
+        if (nextWrite == __atomic_load_n(&readPos, __ATOMIC_ACQUIRE)) {
             // Buffer Full - Drop sample
             return false;
         }
         
         buffer[writePos] = sample;
-        writePos = nextWrite;
+        __atomic_store_n(&writePos, nextWrite, __ATOMIC_RELEASE);
         return true;
     }
     
     int16_t pop() {
         if (!buffer) return 0;
         int16_t sample = buffer[readPos];
-        readPos = (readPos + 1) & streamBufferMask;
+        __atomic_store_n(&readPos, (readPos + 1) & streamBufferMask, __ATOMIC_RELEASE);
         return sample;
     }
+
+    // --- Bulk Span API ---
+    // beginWrite() reserves up to `count` samples of free space and returns it
+    // as two spans: the second one is only non-empty when the reservation wraps
+    // past the end of the buffer. Fill both spans, then publish the samples
+    // with a single commitWrite(). Returns the number of samples reserved.
+    int beginWrite(int count, int16_t*& first, int& firstLen, int16_t*& second, int& secondLen) {
+        int space = availableForWrite();
+        if (count > space) count = space;
+        if (count < 0) count = 0;
+        int w = writePos;
+        int tail = streamBufferSize - w;
+        firstLen = (count < tail) ? count : tail;
+        secondLen = count - firstLen;
+        first = buffer + w;
+        second = buffer;
+        return count;
+    }
+
+    void commitWrite(int count) {
+        __atomic_store_n(&writePos, (writePos + count) & streamBufferMask, __ATOMIC_RELEASE);
+    }
+
+    // Consumer-side equivalent of beginWrite()/commitWrite().
+    int beginRead(int count, const int16_t*& first, int& firstLen, const int16_t*& second, int& secondLen) {
+        int avail = availableForRead();
+        if (count > avail) count = avail;
+        if (count < 0) count = 0;
+        int r = readPos;
+        int tail = streamBufferSize - r;
+        firstLen = (count < tail) ? count : tail;
+        secondLen = count - firstLen;
+        first = buffer + r;
+        second = buffer;
+        return count;
+    }
+
+    void commitRead(int count) {
+        __atomic_store_n(&readPos, (readPos + count) & streamBufferMask, __ATOMIC_RELEASE);
+    }
+
+    // Copies up to `count` samples in with one commit. Returns samples written.
+    int write(const int16_t* src, int count) {
+        int16_t* a; int16_t* b; int na, nb;
+        int n = beginWrite(count, a, na, b, nb);
+        if (n == 0) return 0;
+        memcpy(a, src, na * sizeof(int16_t));
+        if (nb) memcpy(b, src + na, nb * sizeof(int16_t));
+        commitWrite(n);
+        return n;
+    }
+
+    // Copies up to `count` samples out with one commit. Returns samples read.
+    int read(int16_t* dst, int count) {
+        const int16_t* a; const int16_t* b; int na, nb;
+        int n = beginRead(count, a, na, b, nb);
+        if (n == 0) return 0;
+        memcpy(dst, a, na * sizeof(int16_t));
+        if (nb) memcpy(dst + na, b, nb * sizeof(int16_t));
+        commitRead(n);
+        return n;
+    }
     
     void clear() {
         readPos = 0;
@@ -245,15 +426,49 @@ struct RingBuffer {
     }
 };
 
+// ===================================
+// Resampler
+// ===================================
+enum ResamplerQuality {
+    RESAMPLER_LINEAR = 0,   // 2-tap linear interpolation (cheapest)
+    RESAMPLER_POLYPHASE     // 8-tap windowed-sinc polyphase filter
+};
+
+extern ResamplerQuality resamplerQuality;
+
+// Per-stream resampler state (owned by Core 1 while the stream is active)
+struct ResamplerState {
+    uint32_t rate;  // Source rate the step was computed for
+    uint32_t step;  // Source frames per output frame (16.16)
+    uint32_t pos;   // Position of the next output frame in the history window (16.16)
+    int taps;       // Kernel length the history was built for
+    int consumed;   // Source frames released from the ring by the last block
+    int16_t history[(RESAMPLER_TAPS - 1) * 2]; // Last source frames (interleaved)
+};
+
 // ===================================
 // MP4/M4A Parser Class
 // ===================================
+// Window of a big-endian uint32 sample table (stsz/stco/stsc) held in PSRAM.
+// Small tables fit in one window and are read once at open(); larger ones
+// are paged in a window at a time as the playback cursor moves through them.
+struct MP4TableWindow {
+    uint32_t* data;       // PSRAM, capacity entries * stride words
+    uint32_t capacity;    // Entries per window
+    uint32_t stride;      // uint32 words per entry (stsc = 3)
+    uint32_t fileOffset;  // File offset of entry 0
+    uint32_t entryCount;  // Entries in the table
+    uint32_t base;        // First entry held in the window
+    uint32_t valid;       // Entries held in the window (0 = empty)
+};
+
 class MP4Parser {
 public:
     MP4Parser();
     bool open(const char* filename, bool isFlash);
     void close();
     size_t readNextFrame(uint8_t* buffer, size_t bufferSize);
+    bool seekToSample(uint32_t sample); // Access unit index (1024 PCM frames each)
     
     // Config getters
     uint32_t getSampleRate() { return sampleRate; }
@@ -291,8 +506,15 @@ private:
     uint32_t stscIndex; 
     uint32_t nextChunkRunStart;
     
-    // Data Widths
-    uint8_t stszSampleSize; // 0 if variable
+    // Sample Tables (cached in PSRAM)
+    uint32_t stszDefaultSize; // 0 if variable
+    MP4TableWindow stszTable;
+    MP4TableWindow stcoTable;
+    MP4TableWindow stscTable;
+    
+    bool initTable(MP4TableWindow &t, uint32_t capacity, uint32_t stride, uint32_t fileOffset, uint32_t entryCount);
+    const uint32_t* tableEntry(MP4TableWindow &t, uint32_t index);
+    void advanceStsc();
     
     // Helpers
     uint32_t readUI32BE(File &f);
@@ -329,18 +551,63 @@ struct AudioStream {
     // State
     char filename[64];
     bool stopRequested;
+    bool fadingOut;   // Fade-out-then-stop running (fadeOutStream), stops when the mixer is done
     bool fileFinished;
-    uint8_t channels; // 1 = Mono, 2 = Stereo
-    uint32_t sampleRate; // Source sample rate (e.g. 44100 or 22050)
+    uint8_t channels; // 1 = Mono, 2 = Stereo (ring buffer holds this native layout)
+    uint32_t sampleRate; // Source sample rate (e.g. 44100 or 22050), 0 until known
     uint32_t startTime; // Debug timestamp
+    
+    // Position / Seeking
+    uint32_t dataStart;      // WAV: file offset of the first PCM byte
+    uint32_t dataSize;       // WAV: PCM bytes in the data chunk
+    uint32_t startOffsetMs;  // File position playback (re)started from
+    volatile uint32_t playedFrames; // Native frames the mixer has consumed since then (Core 1)
+    uint32_t discardFrames;  // Decoded frames still to drop after a seek (Core 0)
+    uint32_t discardRate;    // Sample rate discardFrames is counted in
+    
+    // IMA-ADPCM (STREAM_TYPE_ADPCM_FLASH)
+    uint16_t adpcmBlockAlign;
+    uint16_t adpcmSamplesPerBlock;
+    uint32_t adpcmFrames;     // Frames in the file
+    uint32_t adpcmFramesLeft; // Frames still to decode from the file position (the last block is padded)
+    
+    // RAM-resident Clip (STREAM_TYPE_PCM_RAM)
+    const int16_t* ramPcm;   // Native channels at SAMPLE_RATE, in the Bank 1 arena
+    uint32_t ramFrames;
+    volatile uint32_t ramPos; // Next frame to mix (Core 1)
+    
+    // Deferred Open (warm cache hit: playing from cached PCM)
+    bool openPending;        // File not opened yet, refill opens it at openPos
+    uint32_t openPos;
+    
+    // Allocation (stream_alloc.cpp)
+    uint8_t ownerBank;       // Bank of the sound playing (0 = SD root / system)
+    uint8_t streamClass;     // StreamClass, decides what may steal the stream
+    uint32_t claimTime;      // millis() when it was allocated, oldest goes first
+    
+    // Queued Next Item (QUEUE command, Core 0)
+    char nextFile[64];       // Joins the ring once the current file is read, empty if none
+    uint16_t nextFadeMs;     // Equal-power crossfade into it, 0 = gapless
+    bool nextLoop;           // Item stays queued after it starts (loops it)
+    bool joinPending;        // Joined compressed file: first decoded frame checked against the ring's rate
+    bool restartPending;     // Item can't share the ring: start it fresh once the ring has drained
+    int xfadeStart;          // Ring index of the first tail sample under the crossfade
+    uint32_t xfadeLen;       // Crossfade overlap in samples (0 = none)
+    uint32_t xfadeDone;      // Overlap samples mixed so far
+    uint32_t joinFrames;     // playedFrames at which the current file's first frame plays
+    
+    // SD Staging (Core 0)
+    uint8_t* staging;     // STREAM_STAGING_SIZE bytes in PSRAM
+    uint32_t stagingLen;  // Valid bytes in staging
+    uint32_t stagingPos;  // Next byte to hand to the decoder / WAV path
+    uint32_t bytesPerSec; // File data rate, sizes the staged reads
+    
+    // Mixer State (Core 1)
+    ResamplerState resampler; // Rate conversion when sampleRate != SAMPLE_RATE
 };
 
 extern AudioStream* streams;
 extern RingBuffer* streamBuffers;
-extern MP3DecoderHelix** mp3Decoders;
-extern bool* mp3DecoderInUse;
-extern AACDecoderHelix** aacDecoders;
-extern bool* aacDecoderInUse;
 
 // ===================================
 // Function Prototypes
@@ -349,34 +616,265 @@ extern bool* aacDecoderInUse;
 // from serial_commands.cpp
 void log_message(const String& msg);
 void processSerialCommands(Stream &serial); // Dual-buffer fix
+void sendSerialResponse(Stream &serial, const char* msg);
+void sendSerialResponseF(Stream &serial, const char* format, ...);
 
 // from file_management.cpp
 bool parseIniFile();
 void writeIniFile();
-void scanValidBank1Pages();
-void scanBank1();
-bool syncBank1ToFlash();
+AudioFormat getAudioFormat(const char* filename); // Helper to get format from extension
+void bank1PlayPath(char* out, size_t len, const SoundFile &sound, int v);
+uint32_t pathHash(const char* path);
+bool readWavLayout(File &f, WavLayout &out, bool allowAdpcm = false);   // Caller holds flash_mutex
+bool readWavLayout(FsFile &f, WavLayout &out, bool allowAdpcm = false); // Caller holds the card (sdIoBegin)
+bool isAudioFile(const char* filename); // Helper to check if file is supported
+
+// from flash_sync.cpp
+bool beginBank1Sync();   // Setup: diff only, copying runs in the background
+void serviceBank1Sync(); // Main loop task
+void stopBank1Sync();    // Back to playing Bank 1 from the SD card
+bool bank1OnFlash(const SoundFile &sound, int v);
+const char* bank1SyncState(int &onFlash, int &total);
+
+// from voice_feedback.cpp
+void serviceVoice(); // Main loop task
+bool voiceHoldsStream(int streamIdx); // Auto-stop must leave the stream open
+bool voiceBusy();
+void waitForVoice(); // Blocks until the queue has played (boot only)
+void playVoiceFeedback(const char* filename); // Queues a clip from /0_System
+void queueVoicePause(uint32_t ms);
+void playVoiceNumber(int number);
+void playBaudFeedback(long rate); // Helper for baud rate feedback
+void playBankNameFeedback(char page); // Helper for Bank Name feedback
 void playFirmwareUpdateFeedback(bool fwUpdated);
 
-void scanSDBanks();
-void scanRootTracks();
+// from sd_index.cpp
+void scanSDCard(); // Bank 1 pages + active page, Banks 2-6, root tracks
+const char* bank1Variant(const SoundFile &sound, int v);
+const char* sdBankFile(const SDBank* bank, int i);
 SDBank* findSDBank(uint8_t bank, char page);
 const char* getSDFile(uint8_t bank, char page, int index);
-void playVoiceFeedback(const char* filename); // Exposed for other files
-void playVoiceNumber(int number); // Exposed for other files
-void playBaudFeedback(long rate); // Helper for baud rate feedback
-void playBankNameFeedback(char page); // Helper for Bank Name feedback
-AudioFormat getAudioFormat(const char* filename); // Helper to get format from extension
-bool isAudioFile(const char* filename); // Helper to check if file is supported
+
+// from sd_io.cpp
+enum SdIoPriority {
+    SD_IO_STREAM = 0, // Stream refills, opens and seeks
+    SD_IO_FILE,       // Single small files
+    SD_IO_BULK,       // Whole-file reads
+    SD_IO_SCAN        // Directory walks
+};
+void sdIoBegin(SdIoPriority prio);      // Take the card for one short operation
+void sdIoEnd();
+void sdIoCheckpoint(SdIoPriority prio); // Card held: lend it to starving streams
+void sdIoYield(SdIoPriority prio);      // Card not held: refill starving streams
+int sdIoRead(FsFile &f, void* dst, uint32_t len, SdIoPriority prio);
+bool isSdStream(const AudioStream* s);
+int sdIoSectors(uint32_t lba, uint8_t* buf, uint32_t count, bool write); // MSC: 1 done, 0 busy, -1 error
+void sdIoMscSlice();
+
+// from warm_cache.cpp
+struct WarmCacheHit {
+    uint8_t channels;
+    uint32_t sampleRate;
+    uint32_t dataStart;
+    uint32_t dataSize;
+    uint16_t blockAlign; // IMA-ADPCM layout (blockAlign 0 for PCM)
+    uint16_t samplesPerBlock;
+    uint32_t frames;
+    const int16_t* pcm;  // First pcmBytes of decoded PCM, null if not cached
+    uint32_t pcmBytes;   // Whole ADPCM blocks' worth, unless the clip ends sooner
+};
+extern int warmCacheKB;
+void initWarmCache();
+bool warmCacheLookup(const char* path, WarmCacheHit &hit);
+void warmCacheRekey(int idx, const char* path); // Variant idx (Bank 1 order) moved to `path`
+void serviceWarmCache();
+
+// from adpcm.cpp
+extern bool bank1Adpcm; // #BANK1_ADPCM
+uint32_t adpcmBlockFrames(uint32_t blockAlign, uint8_t channels);
+uint32_t adpcmDecodeBlock(const uint8_t* in, uint32_t bytes, uint8_t channels, uint16_t samplesPerBlock, int16_t* out);
+uint32_t adpcmEncodeBlock(const int16_t* pcm, uint32_t frames, uint8_t channels, uint8_t* index, uint8_t* out);
+uint32_t adpcmWavHeader(uint8_t* out, uint8_t channels, uint32_t sampleRate, uint32_t frames);
+uint32_t adpcmReadFrames(File &f, const WavLayout &l, int16_t* dst, uint32_t maxFrames);   // Caller holds flash_mutex
+uint32_t adpcmReadFrames(FsFile &f, const WavLayout &l, int16_t* dst, uint32_t maxFrames); // Caller holds the card
+
+// from ram_bank.cpp
+extern bool bank1RamMode;
+bool initBank1Ram();
+bool startRamStream(AudioStream* s, const char* path, uint32_t startMs);
+void seekRamStream(AudioStream* s, uint32_t ms);
+void ramBankRekey(const char* from, const char* to);
+
+// from stream_seek.cpp
+struct Mp3FrameHeader {
+    uint32_t sampleRate;
+    uint32_t bitrate;         // bits per second
+    uint32_t frameLen;        // bytes, including header
+    uint32_t samplesPerFrame;
+    uint8_t channels;
+    bool mpeg1;
+};
+bool parseMp3Header(const uint8_t* h, Mp3FrameHeader &out);
+bool seekStreamFile(AudioStream* s, uint32_t ms);
+
+// from stream_alloc.cpp
+enum StreamClass {
+    STREAM_CLASS_EFFECTS = 0, // Lowest priority, stolen first
+    STREAM_CLASS_VOCALS,
+    STREAM_CLASS_MUSIC,
+    STREAM_CLASS_COUNT
+};
+extern uint8_t bankClass[7];   // Default class per bank (#BANK_CLASSES), [0] = SD root
+extern uint8_t bankReserve[7]; // Streams kept for each bank (#BANK_RESERVE)
+int allocateStream(uint8_t bank, uint8_t cls); // Stopped stream to play on, -1 if none may be taken
+void claimStream(int streamIdx, uint8_t bank, uint8_t cls); // Tag a started stream
+int streamClassFromChar(char c);
+char streamClassChar(uint8_t cls);
+
+// from stream_queue.cpp
+bool queueStream(int streamIdx, const char* filename, uint16_t fadeMs, bool loop);
+void resetStreamQueue(AudioStream* s);
+void serviceStreamQueues(); // From fillStreamBuffers(), before the auto-stop
+int pushStreamPcm(AudioStream* s, const int16_t* src, int count, int srcChannels, uint32_t rate);
+
+// from decoder_pool.cpp
+enum DecoderKind { DECODER_NONE = 0, DECODER_MP3, DECODER_AAC };
+extern int decoderPoolKB; // #DECODER_POOL_KB, 0 = one AAC decoder per stream
+void initDecoderPool();
+int acquireDecoder(DecoderKind kind, AudioStream* s); // Held decoder for s, -1 if the pool is full
+void releaseDecoder(int idx);
+void restartDecoder(int idx);
+MP3DecoderHelix* poolMp3(int idx);
+AACDecoderHelix* poolAac(int idx);
+
+// from resampler.cpp
+void initResampler();
+void resampleBuffer(const int16_t* src, int srcFrames, int ch, uint32_t rate, int16_t* dst, int dstFrames);
+void resamplerReset(ResamplerState* rs);
+int resampleBlock(ResamplerState* rs, RingBuffer* rb, int ch, uint32_t rate, int16_t* dst, int frames);
 
 // from audio_playback.cpp
 void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref);
 void aacDataCallback(AACFrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref);
-bool startStream(int streamIdx, const char* filename);
-void stopStream(int streamIdx);
+bool startStream(int streamIdx, const char* filename, uint32_t startMs = 0);
+bool seekStream(int streamIdx, uint32_t ms);
+uint32_t streamPositionMs(AudioStream* s);
+void stopStream(int streamIdx, uint32_t fadeMs = MIXER_STOP_FADE_MS); // Waits for the fade
+void fadeOutStream(int streamIdx, uint32_t fadeMs); // Stops once faded out, doesn't wait
+void setStreamVolume(int streamIdx, float volume);
+bool appendStreamFile(int streamIdx, const char* filename); // Gapless WAV continuation
+bool openStreamSource(AudioStream* s, int streamIdx, const char* filename, AudioFormat format, bool isFlash);
+void closeStreamSource(AudioStream* s);
 void fillStreamBuffers(); // Main loop task
+uint32_t streamBufferMs(AudioStream* s);
+extern volatile uint32_t refillUrgencyMs; // Smallest time-to-empty (ms) of any refilling stream
 void initAudioSystem();
-void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol);
+
+// from effects.cpp
+enum FxFilter {
+    FX_FILTER_NONE = 0,
+    FX_FILTER_HIGHPASS, // Small-speaker high-pass
+    FX_FILTER_RADIO,    // Droid radio band-pass
+    FX_FILTER_COUNT
+};
+enum FxStage { FX_STAGE_FILTER = 0, FX_STAGE_PITCH, FX_STAGE_LIMITER, FX_STAGE_SYNTH, FX_STAGE_COUNT };
+extern bool limiterEnabled;   // #LIMITER
+extern int limiterDriveDb;    // #LIMITER_DRIVE_DB
+extern uint8_t bankFilter[7]; // Filter per bank (#BANK_FILTERS), [0] = SD root
+void initEffects();
+int fxFilterFromChar(char c);
+char fxFilterChar(uint8_t filter);
+bool fxSetStream(int stream, uint8_t filter, uint32_t speed); // Core 1
+uint32_t fxStreamSpeed(int stream);
+bool fxStreamFiltered(int stream);
+void fxFilterBlock(int stream, int16_t* block, int frames);
+void fxLimitBlock(int32_t* acc, int frames);
+
+// from synth.cpp
+enum SynthWave { SYNTH_WAVE_SINE = 0, SYNTH_WAVE_TRIANGLE, SYNTH_WAVE_SQUARE, SYNTH_WAVE_SAW, SYNTH_WAVE_NOISE, SYNTH_WAVE_COUNT };
+enum SynthMod { SYNTH_MOD_NONE = 0, SYNTH_MOD_FM, SYNTH_MOD_RING, SYNTH_MOD_COUNT };
+
+// Instrument a note is played with (SYNP)
+struct SynthPatch {
+    uint8_t wave;        // SynthWave
+    uint8_t mod;         // SynthMod
+    uint8_t sustain;     // Envelope sustain level, percent
+    uint16_t attackMs;
+    uint16_t decayMs;
+    uint16_t releaseMs;
+    uint16_t modRatio;   // Modulator frequency, percent of the note's
+    uint16_t modDepth;   // FM: index x100, ring: mix percent
+};
+
+// One note (or rest) of a sequence, in mixer units (built on Core 0)
+struct SynthStep {
+    uint8_t patch;       // SYNTH_STEP_REST for a rest
+    uint8_t volume;      // 0..255
+    uint32_t startInc;   // Phase increments (2^32 = one cycle per sample)
+    uint32_t endInc;
+    uint32_t samples;    // Gate length
+    uint32_t advance;    // Samples until the next step starts (0 = with this one)
+};
+#define SYNTH_STEP_REST 0xFF
+#define SYNTH_PATCH_CHIRP SYNTH_PATCHES // Fixed patch CHRP plays with
+
+extern SynthPatch synthPatches[SYNTH_PATCHES];
+void initSynth();
+SynthStep synthStep(int patch, int startHz, int endHz, int ms, int vol);
+bool synthPlay(const SynthStep* steps, int count); // False if every sequence slot is busy
+void synthStop();
+bool synthBusy(); // Any sequence still playing
+void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol = 128);
+int synthWaveFromChar(char c);
+int synthModFromChar(char c);
+void synthStartSequence(int slot);                 // Core 1, from the command queue
+bool synthRenderBlock(int32_t* acc, int frames);   // Core 1, adds into the mix, false if silent
+
+// from mixer.cpp
+int pushPcm(RingBuffer* rb, const int16_t* src, int count, int srcChannels, int dstChannels);
+void initMixer();
+// Mixer commands (Core 0): each returns a sequence number for mixerSync()
+uint32_t mixerStart(int stream, float volume, uint32_t fadeMs);
+uint32_t mixerStop(int stream, uint32_t fadeMs = 0);
+uint32_t mixerSetGain(int stream, float volume);
+uint32_t mixerFade(int stream, float volume, uint32_t ms);
+uint32_t mixerSetFx(int stream, uint8_t filter, uint32_t speed); // Filter preset, speed Q16
+uint32_t mixerSynth(int slot); // Starts a filled-in synth sequence slot, -1 stops the synth
+uint32_t mixerPerfReset();     // Core 1 clears the profiling counters it writes
+bool mixerVoiceActive(int stream); // False once a stream's fade-out has finished
+void mixerSync(uint32_t seq); // Waits until Core 1 has applied `seq`
+namespace Mixer {
+    void applyCommands();                         // Core 1, between blocks
+    void processBlock(uint32_t* out, int frames); // Renders one block, packed (L << 16) | R
+}
+
+// from perf.cpp
+void perfReport(Stream &serial);
+#if PERF_ENABLE
+inline uint32_t perfNow() { return micros(); }
+void perfInit();
+void perfReset();
+void perfResetMixer();            // Core 1's counters (from the command queue)
+void perfRead(bool sd, uint32_t us);    // One SD / flash read (Core 0)
+void perfDecodeBegin(int stream);       // Before a decoder write() (Core 0)
+void perfDecodeFrame(int stream);       // From the decoder callbacks (Core 0)
+void perfBufferLevel(int stream, uint32_t ms); // Buffered ms of a playing stream (Core 0)
+void perfUnderrun(int stream);          // Mixer came up short (Core 1)
+void perfMixBlock(uint32_t us);         // processBlock() time (Core 1)
+void perfFxStage(int stage, uint32_t us); // One effects stage for one block (Core 1)
+#else
+inline uint32_t perfNow() { return 0; }
+inline void perfInit() {}
+inline void perfReset() {}
+inline void perfResetMixer() {}
+inline void perfRead(bool, uint32_t) {}
+inline void perfDecodeBegin(int) {}
+inline void perfDecodeFrame(int) {}
+inline void perfBufferLevel(int, uint32_t) {}
+inline void perfUnderrun(int) {}
+inline void perfMixBlock(uint32_t) {}
+inline void perfFxStage(int, uint32_t) {}
+#endif
 
 // from serial_commands.cpp (MP3 Trigger Compat)
 void action_togglePlayPause();
@@ -406,5 +904,6 @@ void setupMSC();
 void pollMSCTrigger();
 void startMSC();
 void stopMSC();
+void serviceMSC(); // Main loop task
 
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,179 @@
+// Decoder Pool (Core 0)
+// MP3 and AAC decoders share one PSRAM arena of #DECODER_POOL_KB. A decoder
+// is constructed in the arena the first time a stream needs one of its kind
+// and kept after the stream stops, so the next MP3 (or AAC) stream reuses it
+// without constructing anything. When a stream needs a kind there is no room
+// for, idle decoders of the other kind are destroyed to make space. Memory is
+// only taken by decoders that have actually been used, instead of one of
+// each kind per stream from boot.
+#include "config.h"
+
+struct DecoderSlot {
+    DecoderKind kind;   // DECODER_NONE if the slot is unused
+    bool inUse;         // Held by a stream
+    uint32_t offset;    // Storage in the arena
+    uint32_t size;
+    uint32_t lastUsed;  // millis() at release, oldest idle decoder goes first
+    void* obj;
+};
+
+int decoderPoolKB = 0; // 0 = one AAC decoder per stream
+
+static uint8_t* arena = nullptr;
+static uint32_t arenaBytes = 0;
+static DecoderSlot* slots = nullptr;
+static int slotCount = 0;
+
+static uint32_t kindBytes(DecoderKind kind) {
+    uint32_t n = (kind == DECODER_MP3) ? sizeof(MP3DecoderHelix) : sizeof(AACDecoderHelix);
+    return (n + 7) & ~7u;
+}
+
+// ===================================
+// Init
+// ===================================
+// Two slots per stream, so idle decoders of both kinds can be kept even when
+// every stream holds one.
+void initDecoderPool() {
+    if (decoderPoolKB <= 0) {
+        arenaBytes = maxStreams * kindBytes(DECODER_AAC);
+    } else {
+        arenaBytes = (uint32_t)decoderPoolKB * 1024;
+    }
+    arena = (uint8_t*)pmalloc(arenaBytes);
+    if (!arena) {
+        Serial.printf("Decoder pool: ERROR - PSRAM allocation of %lu KB failed\n", (unsigned long)(arenaBytes / 1024));
+        arenaBytes = 0;
+    }
+
+    slotCount = maxStreams * 2;
+    slots = new DecoderSlot[slotCount];
+    for (int i = 0; i < slotCount; i++) {
+        slots[i].kind = DECODER_NONE;
+        slots[i].inUse = false;
+        slots[i].obj = nullptr;
+    }
+    Serial.printf("Decoder pool: %lu KB in PSRAM (MP3 decoder %lu B, AAC decoder %lu B)\n",
+                  (unsigned long)(arenaBytes / 1024), (unsigned long)kindBytes(DECODER_MP3),
+                  (unsigned long)kindBytes(DECODER_AAC));
+}
+
+// ===================================
+// Arena Placement
+// ===================================
+// First gap of `size` bytes between the constructed decoders, or -1
+static int64_t findGap(uint32_t size) {
+    uint32_t pos = 0;
+    while (pos + size <= arenaBytes) {
+        // Lowest-placed decoder overlapping [pos, pos + size)
+        int hit = -1;
+        for (int i = 0; i < slotCount; i++) {
+            DecoderSlot &d = slots[i];
+            if (d.kind == DECODER_NONE) continue;
+            if (d.offset < pos + size && pos < d.offset + d.size) {
+                if (hit == -1 || d.offset < slots[hit].offset) hit = i;
+            }
+        }
+        if (hit == -1) return pos;
+        pos = slots[hit].offset + slots[hit].size;
+    }
+    return -1;
+}
+
+static void destroySlot(DecoderSlot &d) {
+    if (d.kind == DECODER_MP3) ((MP3DecoderHelix*)d.obj)->~MP3DecoderHelix();
+    else if (d.kind == DECODER_AAC) ((AACDecoderHelix*)d.obj)->~AACDecoderHelix();
+    d.kind = DECODER_NONE;
+    d.obj = nullptr;
+}
+
+// Oldest idle decoder, -1 if all are held
+static int oldestIdle() {
+    int best = -1;
+    uint32_t now = millis();
+    for (int i = 0; i < slotCount; i++) {
+        DecoderSlot &d = slots[i];
+        if (d.kind == DECODER_NONE || d.inUse) continue;
+        if (best == -1 || now - d.lastUsed > now - slots[best].lastUsed) best = i;
+    }
+    return best;
+}
+
+// ===================================
+// Acquire / Release
+// ===================================
+// The stream is the decoder's callback reference, so its PCM lands in the
+// right ring without a global "current stream".
+static void setReference(DecoderSlot &d, AudioStream* s) {
+    if (d.kind == DECODER_MP3) ((MP3DecoderHelix*)d.obj)->setReference(s);
+    else ((AACDecoderHelix*)d.obj)->setReference(s);
+}
+
+// Returns a decoder of `kind` for stream `s` (not begun), or -1 if the pool
+// can't fit one next to the decoders other streams are using.
+int acquireDecoder(DecoderKind kind, AudioStream* s) {
+    if (!slots) return -1;
+
+    // 1. Idle decoder of the same kind
+    for (int i = 0; i < slotCount; i++) {
+        if (slots[i].kind == kind && !slots[i].inUse) {
+            slots[i].inUse = true;
+            setReference(slots[i], s);
+            return i;
+        }
+    }
+
+    // 2. Construct one, destroying idle decoders until it fits
+    int slot = -1;
+    for (int i = 0; i < slotCount && slot == -1; i++) {
+        if (slots[i].kind == DECODER_NONE) slot = i;
+    }
+    uint32_t size = kindBytes(kind);
+    int64_t offset = findGap(size);
+    while (offset < 0 || slot == -1) {
+        int victim = oldestIdle();
+        if (victim == -1) {
+            log_message(String("Decoder pool: no room for a") + (kind == DECODER_MP3 ? "n MP3" : "n AAC") + " decoder");
+            return -1;
+        }
+        destroySlot(slots[victim]);
+        if (slot == -1) slot = victim;
+        offset = findGap(size);
+    }
+
+    DecoderSlot &d = slots[slot];
+    d.offset = (uint32_t)offset;
+    d.size = size;
+    if (kind == DECODER_MP3) d.obj = new (arena + d.offset) MP3DecoderHelix(mp3DataCallback);
+    else d.obj = new (arena + d.offset) AACDecoderHelix(aacDataCallback);
+    d.kind = kind;
+    d.inUse = true;
+    setReference(d, s);
+    return slot;
+}
+
+// Ends the decoder and keeps it for the next stream of its kind
+void releaseDecoder(int idx) {
+    if (idx < 0 || idx >= slotCount || slots[idx].kind == DECODER_NONE) return;
+    DecoderSlot &d = slots[idx];
+    if (d.kind == DECODER_MP3) ((MP3DecoderHelix*)d.obj)->end();
+    else ((AACDecoderHelix*)d.obj)->end();
+    d.inUse = false;
+    d.lastUsed = millis();
+}
+
+MP3DecoderHelix* poolMp3(int idx) {
+    if (idx < 0 || idx >= slotCount || slots[idx].kind != DECODER_MP3) return nullptr;
+    return (MP3DecoderHelix*)slots[idx].obj;
+}
+
+AACDecoderHelix* poolAac(int idx) {
+    if (idx < 0 || idx >= slotCount || slots[idx].kind != DECODER_AAC) return nullptr;
+    return (AACDecoderHelix*)slots[idx].obj;
+}
+
+// Restarts a held decoder (new file or new position)
+void restartDecoder(int idx) {
+    if (MP3DecoderHelix* mp3 = poolMp3(idx)) mp3->begin();
+    else if (AACDecoderHelix* aac = poolAac(idx)) aac->begin();
+}
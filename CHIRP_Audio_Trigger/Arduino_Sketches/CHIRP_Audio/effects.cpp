@@ -0,0 +1,208 @@
+// Effects (Core 1)
+// Optional processing in the mixer, each stage costing nothing while unused:
+// - Per-stream biquad (small-speaker high-pass, droid radio band-pass),
+//   picked per bank (#BANK_FILTERS) or with the FX command
+// - Per-stream pitch/speed (FX command): the stream is read faster or slower
+//   through its resampler, like a tape, so pitch and tempo move together
+// - Look-ahead master limiter with drive (#LIMITER, #LIMITER_DRIVE_DB) in
+//   place of the hard clip at +/-32767
+// The time each stage takes is reported by the PERF command (PERF:FX).
+#include "config.h"
+
+// Filter presets
+#define FX_HIGHPASS_HZ 250.0f  // Small-speaker high-pass (Butterworth)
+#define FX_RADIO_HZ 1800.0f    // Droid radio band-pass centre
+#define FX_RADIO_Q 1.2f
+
+// Limiter
+#define LIMITER_CHUNK 16         // Frames per gain step, also the look-ahead
+#define LIMITER_THRESHOLD 32000  // Peak the output is held under (~-0.2 dBFS)
+#define LIMITER_RELEASE_MS 80    // Time constant of the gain recovering
+
+bool limiterEnabled = false;
+int limiterDriveDb = 0;
+uint8_t bankFilter[7] = { FX_FILTER_NONE, FX_FILTER_NONE, FX_FILTER_NONE, FX_FILTER_NONE,
+                          FX_FILTER_NONE, FX_FILTER_NONE, FX_FILTER_NONE };
+
+static const char filterLetters[FX_FILTER_COUNT] = { 'N', 'H', 'R' };
+
+// Biquad coefficients, Q28, a0 normalised to 1
+struct BiquadCoeffs {
+    int32_t b0, b1, b2, a1, a2;
+};
+
+// Per-stream effect state (Core 1, set by MIXER_CMD_FX)
+struct StreamFx {
+    uint8_t filter;
+    uint32_t speed;    // Playback speed, Q16 (65536 = normal)
+    int32_t x1[2], x2[2], y1[2], y2[2];
+};
+
+static BiquadCoeffs presets[FX_FILTER_COUNT];
+static StreamFx* fx = nullptr;
+
+// Limiter state (Core 1)
+static int32_t limDelay[LIMITER_CHUNK * 2]; // Chunk waiting to be output
+static int32_t limDelayReq = 65536;         // Gain the waiting chunk needs, Q16
+static int32_t limGain = 65536;             // Q16
+static int32_t limDrive = 65536;            // Q16
+static int32_t limRelease = 0;              // Share of the gap recovered per chunk, Q16
+
+int fxFilterFromChar(char c) {
+    if (c >= 'a' && c <= 'z') c -= 32;
+    for (int i = 0; i < FX_FILTER_COUNT; i++) {
+        if (filterLetters[i] == c) return i;
+    }
+    return -1;
+}
+
+char fxFilterChar(uint8_t filter) {
+    return (filter < FX_FILTER_COUNT) ? filterLetters[filter] : '?';
+}
+
+// ===================================
+// Init (Core 0, before Core 1 mixes)
+// ===================================
+// RBJ cookbook biquads at SAMPLE_RATE
+static void designBiquad(BiquadCoeffs &c, bool bandPass, float hz, float q) {
+    float w0 = 2.0f * (float)M_PI * hz / SAMPLE_RATE;
+    float cw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+    float b0, b1, b2;
+    if (bandPass) {
+        b0 = alpha;          // 0 dB peak gain
+        b1 = 0.0f;
+        b2 = -alpha;
+    } else {
+        b0 = (1.0f + cw) / 2.0f;
+        b1 = -(1.0f + cw);
+        b2 = (1.0f + cw) / 2.0f;
+    }
+    const float one = (float)(1 << 28);
+    c.b0 = (int32_t)lroundf(b0 / a0 * one);
+    c.b1 = (int32_t)lroundf(b1 / a0 * one);
+    c.b2 = (int32_t)lroundf(b2 / a0 * one);
+    c.a1 = (int32_t)lroundf(-2.0f * cw / a0 * one);
+    c.a2 = (int32_t)lroundf((1.0f - alpha) / a0 * one);
+}
+
+void initEffects() {
+    if (!fx) fx = new StreamFx[maxStreams]();
+    for (int i = 0; i < maxStreams; i++) fx[i].speed = 65536;
+
+    memset(&presets[FX_FILTER_NONE], 0, sizeof(BiquadCoeffs));
+    designBiquad(presets[FX_FILTER_HIGHPASS], false, FX_HIGHPASS_HZ, 0.7071f);
+    designBiquad(presets[FX_FILTER_RADIO], true, FX_RADIO_HZ, FX_RADIO_Q);
+
+    limDrive = (int32_t)lroundf(powf(10.0f, limiterDriveDb / 20.0f) * 65536.0f);
+    float chunksPerTc = (LIMITER_RELEASE_MS * SAMPLE_RATE / 1000.0f) / LIMITER_CHUNK;
+    limRelease = (int32_t)lroundf((1.0f - expf(-1.0f / chunksPerTc)) * 65536.0f);
+    memset(limDelay, 0, sizeof(limDelay));
+    limDelayReq = 65536;
+    limGain = 65536;
+}
+
+// ===================================
+// Per-Stream Settings (Core 1, from the command queue)
+// ===================================
+// Returns true if the stream has to be read through the resampler from now
+// on while it wasn't before (its history is stale then).
+bool fxSetStream(int stream, uint8_t filter, uint32_t speed) {
+    if (!fx || stream < 0 || stream >= maxStreams) return false;
+    StreamFx &f = fx[stream];
+    if (filter >= FX_FILTER_COUNT) filter = FX_FILTER_NONE;
+    if (filter != f.filter) {
+        f.filter = filter;
+        memset(f.x1, 0, sizeof(f.x1));
+        memset(f.x2, 0, sizeof(f.x2));
+        memset(f.y1, 0, sizeof(f.y1));
+        memset(f.y2, 0, sizeof(f.y2));
+    }
+    bool wasNormal = (f.speed == 65536);
+    f.speed = speed;
+    return wasNormal && speed != 65536;
+}
+
+uint32_t fxStreamSpeed(int stream) {
+    return fx ? fx[stream].speed : 65536;
+}
+
+bool fxStreamFiltered(int stream) {
+    return fx && fx[stream].filter != FX_FILTER_NONE;
+}
+
+// ===================================
+// Biquad (Core 1)
+// ===================================
+// Filters a rendered stereo block in place (direct form I, 64-bit sums)
+void fxFilterBlock(int stream, int16_t* block, int frames) {
+    StreamFx &f = fx[stream];
+    const BiquadCoeffs &c = presets[f.filter];
+    for (int ch = 0; ch < 2; ch++) {
+        int32_t x1 = f.x1[ch], x2 = f.x2[ch], y1 = f.y1[ch], y2 = f.y2[ch];
+        int16_t* p = block + ch;
+        for (int i = 0; i < frames; i++) {
+            int32_t x = *p;
+            int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * x1 + (int64_t)c.b2 * x2
+                        - (int64_t)c.a1 * y1 - (int64_t)c.a2 * y2;
+            int32_t y = (int32_t)(acc >> 28);
+            if (y > 32767) y = 32767;
+            else if (y < -32768) y = -32768;
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            *p = (int16_t)y;
+            p += 2;
+        }
+        f.x1[ch] = x1; f.x2[ch] = x2; f.y1[ch] = y1; f.y2[ch] = y2;
+    }
+}
+
+// ===================================
+// Master Limiter (Core 1)
+// ===================================
+// Works on chunks of LIMITER_CHUNK frames, delayed by one chunk. When a chunk
+// comes in, the gain it needs to stay under the threshold is known before it
+// is output, so the gain ramps down across the chunk in front of it (attack
+// within the look-ahead) and never has to clip. It recovers exponentially.
+// Adds LIMITER_CHUNK frames (0.36ms) of latency while enabled.
+static_assert(MIXER_BLOCK_FRAMES % LIMITER_CHUNK == 0, "Mixer block must hold whole limiter chunks");
+
+void fxLimitBlock(int32_t* acc, int frames) {
+    for (int c = 0; c < frames; c += LIMITER_CHUNK) {
+        int32_t* in = acc + c * 2;
+
+        // Drive the new chunk and find its peak
+        int32_t peak = 0;
+        for (int i = 0; i < LIMITER_CHUNK * 2; i++) {
+            int32_t v = in[i];
+            if (limDrive != 65536) v = (int32_t)(((int64_t)v * limDrive) >> 16);
+            in[i] = v;
+            int32_t a = (v < 0) ? -v : v;
+            if (a > peak) peak = a;
+        }
+        int32_t req = (peak > LIMITER_THRESHOLD) ? (int32_t)(((int64_t)LIMITER_THRESHOLD << 16) / peak) : 65536;
+
+        // Gain at the end of the chunk going out now
+        int32_t target = (req < limDelayReq) ? req : limDelayReq;
+        int32_t next;
+        if (target < limGain) next = target;
+        else next = limGain + (int32_t)(((int64_t)(target - limGain) * limRelease) >> 16);
+
+        // Output the waiting chunk with the gain ramping to `next`, hold the new one
+        int32_t g = limGain;
+        int32_t step = (next - limGain) / LIMITER_CHUNK;
+        for (int i = 0; i < LIMITER_CHUNK; i++) {
+            g += step;
+            if (i == LIMITER_CHUNK - 1) g = next;
+            int32_t l = in[i * 2];
+            int32_t r = in[i * 2 + 1];
+            in[i * 2] = (int32_t)(((int64_t)limDelay[i * 2] * g) >> 16);
+            in[i * 2 + 1] = (int32_t)(((int64_t)limDelay[i * 2 + 1] * g) >> 16);
+            limDelay[i * 2] = l;
+            limDelay[i * 2 + 1] = r;
+        }
+        limGain = next;
+        limDelayReq = req;
+    }
+}
@@ -0,0 +1,786 @@
+// Bank 1 Flash Sync (Core 0, background)
+// Copies the active Bank 1 page from the SD card to /flash while the droid
+// runs. beginBank1Sync() (setup) only diffs the card against /flash and the
+// manifest, so boot takes seconds however much of the library changed; the
+// copying is done a step at a time by serviceBank1Sync() from loop(). Each
+// variant plays from the SD card until its flash copy is confirmed, then
+// from flash (bank1PlayPath()).
+//
+// Writing flash stalls Core 1 (XIP is off while a block is programmed), so
+// steps that write only run once nothing has played for SYNC_QUIET_MS, one
+// LittleFS block per step: a trigger waits for at most that one write.
+// Steps that only read (checking an existing copy) also run while sounds
+// play, unless a refill is getting urgent. SD reads go through sd_io at bulk
+// priority, behind the streams. Nothing runs while the card is lent to USB.
+#include "config.h"
+#include <CRC32.h>
+
+// ===================================
+// Flash Sync Manifest
+// ===================================
+// FLASH_MANIFEST_PATH records, for each file in /flash, the size and modify
+// time of the SD file it was copied from, the CRC32 of that SD file, the
+// size on flash and whether it was stored as IMA-ADPCM (#BANK1_ADPCM).
+// The boot diff reads the Bank 1 directory and /flash once each and checks
+// them against it, instead of opening every file on both sides.
+
+struct ManifestHeader {
+    uint32_t magic;
+    uint32_t count;
+};
+
+struct ManifestEntry {
+    char name[32];
+    uint32_t size;
+    uint32_t mtime;  // FAT (date << 16) | time, 0 if the card doesn't keep one
+    uint32_t crc;    // CRC32 of the SD file (= the data on flash for a plain copy)
+    uint32_t flashSize;
+    uint32_t adpcm;  // 1 if synced with #BANK1_ADPCM on (WAVs only)
+};
+
+enum SyncTodo : uint8_t {
+    SYNC_TODO_NONE = 0,
+    SYNC_TODO_CHECK,  // Manifest matches but the card keeps no modify times: compare the SD CRC
+    SYNC_TODO_ADOPT,  // Flash copy from before the manifest existed: compare both CRCs
+    SYNC_TODO_COPY    // Copy (or encode) it
+};
+
+struct SyncItem {
+    const char* name;  // Variant filename (in the name pool)
+    uint32_t key;      // pathHash(name)
+    uint32_t size;     // SD size
+    uint32_t mtime;    // SD modify time
+    uint32_t crc;      // SD file CRC32: valid if `synced`, the expected one for SYNC_TODO_CHECK
+    uint32_t flashSize;
+    bool adpcm;        // Stored as IMA-ADPCM (#BANK1_ADPCM), or wanted as such when copied
+    bool onSd;
+    bool onFlash;
+    bool synced;       // Flash copy known to match the SD file (plays from flash)
+    uint8_t todo;      // SyncTodo
+    int manifest;      // Loaded manifest entry, -1 if none
+};
+
+// The variant being worked on
+struct SyncJob {
+    int item;          // -1 if none
+    uint8_t todo;
+    bool encode;       // Copying as IMA-ADPCM
+    FsFile sdFile;
+    File flashFile;
+    CRC32 crc;         // Of the SD file
+    CRC32 flashCrc;    // Of the flash file (adopt)
+    uint32_t pos;      // SD bytes read
+    uint32_t sdSize;
+    uint32_t startMs;
+    WavLayout layout;  // Encode: the SD file's PCM
+    uint32_t framesLeft;
+    uint8_t index[2];  // Encoder step index per channel
+    uint32_t outLen;   // Encoded bytes waiting in the buffer
+    uint32_t written;  // Bytes written to flash
+};
+
+enum SyncStepResult { SYNC_STEP_MORE = 0, SYNC_STEP_DONE, SYNC_STEP_MISMATCH, SYNC_STEP_FAILED };
+
+enum SyncPhase { SYNC_OFF = 0, SYNC_PRUNE, SYNC_FILES, SYNC_SAVE, SYNC_DONE };
+static const char* phaseNames[] = { "OFF", "RUNNING", "RUNNING", "RUNNING", "DONE" };
+
+static SyncPhase phase = SYNC_OFF;
+static SyncItem* items = nullptr;
+static int itemCount = 0;
+static int syncLimit = 0;
+static int nextItem = 0;
+static SyncJob job;
+static uint8_t* buffer = nullptr;  // 2 * SYNC_STEP_BYTES of SRAM while copying
+static uint8_t* ready = nullptr;   // Bit per Bank 1 variant: plays from flash
+static int readyCount = 0;
+static int variantCount = 0;
+static int manifestCount = 0;
+static int filesToSync = 0;
+static int filesCopied = 0;
+static int filesAdopted = 0;
+static int filesCarried = 0;       // Manifest entries still valid as they are
+static int filesFailed = 0;
+static int filesDeleted = 0;
+static int sinceSave = 0;          // Copies since the manifest was last written
+static bool hasVoiceFeedback = false;
+static uint32_t quietSince = 0;
+static uint32_t syncStartMs = 0;
+
+// Open-addressed index over the sync items (name -> item)
+static int16_t* syncIndex = nullptr;
+static uint32_t syncIndexMask = 0;
+
+static int findSyncItem(const char* name) {
+    uint32_t key = pathHash(name);
+    for (uint32_t i = key & syncIndexMask; syncIndex[i] >= 0; i = (i + 1) & syncIndexMask) {
+        const SyncItem &it = items[syncIndex[i]];
+        if (it.key == key && strcmp(it.name, name) == 0) return syncIndex[i];
+    }
+    return -1;
+}
+
+// Returns the number of entries read into `entries` (caller deletes)
+static int loadManifest(ManifestEntry* &entries) {
+    entries = nullptr;
+    File f = LittleFS.open(FLASH_MANIFEST_PATH, "r");
+    if (!f) return 0;
+
+    ManifestHeader header;
+    int count = 0;
+    if (f.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+        header.magic == FLASH_MANIFEST_MAGIC &&
+        f.size() == sizeof(header) + header.count * sizeof(ManifestEntry)) {
+        count = header.count;
+        entries = new ManifestEntry[count > 0 ? count : 1];
+        if (f.read((uint8_t*)entries, count * sizeof(ManifestEntry)) != (int)(count * sizeof(ManifestEntry))) {
+            count = 0;
+        }
+    } else {
+        Serial.println("  Manifest unreadable, rebuilding.");
+    }
+    f.close();
+    return count;
+}
+
+// Writes every synced item. Written to a temp file first so an interrupted
+// write leaves the previous manifest in place. Caller holds flash_mutex.
+static bool saveManifest() {
+    static const char* tmpPath = FLASH_MANIFEST_PATH ".tmp";
+    File f = LittleFS.open(tmpPath, "w");
+    if (!f) return false;
+
+    ManifestHeader header = { FLASH_MANIFEST_MAGIC, 0 };
+    for (int i = 0; i < itemCount; i++) {
+        if (items[i].synced) header.count++;
+    }
+    bool ok = f.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    for (int i = 0; i < itemCount && ok; i++) {
+        if (!items[i].synced) continue;
+        ManifestEntry e;
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, items[i].name, sizeof(e.name) - 1);
+        e.size = items[i].size;
+        e.mtime = items[i].mtime;
+        e.crc = items[i].crc;
+        e.flashSize = items[i].flashSize;
+        e.adpcm = items[i].adpcm ? 1 : 0;
+        ok = f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+    }
+    f.close();
+
+    if (!ok) {
+        LittleFS.remove(tmpPath);
+        return false;
+    }
+    LittleFS.remove(FLASH_MANIFEST_PATH);
+    return LittleFS.rename(tmpPath, FLASH_MANIFEST_PATH);
+}
+
+// ===================================
+// Variant Paths
+// ===================================
+// Variants are numbered in Bank 1 order (sounds, then their variants), as
+// the sync items and the warm cache entries are.
+static int variantOrdinal(const SoundFile &sound, int v) {
+    return sound.firstVariant + v - bank1Sounds[0].firstVariant;
+}
+
+bool bank1OnFlash(const SoundFile &sound, int v) {
+    if (!ready) return false;
+    int n = variantOrdinal(sound, v);
+    return n >= 0 && n < variantCount && (ready[n >> 3] & (1 << (n & 7)));
+}
+
+// Switches variant `n` between its SD and flash paths. The Bank 1 caches are
+// keyed by path, so their entries move along.
+static void setReady(int n, bool on) {
+    if (!ready || n < 0 || n >= variantCount) return;
+    bool was = (ready[n >> 3] & (1 << (n & 7))) != 0;
+    if (was == on) return;
+
+    const char* name = nullptr;
+    int e = 0;
+    for (int i = 0; i < bank1SoundCount && !name; i++) {
+        if (n < e + bank1Sounds[i].variantCount) name = bank1Variant(bank1Sounds[i], n - e);
+        e += bank1Sounds[i].variantCount;
+    }
+    if (!name) return;
+
+    char sdPath[96];
+    char flashPath[64];
+    snprintf(sdPath, sizeof(sdPath), "/%s/%s", bank1DirName, name);
+    snprintf(flashPath, sizeof(flashPath), "/flash/%s", name);
+    if (on) {
+        ready[n >> 3] |= (1 << (n & 7));
+        readyCount++;
+    } else {
+        ready[n >> 3] &= ~(1 << (n & 7));
+        readyCount--;
+    }
+    warmCacheRekey(n, on ? flashPath : sdPath);
+    ramBankRekey(on ? sdPath : flashPath, on ? flashPath : sdPath);
+}
+
+// ===================================
+// Begin (Core 0, setup)
+// ===================================
+// Builds the sync list and diffs it against /flash and the manifest. Files
+// already in sync play from flash right away; everything else is left to
+// serviceBank1Sync(). Nothing is copied here.
+bool beginBank1Sync() {
+    if (!useFlashForBank1) {
+        Serial.println("  Skipping sync: Flash memory usage disabled in CHIRP.INI.");
+        return false;
+    }
+
+    if (bank1DirName[0] == '\0') {
+        Serial.println("  Skipping sync: No active Bank 1 directory found.");
+        return false;
+    }
+    if (phase != SYNC_OFF && phase != SYNC_DONE) return true; // Already running
+    uint32_t t0 = millis();
+
+    // Check for Voice Feedback Directory
+    hasVoiceFeedback = false;
+    sdIoBegin(SD_IO_FILE);
+    if (sd.exists("/0_System")) {
+        hasVoiceFeedback = true;
+    }
+    sdIoEnd();
+
+    if (hasVoiceFeedback) {
+        Serial.println("  Voice Feedback: Enabled");
+    }
+
+    mutex_enter_blocking(&flash_mutex);
+    if (!LittleFS.exists("/flash")) {
+        LittleFS.mkdir("/flash");
+    }
+    mutex_exit(&flash_mutex);
+
+    // --- Build the sync list (one item per Bank 1 variant) ---
+    int totalFiles = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        totalFiles += bank1Sounds[i].variantCount;
+    }
+
+    itemCount = totalFiles;
+    variantCount = totalFiles;
+    items = new SyncItem[totalFiles > 0 ? totalFiles : 1];
+    uint32_t indexSize = 16;
+    while (indexSize < (uint32_t)totalFiles * 2) indexSize <<= 1;
+    syncIndex = new int16_t[indexSize];
+    syncIndexMask = indexSize - 1;
+    for (uint32_t i = 0; i < indexSize; i++) syncIndex[i] = -1;
+    if (!ready) {
+        ready = new uint8_t[(totalFiles + 7) / 8 + 1];
+        memset(ready, 0, (totalFiles + 7) / 8 + 1);
+        readyCount = 0;
+    }
+
+    int n = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        for (int v = 0; v < bank1Sounds[i].variantCount; v++, n++) {
+            SyncItem &it = items[n];
+            it.name = bank1Variant(bank1Sounds[i], v);
+            it.key = pathHash(it.name);
+            it.size = 0;
+            it.mtime = 0;
+            it.crc = 0;
+            it.flashSize = 0;
+            it.adpcm = bank1Adpcm && getAudioFormat(it.name) == FORMAT_WAV;
+            it.onSd = false;
+            it.onFlash = false;
+            it.synced = false;
+            it.todo = SYNC_TODO_NONE;
+            it.manifest = -1;
+            uint32_t slot = it.key & syncIndexMask;
+            while (syncIndex[slot] >= 0) slot = (slot + 1) & syncIndexMask;
+            syncIndex[slot] = n;
+        }
+    }
+
+    // --- One read of the SD bank directory: size + modify time ---
+    char dirPath[64];
+    snprintf(dirPath, sizeof(dirPath), "/%s", bank1DirName);
+    sdIoBegin(SD_IO_SCAN);
+    FsFile bankDir = sd.open(dirPath);
+    if (bankDir) {
+        FsFile file;
+        while (file.openNext(&bankDir, O_RDONLY)) {
+            char filename[64];
+            file.getName(filename, sizeof(filename));
+            int idx = file.isDirectory() ? -1 : findSyncItem(filename);
+            if (idx >= 0) {
+                uint16_t date = 0, time = 0;
+                items[idx].onSd = true;
+                items[idx].size = file.fileSize();
+                if (file.getModifyDateTime(&date, &time)) {
+                    items[idx].mtime = ((uint32_t)date << 16) | time;
+                }
+            }
+            file.close();
+            sdIoCheckpoint(SD_IO_SCAN);
+        }
+        bankDir.close();
+    }
+    sdIoEnd();
+
+    // --- One read of /flash: note what's there (stale files are pruned later) ---
+    int staleCount = 0;
+    uint32_t* flashSizes = new uint32_t[totalFiles > 0 ? totalFiles : 1];
+    mutex_enter_blocking(&flash_mutex);
+    Dir dir = LittleFS.openDir("/flash");
+    while (dir.next()) {
+        if (dir.isDirectory()) continue;
+        int idx = findSyncItem(dir.fileName().c_str());
+        if (idx >= 0) {
+            items[idx].onFlash = true;
+            flashSizes[idx] = dir.fileSize();
+        } else {
+            staleCount++;
+        }
+    }
+
+    // --- Diff against the manifest ---
+    ManifestEntry* manifest = nullptr;
+    manifestCount = loadManifest(manifest);
+    mutex_exit(&flash_mutex);
+    for (int m = 0; m < manifestCount; m++) {
+        manifest[m].name[sizeof(manifest[m].name) - 1] = '\0';
+        int idx = findSyncItem(manifest[m].name);
+        if (idx >= 0) items[idx].manifest = m;
+    }
+
+    syncLimit = DEV_MODE ? min(totalFiles, DEV_SYNC_LIMIT) : totalFiles;
+    filesToSync = 0;
+    int filesToCheck = 0;
+    filesCopied = 0;
+    filesAdopted = 0;
+    filesCarried = 0;
+    filesFailed = 0;
+    filesDeleted = 0;
+    sinceSave = 0;
+    for (int i = 0; i < totalFiles; i++) {
+        SyncItem &it = items[i];
+        if (!it.onSd) continue;
+
+        if (it.onFlash && it.manifest >= 0) {
+            const ManifestEntry &e = manifest[it.manifest];
+            // Toggling #BANK1_ADPCM re-syncs the WAVs
+            if (e.size == it.size && e.mtime == it.mtime && e.flashSize == flashSizes[i] && (e.adpcm != 0) == it.adpcm) {
+                it.crc = e.crc;
+                it.flashSize = e.flashSize;
+                if (it.mtime != 0 || i >= syncLimit) {
+                    it.synced = true;
+                    filesCarried++;
+                } else {
+                    it.todo = SYNC_TODO_CHECK; // No modify times on this card: fall back to the content hash
+                }
+            }
+        } else if (it.onFlash && i < syncLimit && !it.adpcm && flashSizes[i] == it.size) {
+            it.todo = SYNC_TODO_ADOPT;
+        }
+        if (!it.synced && it.todo == SYNC_TODO_NONE && i < syncLimit) it.todo = SYNC_TODO_COPY;
+        if (it.todo == SYNC_TODO_COPY) filesToSync++;
+        else if (it.todo != SYNC_TODO_NONE) filesToCheck++;
+    }
+    delete[] flashSizes;
+    delete[] manifest;
+
+    for (int i = 0; i < totalFiles; i++) {
+        if (items[i].synced) setReady(i, true);
+    }
+
+    Serial.printf("  %d/%d files of %s on flash, %d to copy, %d to check, %d stale (%lu ms)",
+                  readyCount, syncLimit, bank1DirName, filesToSync,
+                  filesToCheck, staleCount, millis() - t0);
+    if (DEV_MODE && totalFiles > syncLimit) {
+        Serial.printf(" (DEV MODE: limited to first %d)", DEV_SYNC_LIMIT);
+    }
+    Serial.println();
+
+    // --- Voice Feedback: Start ---
+    if (hasVoiceFeedback && filesToSync > 0) {
+        // "Syncing X Files Of Y Total Files"
+        playVoiceFeedback("syncing.wav");
+        queueVoicePause(100);
+        playVoiceNumber(filesToSync);
+        queueVoicePause(100);
+        playVoiceFeedback("files.wav");
+        queueVoicePause(100);
+        playVoiceFeedback("of.wav");
+        queueVoicePause(100);
+        playVoiceNumber(syncLimit);
+        queueVoicePause(100);
+        playVoiceFeedback("total.wav");
+        queueVoicePause(100);
+        playVoiceFeedback("files.wav");
+    } else if (hasVoiceFeedback) {
+        Serial.println("  System in sync. Silent startup.");
+    }
+
+    job.item = -1;
+    nextItem = 0;
+    quietSince = millis();
+    syncStartMs = millis();
+    phase = (staleCount > 0) ? SYNC_PRUNE : SYNC_FILES;
+    return true;
+}
+
+// ===================================
+// Steps (Core 0, from serviceBank1Sync)
+// ===================================
+// Deletes one file of /flash that isn't in the current Bank 1
+static bool pruneStep() {
+    char stale[80] = "";
+    mutex_enter_blocking(&flash_mutex);
+    Dir dir = LittleFS.openDir("/flash");
+    while (dir.next()) {
+        if (dir.isDirectory() || findSyncItem(dir.fileName().c_str()) >= 0) continue;
+        snprintf(stale, sizeof(stale), "/flash/%s", dir.fileName().c_str());
+        break;
+    }
+    bool removed = stale[0] && LittleFS.remove(stale);
+    mutex_exit(&flash_mutex);
+
+    if (!stale[0]) {
+        phase = SYNC_FILES;
+    } else if (removed) {
+        Serial.printf("Sync: Deleted stale file %s\n", stale + 7);
+        filesDeleted++;
+    } else {
+        Serial.printf("Sync: ERROR deleting %s\n", stale + 7);
+        phase = SYNC_FILES; // Would find it again
+    }
+    return true;
+}
+
+static void closeJobFiles() {
+    sdIoBegin(SD_IO_BULK);
+    if (job.sdFile) job.sdFile.close();
+    sdIoEnd();
+    mutex_enter_blocking(&flash_mutex);
+    if (job.flashFile) job.flashFile.close();
+    mutex_exit(&flash_mutex);
+}
+
+static bool startJob(int n) {
+    SyncItem &it = items[n];
+    char sdPath[96];
+    char flashPath[64];
+    snprintf(sdPath, sizeof(sdPath), "/%s/%s", bank1DirName, it.name);
+    snprintf(flashPath, sizeof(flashPath), "/flash/%s", it.name);
+
+    if (!buffer) {
+        // SRAM: PSRAM shares the QSPI bus with flash, and this is freed once
+        // the sync is done
+        buffer = (uint8_t*)malloc(2 * SYNC_STEP_BYTES);
+        if (!buffer) {
+            Serial.println("Sync: ERROR - No memory for the copy buffer");
+            return false;
+        }
+    }
+
+    sdIoBegin(SD_IO_BULK);
+    job.sdFile = sd.open(sdPath, FILE_READ);
+    job.encode = false;
+    if (job.sdFile && it.todo == SYNC_TODO_COPY && it.adpcm) {
+        // Only 16-bit PCM is encoded, other WAVs are copied as they are
+        job.encode = readWavLayout(job.sdFile, job.layout);
+        job.sdFile.seek(0);
+    }
+    sdIoEnd();
+    if (!job.sdFile) {
+        Serial.printf("Sync: ERROR - Could not open %s\n", sdPath);
+        return false;
+    }
+
+    job.item = n;
+    job.todo = it.todo;
+    job.crc = CRC32();
+    job.flashCrc = CRC32();
+    job.pos = 0;
+    job.sdSize = job.sdFile.size();
+    job.startMs = millis();
+    job.outLen = 0;
+    job.written = 0;
+
+    if (job.todo == SYNC_TODO_ADOPT || job.todo == SYNC_TODO_COPY) {
+        mutex_enter_blocking(&flash_mutex);
+        job.flashFile = LittleFS.open(flashPath, job.todo == SYNC_TODO_COPY ? "w" : "r");
+        mutex_exit(&flash_mutex);
+        if (!job.flashFile) {
+            Serial.printf("Sync: ERROR - Could not open %s\n", flashPath);
+            closeJobFiles();
+            job.item = -1;
+            return false;
+        }
+    }
+    if (job.encode) {
+        job.framesLeft = job.layout.frames;
+        job.index[0] = job.index[1] = 0;
+        adpcmWavHeader(buffer, job.layout.channels, job.layout.sampleRate, job.layout.frames);
+        job.outLen = ADPCM_HEADER_BYTES;
+    }
+    return true;
+}
+
+static bool writeFlash(const uint8_t* src, uint32_t len) {
+    mutex_enter_blocking(&flash_mutex);
+    bool ok = job.flashFile.write(src, len) == len;
+    mutex_exit(&flash_mutex);
+    job.written += len;
+    return ok;
+}
+
+// Reads up to SYNC_STEP_BYTES of the SD file into `dst` and the CRC
+static int readSd(uint8_t* dst, uint32_t end) {
+    uint32_t len = end - job.pos;
+    if (len > SYNC_STEP_BYTES) len = SYNC_STEP_BYTES;
+    int n = sdIoRead(job.sdFile, dst, len, SD_IO_BULK);
+    if (n <= 0) return -1;
+    job.crc.update(dst, n);
+    job.pos += n;
+    return n;
+}
+
+// One IMA-ADPCM block per step. The header and any trailing chunks only go
+// into the CRC, so it is the whole SD file's like a plain copy's.
+static SyncStepResult encodeStep() {
+    uint8_t* out = buffer;
+    uint8_t* in = buffer + SYNC_STEP_BYTES;
+    const WavLayout &l = job.layout;
+
+    if (job.pos < l.dataStart) {
+        return (readSd(in, l.dataStart) > 0) ? SYNC_STEP_MORE : SYNC_STEP_FAILED;
+    }
+    if (job.framesLeft > 0) {
+        uint32_t frames = (job.framesLeft > ADPCM_BLOCK_FRAMES) ? ADPCM_BLOCK_FRAMES : job.framesLeft;
+        uint32_t bytes = frames * l.channels * 2;
+        if (readSd(in, job.pos + bytes) != (int)bytes) return SYNC_STEP_FAILED;
+        job.outLen += adpcmEncodeBlock((const int16_t*)in, frames, l.channels, job.index, out + job.outLen);
+        job.framesLeft -= frames;
+        if (job.outLen + ADPCM_BLOCK_BYTES * l.channels > SYNC_STEP_BYTES || job.framesLeft == 0) {
+            if (!writeFlash(out, job.outLen)) return SYNC_STEP_FAILED;
+            job.outLen = 0;
+        }
+        return SYNC_STEP_MORE;
+    }
+    if (job.outLen > 0) {
+        // No frames at all: just the header
+        if (!writeFlash(out, job.outLen)) return SYNC_STEP_FAILED;
+        job.outLen = 0;
+        return SYNC_STEP_MORE;
+    }
+    if (job.pos < job.sdSize) {
+        return (readSd(in, job.sdSize) > 0) ? SYNC_STEP_MORE : SYNC_STEP_FAILED;
+    }
+    return SYNC_STEP_DONE;
+}
+
+// One SYNC_STEP_BYTES chunk: checked, compared with the flash copy, or copied
+static SyncStepResult jobStep() {
+    if (job.encode) return encodeStep();
+    if (job.pos >= job.sdSize) return SYNC_STEP_DONE;
+
+    uint8_t* chunk = buffer + SYNC_STEP_BYTES;
+    int n = readSd(chunk, job.sdSize);
+    if (n <= 0) return SYNC_STEP_FAILED;
+
+    if (job.todo == SYNC_TODO_ADOPT) {
+        mutex_enter_blocking(&flash_mutex);
+        int m = job.flashFile.read(buffer, n);
+        mutex_exit(&flash_mutex);
+        if (m != n) return SYNC_STEP_MISMATCH;
+        job.flashCrc.update(buffer, m);
+    } else if (job.todo == SYNC_TODO_COPY) {
+        if (!writeFlash(chunk, n)) return SYNC_STEP_FAILED;
+    }
+    return (job.pos >= job.sdSize) ? SYNC_STEP_DONE : SYNC_STEP_MORE;
+}
+
+static void finishJob(SyncStepResult result) {
+    SyncItem &it = items[job.item];
+    int n = job.item;
+    closeJobFiles();
+    job.item = -1;
+
+    uint32_t crc = job.crc.finalize();
+    if (result == SYNC_STEP_DONE) {
+        if (job.todo == SYNC_TODO_CHECK) {
+            if (crc == it.crc) filesCarried++;
+            else result = SYNC_STEP_MISMATCH;
+        } else if (job.todo == SYNC_TODO_ADOPT) {
+            if (crc == job.flashCrc.finalize()) {
+                it.flashSize = job.sdSize;
+                filesAdopted++;
+            } else {
+                result = SYNC_STEP_MISMATCH;
+            }
+        } else {
+            it.flashSize = job.encode ? job.written : job.sdSize;
+            filesCopied++;
+            sinceSave++;
+            Serial.printf("Sync: [%d/%d] %s %s (%lu KB, %lu ms)\n", filesCopied, filesToSync,
+                          job.encode ? "Encoded" : "Copied", it.name,
+                          (unsigned long)(it.flashSize / 1024), millis() - job.startMs);
+        }
+    }
+
+    if (result == SYNC_STEP_MISMATCH) {
+        // Copy it after all (the next step starts on it again)
+        it.todo = SYNC_TODO_COPY;
+        filesToSync++;
+        return;
+    }
+    it.todo = SYNC_TODO_NONE;
+    nextItem = n + 1;
+    if (result == SYNC_STEP_FAILED) {
+        Serial.printf("Sync: ERROR - %s failed\n", it.name);
+        filesFailed++;
+        if (job.todo == SYNC_TODO_COPY) {
+            char flashPath[64];
+            snprintf(flashPath, sizeof(flashPath), "/flash/%s", it.name);
+            mutex_enter_blocking(&flash_mutex);
+            LittleFS.remove(flashPath);
+            mutex_exit(&flash_mutex);
+        }
+        return;
+    }
+
+    it.crc = crc;
+    it.synced = true;
+    setReady(n, true);
+
+    // Now and then, so a power cut doesn't send the copies made so far round again
+    if (sinceSave >= SYNC_SAVE_EVERY) {
+        mutex_enter_blocking(&flash_mutex);
+        saveManifest();
+        mutex_exit(&flash_mutex);
+        sinceSave = 0;
+    }
+}
+
+static void freeSyncState() {
+    free(buffer);
+    buffer = nullptr;
+    delete[] syncIndex;
+    syncIndex = nullptr;
+    delete[] items;
+    items = nullptr;
+    itemCount = 0;
+}
+
+static void finishSync() {
+    // Only rewrite the manifest when something changed
+    if (filesCopied > 0 || filesAdopted > 0 || filesCarried != manifestCount) {
+        mutex_enter_blocking(&flash_mutex);
+        bool saved = saveManifest();
+        mutex_exit(&flash_mutex);
+        if (!saved) Serial.println("Sync: WARNING - Could not write flash manifest");
+    }
+    freeSyncState();
+    phase = SYNC_DONE;
+
+    Serial.printf("Sync: Done, %d copied, %d on flash, %d failed, %d pruned (%lu s)\n",
+                  filesCopied, readyCount, filesFailed, filesDeleted, (millis() - syncStartMs) / 1000);
+    if (hasVoiceFeedback && filesCopied > 0) {
+        // "Transfer Completed"
+        playVoiceFeedback("transfer.wav");
+        queueVoicePause(10);
+        playVoiceFeedback("completed.wav");
+    }
+}
+
+// Runs one step. Returns false if there was nothing it could do right now.
+static bool syncStep(bool quiet) {
+    switch (phase) {
+        case SYNC_PRUNE:
+            return quiet && pruneStep();
+
+        case SYNC_FILES: {
+            if (job.item < 0) {
+                while (nextItem < syncLimit && items[nextItem].todo == SYNC_TODO_NONE) nextItem++;
+                if (nextItem >= syncLimit) {
+                    phase = SYNC_SAVE;
+                    return true;
+                }
+                uint8_t todo = items[nextItem].todo;
+                if (todo == SYNC_TODO_COPY ? !quiet : isCpuBusy()) return false;
+                if (!startJob(nextItem)) {
+                    if (!buffer) {
+                        phase = SYNC_SAVE; // Nothing more can be copied
+                        return true;
+                    }
+                    items[nextItem].todo = SYNC_TODO_NONE;
+                    filesFailed++;
+                    nextItem++;
+                    return true;
+                }
+            }
+            // Copies hold their files open while they wait for a quiet gap
+            if (job.todo == SYNC_TODO_COPY ? !quiet : isCpuBusy()) return false;
+            SyncStepResult r = jobStep();
+            if (r != SYNC_STEP_MORE) finishJob(r);
+            return true;
+        }
+
+        case SYNC_SAVE:
+            if (quiet) finishSync();
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+// ===================================
+// Service (Core 0, main loop)
+// ===================================
+static bool audioSilent() {
+    if (voiceBusy() || synthBusy()) return false;
+    for (int i = 0; i < maxStreams; i++) {
+        if (streams[i].active) return false;
+    }
+    return true;
+}
+
+void serviceBank1Sync() {
+    if (phase == SYNC_OFF || phase == SYNC_DONE) return;
+    if (g_mscActive) {
+        // The host may change the card under an open file: redo this variant afterwards
+        if (job.item >= 0) {
+            closeJobFiles();
+            job.item = -1;
+        }
+        return;
+    }
+    uint32_t now = millis();
+    if (!audioSilent()) quietSince = now;
+    bool quiet = (now - quietSince >= SYNC_QUIET_MS);
+
+    uint32_t t0 = micros();
+    do {
+        if (!syncStep(quiet)) break;
+        if (quiet && !audioSilent()) break; // Something started: no more writes
+    } while (micros() - t0 < SYNC_STEP_BUDGET_US);
+}
+
+// Abandons a running sync (CCRC) and plays Bank 1 from the SD card again
+void stopBank1Sync() {
+    if (job.item >= 0) {
+        closeJobFiles();
+        job.item = -1;
+    }
+    if (items) freeSyncState();
+    for (int n = 0; n < variantCount; n++) setReady(n, false);
+    phase = SYNC_OFF;
+}
+
+// State name for the SYNC command, with the variants playing from flash
+const char* bank1SyncState(int &onFlash, int &total) {
+    onFlash = readyCount;
+    total = variantCount;
+    return phaseNames[phase];
+}
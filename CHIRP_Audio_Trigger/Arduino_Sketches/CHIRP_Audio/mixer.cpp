@@ -0,0 +1,500 @@
+// Mixer (Core 1) and PCM ring input (Core 0)
+// Has no I2S, decoder or file dependencies so it also builds on a desktop
+// (see ../CHIRP_Audio_Bench).
+#include "config.h"
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+// ===================================
+// Mixer Command Queue (Core 0 -> Core 1)
+// ===================================
+// Core 0 never writes mixer state directly. Start/stop/gain/fade/synth
+// requests go through a lock-free single-producer/single-consumer ring and
+// Core 1 applies them between blocks. Gain changes are sample-counted ramps
+// that run across blocks, stepped per sample, so starts, stops and volume
+// changes don't click. Every command gets a sequence number;
+// mixerSync() waits until Core 1 has applied it (e.g. before a stopped
+// stream's ring buffer is cleared).
+enum MixerCmdType : uint8_t {
+    MIXER_CMD_START,  // Begin mixing a stream that Core 0 has set up
+    MIXER_CMD_STOP,   // Stop reading the stream's ring / arena (after a fade-out)
+    MIXER_CMD_GAIN,   // New volume (finishes any ramp in progress at it)
+    MIXER_CMD_FADE,   // Ramp to a volume over a number of samples
+    MIXER_CMD_FX,     // Per-stream filter and speed
+    MIXER_CMD_SYNTH,  // Start a synth sequence (stream = its slot)
+    MIXER_CMD_PERF_RESET // Clear the profiling counters Core 1 writes
+};
+
+struct MixerCmd {
+    uint32_t seq;
+    MixerCmdType type;
+    int8_t stream;
+    int32_t gain;       // Q16 volume (65536 = 1.0), FX: filter
+    uint32_t ramp;      // Ramp length in samples (START fade-in, STOP fade-out, GAIN, FADE)
+    uint32_t phaseInc;  // FX: speed (Q16)
+};
+
+// Per-stream mixer state (Core 1)
+struct MixerVoice {
+    volatile bool active;  // Read by Core 0 to see a fade-out finish
+    bool stopAtEnd;        // Fade-out-then-stop in progress
+    int32_t gain;          // Current volume, Q24 (fine enough for long ramps)
+    int32_t target;        // Volume being ramped to, Q24
+    int32_t step;          // Change per sample while ramping
+    uint32_t rampSamples;  // Samples left in the ramp
+};
+
+static MixerCmd cmdQueue[MIXER_QUEUE_SIZE];
+static volatile uint32_t cmdHead = 0;    // Next slot to write (Core 0)
+static volatile uint32_t cmdTail = 0;    // Next slot to apply (Core 1)
+static uint32_t postedSeq = 0;           // Core 0 only
+static volatile uint32_t appliedSeq = 0; // Last command applied (Core 1)
+static MixerVoice* voices = nullptr;
+
+static inline int32_t volumeToQ16(float volume) {
+    if (volume < 0.0f) volume = 0.0f;
+    if (volume > 1.0f) volume = 1.0f;
+    return (int32_t)(volume * 65536.0f);
+}
+
+static inline uint32_t msToSamples(uint32_t ms) {
+    if (ms > MIXER_FADE_MAX_MS) ms = MIXER_FADE_MAX_MS;
+    return (uint32_t)(((uint64_t)ms * SAMPLE_RATE) / 1000);
+}
+
+// Allocates the voices, once maxStreams is known (Core 0, before Core 1 mixes)
+void initMixer() {
+    if (!voices) voices = new MixerVoice[maxStreams]();
+    initEffects();
+    initSynth();
+}
+
+// Queues a command for Core 1 and returns its sequence number. Core 1
+// drains the queue every block (every 1ms while idle), so a full queue only
+// waits briefly; if it stays full the command is dropped.
+static uint32_t postCommand(MixerCmd &c) {
+    uint32_t head = cmdHead;
+    uint32_t t0 = millis();
+    while (head - __atomic_load_n(&cmdTail, __ATOMIC_ACQUIRE) >= MIXER_QUEUE_SIZE) {
+        if (millis() - t0 > MIXER_SYNC_TIMEOUT_MS) {
+            Serial.println("Mixer: Command queue full, dropped a command");
+            return postedSeq;
+        }
+        delayMicroseconds(50);
+    }
+    c.seq = ++postedSeq;
+    cmdQueue[head & (MIXER_QUEUE_SIZE - 1)] = c;
+    __atomic_store_n(&cmdHead, head + 1, __ATOMIC_RELEASE);
+    return c.seq;
+}
+
+static uint32_t postStreamCommand(MixerCmdType type, int stream, int32_t gain, uint32_t ramp) {
+    MixerCmd c = {};
+    c.type = type;
+    c.stream = (int8_t)stream;
+    c.gain = gain;
+    c.ramp = ramp;
+    return postCommand(c);
+}
+
+// Everything the stream's render reads (type, ring, rate, arena...) must be set
+// up before this: the queue publishes it to Core 1 along with the command.
+uint32_t mixerStart(int stream, float volume, uint32_t fadeMs) {
+    return postStreamCommand(MIXER_CMD_START, stream, volumeToQ16(volume), msToSamples(fadeMs));
+}
+
+// With a fade the stream stops reading once the fade-out has finished (see
+// mixerVoiceActive()); without one it stops at the next block.
+uint32_t mixerStop(int stream, uint32_t fadeMs) {
+    return postStreamCommand(MIXER_CMD_STOP, stream, 0, msToSamples(fadeMs));
+}
+
+uint32_t mixerSetGain(int stream, float volume) {
+    return postStreamCommand(MIXER_CMD_GAIN, stream, volumeToQ16(volume), msToSamples(MIXER_GAIN_RAMP_MS));
+}
+
+uint32_t mixerFade(int stream, float volume, uint32_t ms) {
+    return postStreamCommand(MIXER_CMD_FADE, stream, volumeToQ16(volume), msToSamples(ms));
+}
+
+// Filter preset and playback speed (Q16, 65536 = normal) of a stream
+uint32_t mixerSetFx(int stream, uint8_t filter, uint32_t speed) {
+    MixerCmd c = {};
+    c.type = MIXER_CMD_FX;
+    c.stream = (int8_t)stream;
+    c.gain = filter;
+    c.phaseInc = speed;
+    return postCommand(c);
+}
+
+// Synth sequence slot `slot` has been filled in (see synthPlay())
+uint32_t mixerSynth(int slot) {
+    MixerCmd c = {};
+    c.type = MIXER_CMD_SYNTH;
+    c.stream = (int8_t)slot;
+    return postCommand(c);
+}
+
+// PERF:RESET: Core 1 zeroes its own counters, between two blocks
+uint32_t mixerPerfReset() {
+    MixerCmd c = {};
+    c.type = MIXER_CMD_PERF_RESET;
+    return postCommand(c);
+}
+
+// False once Core 1 has stopped reading the stream (a fade-out has ended)
+bool mixerVoiceActive(int stream) {
+    if (!voices || stream < 0 || stream >= maxStreams) return false;
+    return voices[stream].active;
+}
+
+// Waits until Core 1 has applied command `seq` (bounded, in case the mixer
+// is stalled)
+void mixerSync(uint32_t seq) {
+    uint32_t t0 = millis();
+    while ((int32_t)(__atomic_load_n(&appliedSeq, __ATOMIC_ACQUIRE) - seq) < 0) {
+        if (millis() - t0 > MIXER_SYNC_TIMEOUT_MS) break;
+        delayMicroseconds(50);
+    }
+}
+
+// ===================================
+// Push PCM into a Stream's Ring Buffer
+// ===================================
+// Ring buffers hold PCM in the stream's native channel count and sample rate;
+// the mixer does the upmix and rate conversion. `count` interleaved samples
+// with `srcChannels` are written as `dstChannels` (normally the same) using
+// one span reservation and one commit. Only whole frames are written.
+// Returns the number of input samples consumed.
+int pushPcm(RingBuffer* rb, const int16_t* src, int count, int srcChannels, int dstChannels) {
+    if (srcChannels == dstChannels) {
+        // Native layout (Pass through) - clamp to whole frames before the copy
+        int space = rb->availableForWrite();
+        if (dstChannels == 2) {
+            space &= ~1;
+            count &= ~1;
+        }
+        if (count > space) count = space;
+        return rb->write(src, count);
+    }
+
+    // Channel count changed mid-stream: convert to the stream's layout
+    int inFrames = count / srcChannels;
+    int space = rb->availableForWrite() / dstChannels;
+    if (inFrames > space) inFrames = space;
+    if (inFrames <= 0) return 0;
+
+    int16_t* spans[2];
+    int spanLen[2];
+    int n = rb->beginWrite(inFrames * dstChannels, spans[0], spanLen[0], spans[1], spanLen[1]);
+    int16_t* p = spans[0];
+    int left = spanLen[0];
+
+    for (int f = 0; f < inFrames; f++) {
+        if (dstChannels == 2) {
+            // MONO -> STEREO (Duplicate)
+            for (int c = 0; c < 2; c++) {
+                if (left == 0) { p = spans[1]; left = spanLen[1]; }
+                *p++ = src[f];
+                left--;
+            }
+        } else {
+            // STEREO -> MONO (Average)
+            if (left == 0) { p = spans[1]; left = spanLen[1]; }
+            *p++ = (int16_t)(((int32_t)src[f * 2] + src[f * 2 + 1]) >> 1);
+            left--;
+        }
+    }
+
+    rb->commitWrite(n);
+    return inFrames * srcChannels;
+}
+
+// ===================================
+// Mixing Kernels (Core 1)
+// ===================================
+// A stereo frame is handled as one packed 32-bit word: interleaved int16 on
+// a little-endian core puts L in the bottom half and R in the top. With the
+// Cortex-M33 DSP extension (RP2350) each half is one SMLAWB / SMLAWT
+// multiply-accumulate into the 32-bit accumulator and the output is clamped
+// with SSAT, without branches. Elsewhere (the bench) the same arithmetic runs
+// in plain C and gives bit-identical results.
+
+// acc += one stereo frame * gain, `gain` in Q16 (65536 = 1.0)
+static inline void mixFrame(int32_t* acc, const int16_t* src, int32_t gain) {
+#if defined(__ARM_FEATURE_DSP)
+    int32_t lr;
+    memcpy(&lr, src, sizeof(lr)); // One 32-bit load
+    acc[0] = __smlawb(gain, lr, acc[0]);
+    acc[1] = __smlawt(gain, lr, acc[1]);
+#else
+    acc[0] += (int32_t)(((int64_t)gain * src[0]) >> 16);
+    acc[1] += (int32_t)(((int64_t)gain * src[1]) >> 16);
+#endif
+}
+
+static inline void mixStereoBlock(int32_t* acc, const int16_t* src, int frames, int32_t gain) {
+    for (int f = 0; f < frames; f++) {
+        mixFrame(acc, src, gain);
+        acc += 2;
+        src += 2;
+    }
+}
+
+// Same with the gain ramping per sample: `gain` (Q24) moves by `step` each
+// frame and is scaled by the Q8 master attenuation
+static inline void mixStereoRamp(int32_t* acc, const int16_t* src, int frames, int32_t gain, int32_t step, int32_t master) {
+    for (int f = 0; f < frames; f++) {
+        mixFrame(acc, src, ((gain >> 8) * master) >> 8);
+        gain += step;
+        acc += 2;
+        src += 2;
+    }
+}
+
+// Hard limiter: saturates to 16 bits and packs as i2s.write16() expects, (L << 16) | R
+static inline uint32_t packFrame(int32_t l, int32_t r) {
+#if defined(__ARM_FEATURE_SAT)
+    l = __ssat(l, 16);
+    r = __ssat(r, 16);
+#else
+    if (l > 32767) l = 32767;
+    else if (l < -32768) l = -32768;
+    if (r > 32767) r = 32767;
+    else if (r < -32768) r = -32768;
+#endif
+    return ((uint32_t)(uint16_t)l << 16) | (uint16_t)r;
+}
+
+namespace Mixer {
+    static void startRamp(MixerVoice &v, int32_t target, uint32_t samples) {
+        v.target = target;
+        v.rampSamples = samples;
+        v.step = samples ? (target - v.gain) / (int32_t)samples : 0;
+        if (!samples) v.gain = target;
+    }
+
+    static void applyCommand(const MixerCmd &c) {
+        if (c.type == MIXER_CMD_SYNTH) {
+            synthStartSequence(c.stream);
+            return;
+        }
+        if (c.type == MIXER_CMD_PERF_RESET) {
+            perfResetMixer();
+            return;
+        }
+        if (!voices || c.stream < 0 || c.stream >= maxStreams) return;
+        MixerVoice &v = voices[c.stream];
+        int32_t target = c.gain << 8; // Q16 -> Q24
+
+        switch (c.type) {
+            case MIXER_CMD_START:
+                v.active = true;
+                v.stopAtEnd = false;
+                v.gain = c.ramp ? 0 : target;
+                startRamp(v, target, c.ramp);
+                break;
+            case MIXER_CMD_STOP:
+                if (c.ramp == 0 || !v.active) {
+                    v.active = false;
+                    v.stopAtEnd = false;
+                    v.rampSamples = 0;
+                } else if (!v.stopAtEnd || c.ramp < v.rampSamples) {
+                    v.stopAtEnd = true; // A shorter fade-out replaces a longer one
+                    startRamp(v, 0, c.ramp);
+                }
+                break;
+            case MIXER_CMD_GAIN:
+                if (v.stopAtEnd) break; // Fading out to stop
+                if (v.rampSamples > c.ramp) {
+                    // A longer fade (e.g. the start fade-in) carries on to the new volume
+                    startRamp(v, target, v.rampSamples);
+                } else {
+                    startRamp(v, target, c.ramp);
+                }
+                break;
+            case MIXER_CMD_FADE:
+                if (v.stopAtEnd) break;
+                startRamp(v, target, c.ramp ? c.ramp : 1);
+                break;
+            case MIXER_CMD_FX:
+                // A native-rate stream starts going through its resampler: drop the stale history
+                if (fxSetStream(c.stream, (uint8_t)c.gain, c.phaseInc) && streams &&
+                    streams[c.stream].sampleRate == SAMPLE_RATE) {
+                    resamplerReset(&streams[c.stream].resampler);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Applies everything Core 0 has queued. Called at the top of every
+    // block, and while audio is off so Core 0 is never left waiting.
+    void applyCommands() {
+        uint32_t tail = cmdTail;
+        uint32_t head = __atomic_load_n(&cmdHead, __ATOMIC_ACQUIRE);
+        if (tail == head) return;
+        uint32_t seq = 0;
+        for (; tail != head; tail++) {
+            const MixerCmd &c = cmdQueue[tail & (MIXER_QUEUE_SIZE - 1)];
+            applyCommand(c);
+            seq = c.seq;
+        }
+        __atomic_store_n(&cmdTail, tail, __ATOMIC_RELEASE);
+        __atomic_store_n(&appliedSeq, seq, __ATOMIC_RELEASE);
+    }
+
+    // Block accumulator (L/R interleaved, 32-bit headroom for summing streams)
+    static int32_t mixAcc[MIXER_BLOCK_FRAMES * 2];
+    // One stream's block after upmix/rate conversion (L/R interleaved, read as packed pairs)
+    alignas(4) static int16_t streamBlock[MIXER_BLOCK_FRAMES * 2];
+
+    // Source frame `k` of a read reservation that may wrap across two spans
+    static inline const int16_t* spanFrame(const int16_t* const* spans, const int* spanLen, int k, int ch) {
+        int idx = k * ch;
+        return (idx < spanLen[0]) ? spans[0] + idx : spans[1] + (idx - spanLen[0]);
+    }
+
+    // ===================================
+    // Render Stream (Core 1)
+    // ===================================
+    // Converts the stream's native PCM (mono or stereo, any rate) into up to
+    // `frames` stereo frames at SAMPLE_RATE. Native-rate streams are copied
+    // (and upmixed) straight out of the ring; everything else, and streams
+    // played at another speed, goes through the stream's resampler.
+    // Returns the number of frames rendered (less than `frames` on underrun).
+    static int renderStream(AudioStream* s, int16_t* dst, int frames, uint32_t speed) {
+        RingBuffer* rb = s->ringBuffer;
+        int ch = s->channels;
+        uint32_t rate = s->sampleRate;
+        if (ch < 1 || ch > 2 || rate == 0) return 0;
+
+        if (s->type == STREAM_TYPE_PCM_RAM) {
+            // Already at SAMPLE_RATE: read straight from the arena
+            uint32_t pos = s->ramPos;
+            uint32_t left = s->ramFrames - pos;
+            int n = (left < (uint32_t)frames) ? (int)left : frames;
+            const int16_t* src = s->ramPcm + pos * ch;
+            for (int out = 0; out < n; out++) {
+                dst[out * 2] = src[out * ch];
+                dst[out * 2 + 1] = src[out * ch + ch - 1];
+            }
+            s->ramPos = pos + n;
+            s->playedFrames += n;
+            return n;
+        }
+
+        if (speed != 65536) {
+            // Read faster / slower: the resampler takes up to 2x SAMPLE_RATE
+            rate = (uint32_t)(((uint64_t)rate * speed) >> 16);
+            if (rate > SAMPLE_RATE * 2) rate = SAMPLE_RATE * 2;
+            if (rate == 0) rate = 1;
+        }
+
+        if (rate != SAMPLE_RATE) {
+            int out = resampleBlock(&s->resampler, rb, ch, rate, dst, frames);
+            s->playedFrames += s->resampler.consumed;
+            return out;
+        }
+
+        // Native rate: straight copy / upmix
+        const int16_t* spans[2];
+        int spanLen[2];
+        int got = rb->beginRead(frames * ch, spans[0], spanLen[0], spans[1], spanLen[1]);
+        int n = got / ch;
+        for (int out = 0; out < n; out++) {
+            const int16_t* f = spanFrame(spans, spanLen, out, ch);
+            dst[out * 2] = f[0];
+            dst[out * 2 + 1] = f[ch - 1];
+        }
+        rb->commitRead(n * ch);
+        s->playedFrames += n;
+        return n;
+    }
+
+    // ===================================
+    // Mixer (Core 1)
+    // ===================================
+    // Renders one block of stereo frames from all active streams into `out`.
+    // Each output word is packed the same way as i2s.write16(): (L << 16) | R.
+    // Per-stream gain (volume, master attenuation) is computed once per block;
+    // only the frames of a block that fall inside a ramp step it per sample.
+    void processBlock(uint32_t* out, int frames) {
+        applyCommands();
+        memset(mixAcc, 0, frames * 2 * sizeof(int32_t));
+        int32_t master = masterAttenMultiplier;
+
+        uint32_t filterUs = 0;
+        uint32_t pitchUs = 0;
+        bool filtered = false;
+        bool pitched = false;
+
+        // 1. Mix Streams
+        if (streams && voices) {
+            for (int i = 0; i < maxStreams; i++) {
+                MixerVoice &v = voices[i];
+                if (!v.active) continue;
+                AudioStream* s = &streams[i];
+
+                // Pull this block from the stream (still consumed when silent, to keep it in time)
+                uint32_t speed = (s->type == STREAM_TYPE_PCM_RAM) ? 65536 : fxStreamSpeed(i);
+                uint32_t t0 = perfNow();
+                int n = renderStream(s, streamBlock, frames, speed);
+                if (speed != 65536) {
+                    pitchUs += perfNow() - t0;
+                    pitched = true;
+                }
+                if (n < frames && !s->fileFinished && s->playedFrames > 0) perfUnderrun(i);
+                if (n < 0) n = 0;
+
+                if (n > 0 && fxStreamFiltered(i)) {
+                    t0 = perfNow();
+                    fxFilterBlock(i, streamBlock, n);
+                    filterUs += perfNow() - t0;
+                    filtered = true;
+                }
+
+                // Ramp part of the block (the ramp runs on block time, underrun or not)
+                int done = 0;
+                if (v.rampSamples) {
+                    int r = (v.rampSamples < (uint32_t)frames) ? (int)v.rampSamples : frames;
+                    done = (r < n) ? r : n;
+                    mixStereoRamp(mixAcc, streamBlock, done, v.gain, v.step, master);
+                    v.gain += v.step * r;
+                    v.rampSamples -= r;
+                    if (v.rampSamples == 0) {
+                        v.gain = v.target;
+                        if (v.stopAtEnd) {
+                            // Faded out: stop reading the stream, Core 0 closes it
+                            v.stopAtEnd = false;
+                            v.active = false;
+                            continue;
+                        }
+                    }
+                }
+
+                int32_t gain = ((v.gain >> 8) * master) >> 8; // Q16
+                if (n > done && gain != 0) mixStereoBlock(mixAcc + done * 2, streamBlock + done * 2, n - done, gain);
+            }
+        }
+
+        // 2. Synth (CHRP / SYN), not affected by the master volume
+        uint32_t t0 = perfNow();
+        if (synthRenderBlock(mixAcc, frames)) perfFxStage(FX_STAGE_SYNTH, perfNow() - t0);
+
+        if (filtered) perfFxStage(FX_STAGE_FILTER, filterUs);
+        if (pitched) perfFxStage(FX_STAGE_PITCH, pitchUs);
+
+        // Look-ahead limiter, then the hard limit + pack for I2S
+        if (limiterEnabled) {
+            t0 = perfNow();
+            fxLimitBlock(mixAcc, frames);
+            perfFxStage(FX_STAGE_LIMITER, perfNow() - t0);
+        }
+        for (int f = 0; f < frames; f++) {
+            out[f] = packFrame(mixAcc[f * 2], mixAcc[f * 2 + 1]);
+        }
+    }
+}
@@ -6,6 +6,7 @@
 
 // State Tracking
 int lastPlayedRootIndex = 0; // 0-based index in rootTracks array
+static int rootTrackStream = 1; // Stream the last root track was started on
 
 // Helper to play a root track by index
 void playRootTrack(int index) {
@@ -22,28 +23,15 @@ void playRootTrack(int index) {
     char fullPath[128];
     snprintf(fullPath, sizeof(fullPath), "/%s", filename);
     
-    int streamToUse = 1; // Default to Stream 1 for legacy behavior
+    int streamToUse = (maxStreams > 1) ? 1 : 0; // Stream 1 for legacy behavior
     
     if (!legacyMonophonic) {
-        // Polyphonic Mode: Find first available stream
-        // Start checking from Stream 0 (assuming Stream 0 is also available for polyphony)
-        // or Stream 1 if Stream 0 is reserved for System? 
-        // System usually uses Stream 0. Let's use any available.
-        streamToUse = -1;
-        
-        // Try to find an inactive stream first
-        for (int i = 0; i < maxStreams; i++) {
-            if (!streams[i].active) {
-                streamToUse = i;
-                break;
-            }
-        }
-        
-        // If all active, steal the oldest one? Or just default to Stream 1?
-        // Let's default to Stream 1 if all full, effectively behaving like legacy for that moment
+        // Polyphonic Mode: a free stream, or one the allocator may take
+        // (root tracks count as Bank 0, #BANK_CLASSES default MUSIC)
+        streamToUse = allocateStream(0, bankClass[0]);
         if (streamToUse == -1) {
-            streamToUse = 1;
-             // Optional: stealing logic could go here
+            Serial.printf("COMPAT: No stream free for Root Track %d\n", index + 1);
+            return;
         }
     }
 
@@ -53,14 +41,17 @@ void playRootTrack(int index) {
     }
     
     if (startStream(streamToUse, fullPath)) {
+        claimStream(streamToUse, 0, bankClass[0]);
         lastPlayedRootIndex = index;
+        rootTrackStream = streamToUse;
         Serial.printf("COMPAT: Playing Root Track %d/%d (%s) on Stream %d\n", index + 1, rootTrackCount, filename, streamToUse);
     }
 }
 
 void action_togglePlayPause() {
-    if (streams[1].active) {
-        stopStream(1);
+    if (rootTrackStream >= maxStreams) rootTrackStream = 0;
+    if (streams[rootTrackStream].active) {
+        stopStream(rootTrackStream);
         Serial.println("COMPAT: Stop");
     } else {
         // Play last played root track
@@ -120,10 +111,8 @@ void action_setSparkfunVolume(uint8_t sfVol) {
     if (vol > 1.0f) vol = 1.0f;
     
     // Apply to ALL streams for global volume control effect
-    if (streams) {
-        for (int i = 0; i < maxStreams; i++) {
-            streams[i].volume = vol;
-        }
+    for (int i = 0; i < maxStreams; i++) {
+        setStreamVolume(i, vol);
     }
     Serial.printf("COMPAT: Volume set to %.2f\n", vol);
 }
@@ -14,6 +14,10 @@ MP4Parser::MP4Parser() {
     channels = 2;
     currentSample = 0;
     totalSamples = 0;
+    stszDefaultSize = 0;
+    memset(&stszTable, 0, sizeof(stszTable));
+    memset(&stcoTable, 0, sizeof(stcoTable));
+    memset(&stscTable, 0, sizeof(stscTable));
 }
 
 void MP4Parser::close() {
@@ -52,6 +56,61 @@ uint32_t MP4Parser::getPos() {
     return sdFile.position();
 }
 
+// ===================================
+// Sample Table Cache
+// ===================================
+// Sets up a table window. The PSRAM buffer is allocated on first use and
+// kept for the life of the stream (re-used by every file it plays).
+bool MP4Parser::initTable(MP4TableWindow &t, uint32_t capacity, uint32_t stride, uint32_t fileOffset, uint32_t entryCount) {
+    if (!t.data) {
+        t.data = (uint32_t*)pmalloc(capacity * stride * sizeof(uint32_t));
+        if (!t.data) return false;
+        t.capacity = capacity;
+        t.stride = stride;
+    }
+    t.fileOffset = fileOffset;
+    t.entryCount = entryCount;
+    t.base = 0;
+    t.valid = 0;
+    return true;
+}
+
+// Returns the entry at `index` (stride words), paging in the window that
+// starts there on a miss. One seek + one bulk read per window instead of a
+// seek per frame. Returns nullptr past the end of the table.
+const uint32_t* MP4Parser::tableEntry(MP4TableWindow &t, uint32_t index) {
+    if (index >= t.entryCount) return nullptr;
+    
+    if (index < t.base || index >= t.base + t.valid) {
+        uint32_t n = t.entryCount - index;
+        if (n > t.capacity) n = t.capacity;
+        
+        seek(t.fileOffset + index * t.stride * 4);
+        read((uint8_t*)t.data, n * t.stride * 4);
+        
+        // Big Endian -> native, in place
+        uint8_t* b = (uint8_t*)t.data;
+        for (uint32_t i = 0; i < n * t.stride; i++, b += 4) {
+            t.data[i] = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+        }
+        t.base = index;
+        t.valid = n;
+    }
+    return &t.data[(index - t.base) * t.stride];
+}
+
+// Moves the STSC cursor to the run containing currentChunk.
+// Runs are sorted by first chunk, so playback only ever walks forward.
+void MP4Parser::advanceStsc() {
+    while (nextChunkRunStart != 0 && currentChunk >= nextChunkRunStart) {
+        stscIndex++;
+        const uint32_t* e = tableEntry(stscTable, stscIndex);
+        if (e) samplesInCurrentChunk = e[1];
+        const uint32_t* next = tableEntry(stscTable, stscIndex + 1);
+        nextChunkRunStart = next ? next[0] : 0;
+    }
+}
+
 bool MP4Parser::open(const char* filename, bool isFlash) {
     usingFlash = isFlash;
     
@@ -136,18 +195,39 @@ bool MP4Parser::open(const char* filename, bool isFlash) {
         #endif
         
         // Initialize Reading State
-        // Read first STSC entry
-        seek(stscOffset + 12); // Skip version/flags + count
-        // We need to preload the first run
-        seek(stscOffset + 16); // First entry
+        // Table headers: Size(4) Type(4) Version/Flags(4), then...
+        seek(stszOffset + 12);
+        stszDefaultSize = readUI32BE(); // stsz: SampleSize(4) Count(4) Entries
+        totalSamples = readUI32BE();
+        seek(stcoOffset + 12);
+        uint32_t chunkCount = readUI32BE(); // stco: Count(4) Entries
+        seek(stscOffset + 12);
+        stscCount = readUI32BE(); // stsc: Count(4) Entries (3 words)
+        
+        // Load the sample tables (or their first window) into PSRAM
+        bool tablesOk = initTable(stcoTable, MP4_STCO_WINDOW, 1, stcoOffset + 16, chunkCount) &&
+                        initTable(stscTable, MP4_STSC_WINDOW, 3, stscOffset + 16, stscCount);
+        if (stszDefaultSize == 0) {
+            tablesOk = tablesOk && initTable(stszTable, MP4_STSZ_WINDOW, 1, stszOffset + 20, totalSamples);
+        }
+        if (!tablesOk) {
+            Serial.println("MP4Parser: ERROR - Sample table allocation failed");
+            return false;
+        }
+        
+        // First STSC run
         currentChunk = 1; // 1-based
-        uint32_t firstChunk = readUI32BE();
-        samplesInCurrentChunk = readUI32BE();
-        // Skip ID
+        stscIndex = 0;
+        const uint32_t* run = tableEntry(stscTable, 0);
+        samplesInCurrentChunk = run ? run[1] : 0;
+        const uint32_t* next = tableEntry(stscTable, 1);
+        nextChunkRunStart = next ? next[0] : 0;
         
         // Initial Offset from STCO
-        seek(stcoOffset + 16); // First entry
-        currentOffset = readUI32BE();
+        const uint32_t* chunk = tableEntry(stcoTable, 0);
+        if (!chunk) return false;
+        currentOffset = chunk[0];
+        if (stszDefaultSize == 0) tableEntry(stszTable, 0);
         
         return true;
     }
@@ -374,76 +454,47 @@ void generateAdtsHeader(uint8_t* header, int len, int profile, int sampleRate, i
     header[6] = 0xFC;
 }
 
+// Reads the next AAC access unit and prefixes it with an ADTS header.
+// Table lookups come from the PSRAM windows, so a frame costs one seek (and
+// none while frames in a chunk follow each other) plus its data read.
 size_t MP4Parser::readNextFrame(uint8_t* buffer, size_t bufferSize) {
     if (stszOffset == 0) return 0;
+    if (currentSample >= totalSamples) return 0; // EOF
     
     // 1. Get Sample Size
-    // Seek to STSZ table entry
-    // Header(12) + Size(4) + Count(4) -> Data starts at +20
-    // If Size != 0, all samples are same size.
-    
-    // Optimization: Cache stsz mode?
-    // Doing strict seek every time for memory safety
-    seek(stszOffset + 12);
-    uint32_t defaultSize = readUI32BE();
-    uint32_t count = readUI32BE();
-    
-    if (currentSample >= count) return 0; // EOF
-    
-    uint32_t frameSize = defaultSize;
+    uint32_t frameSize = stszDefaultSize;
     if (frameSize == 0) {
-        seek(stszOffset + 20 + (currentSample * 4));
-        frameSize = readUI32BE();
+        const uint32_t* e = tableEntry(stszTable, currentSample);
+        if (!e) return 0;
+        frameSize = e[0];
     }
     
     // Check buffer space (ADTS + Frame)
     if (frameSize + 7 > bufferSize) return 0; // Too big
     
     // 2. Get File Offset (Handle Chunks)
-    // Simple logic:
-    // If samplesReadInChunk >= samplesInCurrentChunk, move to next chunk
-    // Update currentOffset from STCO
-    
-    if (samplesReadInChunk >= samplesInCurrentChunk) {
+    // STSC runs: FirstChunk, SamplesPerChunk, SampleDescId
+    //   1, 4, 1
+    //   10, 8, 1
+    // Means: Chunks 1-9 have 4 samples. Chunk 10+ has 8.
+    bool seekNeeded = false;
+    while (samplesReadInChunk >= samplesInCurrentChunk) {
         // Next Chunk
         currentChunk++;
         samplesReadInChunk = 0;
         
-        // Get Offset from STCO
-        seek(stcoOffset + 16 + ((currentChunk - 1) * 4));
-        currentOffset = readUI32BE();
-        
-        // Update Samples Per Chunk (STSC)
-        // Check if next chunk starts a new run
-        /* 
-           STSC Table:
-           FirstChunk, SamplesPerChunk, SampleDescId
-           1, 4, 1
-           10, 8, 1
-           
-           Means: Chunks 1-9 have 4 samples. Chunk 10+ has 8.
-        */
-        // This part is tricky without keeping state.
-        // Simplification: We need to re-read STSC or maintain state.
-        // Let's assume we maintain stscIndex, nextChunkRunStart, samplesInCurrentChunk
-        // TODO: Implement robust STSC logic.
-        // For now, assuming fixed samples per chunk or simple lookup every time (slow but safe).
+        const uint32_t* chunk = tableEntry(stcoTable, currentChunk - 1);
+        if (!chunk) return 0; // Ran off the chunk table
+        currentOffset = chunk[0];
+        seekNeeded = true;
         
-        seek(stscOffset + 12);
-        uint32_t entryCount = readUI32BE();
-        // Find entry for currentChunk
-        for (uint32_t i=0; i<entryCount; i++) {
-             uint32_t firstChunk = readUI32BE();
-             uint32_t samplesPer = readUI32BE();
-             readUI32BE(); // ID
-             
-             if (firstChunk > currentChunk) break;
-             samplesInCurrentChunk = samplesPer;
-        }
+        advanceStsc();
+        if (samplesInCurrentChunk == 0 && nextChunkRunStart == 0) return 0; // Corrupt stsc
     }
     
     // 3. Read Frame
-    seek(currentOffset);
+    // A table window load moves the file position, so always check
+    if (seekNeeded || getPos() != currentOffset) seek(currentOffset);
     
     generateAdtsHeader(buffer, frameSize + 7, 2, sampleRate, channels);
     read(buffer + 7, frameSize);
@@ -454,3 +505,64 @@ size_t MP4Parser::readNextFrame(uint8_t* buffer, size_t bufferSize) {
     
     return frameSize + 7;
 }
+
+// Moves the cursor to access unit `sample` (0-based) using the cached
+// tables: walks the stsc runs to find its chunk, takes the chunk offset from
+// stco and adds the sizes of the samples before it in that chunk.
+// Returns false if the sample is past the end of the track.
+bool MP4Parser::seekToSample(uint32_t sample) {
+    if (stszOffset == 0 || sample >= totalSamples) return false;
+    
+    // 1. Find the run (and chunk) holding the sample
+    uint32_t runFirstSample = 0;
+    uint32_t index = 0;
+    const uint32_t* run = tableEntry(stscTable, 0);
+    if (!run) return false;
+    
+    // Copied out: fetching the next entry can reload the window under `run`
+    uint32_t firstChunk = run[0];
+    uint32_t samplesPer = run[1];
+    while (true) {
+        const uint32_t* next = tableEntry(stscTable, index + 1);
+        uint32_t runChunks = next ? next[0] - firstChunk : 0xFFFFFFFF; // Last run covers the rest
+        uint64_t runSamples = (uint64_t)runChunks * samplesPer;
+        if (!next || sample < runFirstSample + runSamples) break;
+        
+        runFirstSample += (uint32_t)runSamples;
+        index++;
+        firstChunk = next[0];
+        samplesPer = next[1];
+    }
+    if (samplesPer == 0) return false;
+    
+    uint32_t chunk = firstChunk + (sample - runFirstSample) / samplesPer; // 1-based
+    uint32_t inChunk = (sample - runFirstSample) % samplesPer;
+    
+    // 2. Chunk Offset + preceding samples in the chunk
+    const uint32_t* chunkEntry = tableEntry(stcoTable, chunk - 1);
+    if (!chunkEntry) return false;
+    uint32_t offset = chunkEntry[0];
+    
+    uint32_t firstInChunk = sample - inChunk;
+    if (stszDefaultSize != 0) {
+        offset += inChunk * stszDefaultSize;
+    } else {
+        for (uint32_t i = firstInChunk; i < sample; i++) {
+            const uint32_t* e = tableEntry(stszTable, i);
+            if (!e) return false;
+            offset += e[0];
+        }
+    }
+    
+    // 3. Cursor State
+    stscIndex = index;
+    samplesInCurrentChunk = samplesPer;
+    const uint32_t* next = tableEntry(stscTable, index + 1);
+    nextChunkRunStart = next ? next[0] : 0;
+    currentChunk = chunk;
+    samplesReadInChunk = inChunk;
+    currentOffset = offset;
+    currentSample = sample;
+    seek(currentOffset);
+    return true;
+}
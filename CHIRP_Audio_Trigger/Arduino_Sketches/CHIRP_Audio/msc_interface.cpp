@@ -5,16 +5,141 @@
 // ===================================
 // MSC Callbacks
 // ===================================
+// The host asks for a sector or a few at a time. Reads that carry on where
+// the last one ended are read ahead MSC_BATCH_SECTORS at a time, and
+// back-to-back writes are combined up to as many, so the card sees a few
+// multi-sector commands instead of one per sector. Card time is handed out
+// by sdIoSectors(); when it says busy the callback returns 0 and TinyUSB
+// asks again, so a large copy never holds up loop() and the flash streams.
+// Nothing here waits for the card; only stopMSC() does.
+//
+// The host has been told a combined write succeeded by the time it goes to
+// the card, so if that write fails every later transfer fails too: the
+// host's copy stops with an I/O error instead of carrying on past lost data.
+static uint32_t cardSectors = 0;      // Read once in startMSC()
+static uint8_t* readCache = nullptr;  // MSC_BATCH_SECTORS sectors (SRAM)
+static uint32_t readLba = 0;          // First sector in readCache
+static uint32_t readCount = 0;        // Sectors in readCache, 0 if empty
+static uint32_t nextReadLba = 0;      // Sector after the host's last read
+static uint8_t* writeCache = nullptr;
+static uint32_t writeLba = 0;
+static uint32_t writeCount = 0;       // Sectors waiting to be written
+static uint32_t lastWriteMs = 0;
+static bool flushPending = false;     // SYNCHRONIZE CACHE waiting for the card
+static bool writeFailed = false;      // A combined write failed: fail every transfer from here on
+
+static void writeFailure(uint32_t lba, uint32_t count) {
+    Serial.printf("MSC: ERROR - Writing sectors %lu-%lu failed, failing all further transfers\n",
+                  (unsigned long)lba, (unsigned long)(lba + count - 1));
+    writeFailed = true;
+}
+
+// Writes the combined sectors. Returns 0 if the card is busy, else they are done with.
+static int flushWrites() {
+    if (writeCount == 0) return 1;
+    int r = sdIoSectors(writeLba, writeCache, writeCount, true);
+    if (r < 0) writeFailure(writeLba, writeCount);
+    if (r != 0) writeCount = 0;
+    return r;
+}
+
+// Writes what is waiting and syncs the card. False if the card was busy.
+static bool syncCard() {
+    if (flushWrites() == 0) return false;
+    if (!mutex_try_enter(&sd_mutex, nullptr)) return false;
+    sd.card()->syncDevice();
+    mutex_exit(&sd_mutex);
+    return true;
+}
+
+// The same, waiting for the card (stopMSC(), from loop())
+static void syncCardBlocking() {
+    mutex_enter_blocking(&sd_mutex);
+    if (writeCount > 0 && !sd.card()->writeSectors(writeLba, writeCache, writeCount)) {
+        writeFailure(writeLba, writeCount);
+    }
+    writeCount = 0;
+    sd.card()->syncDevice();
+    mutex_exit(&sd_mutex);
+    flushPending = false;
+}
+
 int32_t msc_read_cb(uint32_t lba, void* buffer, uint32_t bufsize) {
-    return sd.card()->readSectors(lba, (uint8_t*)buffer, bufsize / 512) ? bufsize : -1;
+    uint32_t count = bufsize / 512;
+    if (writeFailed) return -1;
+    if (lba < readLba || lba + count > readLba + readCount) {
+        // The host may read back what it just wrote
+        int r = flushWrites();
+        if (r <= 0) return r;
+
+        uint32_t batch = count;
+        if (lba == nextReadLba && count < MSC_BATCH_SECTORS) batch = MSC_BATCH_SECTORS; // Sequential: read ahead
+        if (lba + batch > cardSectors) batch = (cardSectors > lba) ? cardSectors - lba : count;
+        if (batch > MSC_BATCH_SECTORS) {
+            // Larger than the cache: straight into the host's buffer
+            r = sdIoSectors(lba, (uint8_t*)buffer, count, false);
+            if (r > 0) nextReadLba = lba + count;
+            return (r > 0) ? (int32_t)bufsize : r;
+        }
+        readCount = 0;
+        r = sdIoSectors(lba, readCache, batch, false);
+        if (r <= 0) return r;
+        readLba = lba;
+        readCount = batch;
+    }
+    memcpy(buffer, readCache + (lba - readLba) * 512, bufsize);
+    nextReadLba = lba + count;
+    return bufsize;
 }
 
 int32_t msc_write_cb(uint32_t lba, uint8_t* buffer, uint32_t bufsize) {
-    return sd.card()->writeSectors(lba, buffer, bufsize / 512) ? bufsize : -1;
+    uint32_t count = bufsize / 512;
+    if (writeFailed) return -1;
+    if (lba < readLba + readCount && lba + count > readLba) readCount = 0; // Stale now
+
+    bool appends = writeCount > 0 && lba == writeLba + writeCount && writeCount + count <= MSC_BATCH_SECTORS;
+    if (!appends) {
+        int r = flushWrites();
+        if (r <= 0) return r;
+        if (count > MSC_BATCH_SECTORS) {
+            r = sdIoSectors(lba, buffer, count, true);
+            if (r < 0) writeFailure(lba, count);
+            return (r > 0) ? (int32_t)bufsize : r;
+        }
+        writeLba = lba;
+    }
+    memcpy(writeCache + writeCount * 512, buffer, bufsize);
+    writeCount += count;
+    lastWriteMs = millis();
+    if (writeCount == MSC_BATCH_SECTORS) flushWrites(); // Else the next write or service does it
+    return bufsize;
 }
 
+// SYNCHRONIZE CACHE (eject, or the host flushing): if the card is busy
+// serviceMSC() finishes it on the next pass
 void msc_flush_cb(void) {
-    sd.card()->syncDevice();
+    flushPending = !syncCard();
+}
+
+// ===================================
+// Service (Core 0, main loop)
+// ===================================
+// Opens a new card time slice for the host, after this pass's refills, and
+// writes combined sectors the host has stopped adding to.
+void serviceMSC() {
+    if (!g_mscActive) return;
+    sdIoMscSlice();
+    if (flushPending) flushPending = !syncCard();
+    else if (writeCount > 0 && millis() - lastWriteMs >= MSC_WRITE_IDLE_MS) flushWrites();
+}
+
+// Waits out USB re-enumeration with the flash streams still refilled
+static void waitServicingAudio(uint32_t ms) {
+    uint32_t t0 = millis();
+    while (millis() - t0 < ms) {
+        fillStreamBuffers();
+        delay(1);
+    }
 }
 
 // ===================================
@@ -37,20 +162,38 @@ void startMSC() {
         usb_msc = new Adafruit_USBD_MSC();
     }
 
-    // 1. Stop all SD streams
+    // Cache buffers, SRAM (kept for the next time)
+    if (!readCache) readCache = (uint8_t*)malloc(MSC_BATCH_SECTORS * 512);
+    if (!writeCache) writeCache = (uint8_t*)malloc(MSC_BATCH_SECTORS * 512);
+    if (!readCache || !writeCache) {
+        Serial.println("[!!!] MSC Setup Failed! (no memory)");
+        return;
+    }
+    readCount = 0;
+    writeCount = 0;
+    nextReadLba = 0;
+    flushPending = false;
+    writeFailed = false;
+
+    // 1. Stop all SD streams (flash and RAM streams play on)
     if (streams) {
         for (int i = 0; i < maxStreams; i++) {
-            if (streams[i].active && (streams[i].type == STREAM_TYPE_WAV_SD || streams[i].type == STREAM_TYPE_MP3_SD)) {
-                stopStream(i); // This releases SdFat file handles
+            if (isSdStream(&streams[i])) {
+                stopStream(i, STREAM_STEAL_FADE_MS); // This releases SdFat file handles
             }
         }
     }
     
-    // Setting `g_mscActive = true` effectively disables `fillStreamBuffers` SD access (we will add that check).
+    // From here nothing but the host touches the card (refills, warm cache,
+    // sync and voice prompts all check it). Taking the card once makes sure
+    // whatever was still using it has finished.
+    sdIoBegin(SD_IO_FILE);
     g_mscActive = true;
+    sdIoEnd();
 
     // USB MSC Config (note the -> instead of . now)
     uint32_t block_count = sd.card()->sectorCount();
+    cardSectors = block_count;
     usb_msc->setID("CHIRP", "Audio SD", "1.0");
     usb_msc->setReadWriteCallback(msc_read_cb, msc_write_cb, msc_flush_cb);
     usb_msc->setCapacity(block_count, 512);
@@ -59,7 +202,7 @@ void startMSC() {
     // Force re-enumeration
     if (TinyUSBDevice.mounted()) {
       TinyUSBDevice.detach();
-      delay(1000); // Matched to Test Sketch
+      waitServicingAudio(1000); // Matched to Test Sketch
       TinyUSBDevice.attach();
     }
 
@@ -82,16 +225,23 @@ void stopMSC() {
     usb_msc->setUnitReady(false);  // Note: -> instead of .
     
     // Detach to remove drive from PC
+    syncCardBlocking(); // Anything the host didn't flush itself
+    readCount = 0;
+
     if (TinyUSBDevice.mounted()) {
         TinyUSBDevice.detach();
-        delay(1000); // Matched to Test Sketch
+        waitServicingAudio(1000); // Matched to Test Sketch
         TinyUSBDevice.attach();
     }
     
     // We don't need to reset Pins if we never changed them.
-    // But we need to make sure SdFat is happy.
-    
+    // But SdFat's cached FAT and directory sectors may be stale now.
+    mutex_enter_blocking(&sd_mutex);
+    if (!sd.volumeBegin()) {
+        Serial.println("[!!!] SD volume remount failed!");
+    }
     g_mscActive = false;
+    mutex_exit(&sd_mutex);
     Serial.println("[---] MSC Interface INACTIVE.");
 }
 
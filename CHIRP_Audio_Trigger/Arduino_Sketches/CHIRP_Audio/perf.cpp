@@ -0,0 +1,214 @@
+// Runtime Profiling (Core 0 + Core 1)
+// Always-on counters for checking headroom on a deployed board (PERF and
+// PERF:RESET serial commands). Build with PERF_ENABLE 0 to compile the hooks
+// out. Latencies go into power-of-two histograms: bin b counts samples of
+// [2^b, 2^(b+1)) us (bin 0 also holds 0), so percentiles are reported as
+// the upper edge of their bin. Each counter has a single writer core.
+#include "config.h"
+
+#if PERF_ENABLE
+
+struct PerfHist {
+    volatile uint32_t count;
+    volatile uint32_t max;
+    volatile uint32_t bins[PERF_HIST_BINS];
+};
+
+struct PerfStream {
+    PerfHist decode;            // us per decoded frame (Core 0)
+    uint32_t decodeMark;        // Start of the frame being decoded
+    volatile uint32_t lowMs;    // Buffer low-water mark while playing (Core 0)
+    volatile uint32_t underruns;// Blocks the mixer came up short (Core 1)
+};
+
+static PerfHist sdReads;
+static PerfHist flashReads;
+static PerfStream* perfStreams = nullptr;
+
+// Mixer (Core 1)
+static volatile uint32_t mixBlocks = 0;
+static volatile uint32_t mixBusyUs = 0;
+static volatile uint32_t mixMaxUs = 0;
+
+// Effects stages (Core 1), blocks they ran in
+struct PerfFx {
+    volatile uint32_t blocks;
+    volatile uint32_t busyUs;
+    volatile uint32_t maxUs;
+};
+static PerfFx fxStages[FX_STAGE_COUNT];
+static const char* const fxStageNames[FX_STAGE_COUNT] = { "FILTER", "PITCH", "LIMITER", "SYNTH" };
+
+static inline void histAdd(PerfHist &h, uint32_t us) {
+    int bin = (us == 0) ? 0 : 31 - __builtin_clz(us);
+    if (bin >= PERF_HIST_BINS) bin = PERF_HIST_BINS - 1;
+    h.bins[bin]++;
+    h.count++;
+    if (us > h.max) h.max = us;
+}
+
+static void histClear(PerfHist &h) {
+    h.count = 0;
+    h.max = 0;
+    for (int b = 0; b < PERF_HIST_BINS; b++) h.bins[b] = 0;
+}
+
+// Upper edge (us) of the bin holding the given percentile
+static uint32_t histPercentile(const PerfHist &h, int pct) {
+    uint32_t count = h.count;
+    if (count == 0) return 0;
+    uint32_t target = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (int b = 0; b < PERF_HIST_BINS; b++) {
+        seen += h.bins[b];
+        if (seen >= target) {
+            uint32_t edge = (2u << b) - 1;
+            return (edge < h.max) ? edge : h.max;
+        }
+    }
+    return h.max;
+}
+
+// ===================================
+// Init / Reset (Core 0)
+// ===================================
+static void resetCore0() {
+    histClear(sdReads);
+    histClear(flashReads);
+    if (perfStreams) {
+        for (int i = 0; i < maxStreams; i++) {
+            histClear(perfStreams[i].decode);
+            perfStreams[i].lowMs = UINT32_MAX;
+        }
+    }
+}
+
+// Core 1's counters start at zero
+void perfInit() {
+    if (!perfStreams) perfStreams = new PerfStream[maxStreams]();
+    resetCore0();
+}
+
+// Core 1 clears its own counters, so a block in flight can't write back
+// pre-reset values; waits for that so the next PERF starts clean
+void perfReset() {
+    resetCore0();
+    mixerSync(mixerPerfReset());
+}
+
+// ===================================
+// Reset (Core 1, MIXER_CMD_PERF_RESET)
+// ===================================
+void perfResetMixer() {
+    if (perfStreams) {
+        for (int i = 0; i < maxStreams; i++) perfStreams[i].underruns = 0;
+    }
+    mixBlocks = 0;
+    mixBusyUs = 0;
+    mixMaxUs = 0;
+    for (int f = 0; f < FX_STAGE_COUNT; f++) {
+        fxStages[f].blocks = 0;
+        fxStages[f].busyUs = 0;
+        fxStages[f].maxUs = 0;
+    }
+}
+
+// ===================================
+// Hooks
+// ===================================
+void perfRead(bool sd, uint32_t us) {
+    histAdd(sd ? sdReads : flashReads, us);
+}
+
+void perfDecodeBegin(int stream) {
+    if (perfStreams) perfStreams[stream].decodeMark = micros();
+}
+
+// Called from the decoder callbacks: the time since the write() started (or
+// since the previous frame of the same write) is this frame's decode time
+void perfDecodeFrame(int stream) {
+    if (!perfStreams) return;
+    uint32_t now = micros();
+    histAdd(perfStreams[stream].decode, now - perfStreams[stream].decodeMark);
+    perfStreams[stream].decodeMark = now;
+}
+
+void perfBufferLevel(int stream, uint32_t ms) {
+    if (perfStreams && ms < perfStreams[stream].lowMs) perfStreams[stream].lowMs = ms;
+}
+
+void perfUnderrun(int stream) {
+    if (perfStreams) perfStreams[stream].underruns++;
+}
+
+void perfMixBlock(uint32_t us) {
+    mixBlocks++;
+    mixBusyUs += us;
+    if (us > mixMaxUs) mixMaxUs = us;
+}
+
+void perfFxStage(int stage, uint32_t us) {
+    PerfFx &f = fxStages[stage];
+    f.blocks++;
+    f.busyUs += us;
+    if (us > f.maxUs) f.maxUs = us;
+}
+
+// ===================================
+// Report (PERF command)
+// ===================================
+// PERF:MIX,blocks,load_permille,avg_us,max_us,budget_us
+// PERF:SD,reads,p50_us,p90_us,p99_us,max_us      (also PERF:FLASH)
+// PERF:S<n>,frames,p50_us,p90_us,p99_us,max_us,low_ms,underruns
+//   low_ms is -1 until the stream has played.
+// PERF:FX,<FILTER|PITCH|LIMITER|SYNTH>,blocks,load_permille,avg_us,max_us
+//   Per mixer block the stage ran in (all filtered / pitched streams, or all
+//   synth voices, together),
+//   load against the same block budget as PERF:MIX.
+void perfReport(Stream &serial) {
+    const uint32_t budgetUs = (uint32_t)(((uint64_t)MIXER_BLOCK_FRAMES * 1000000) / SAMPLE_RATE);
+    uint32_t blocks = mixBlocks;
+    uint32_t busy = mixBusyUs;
+    uint32_t load = blocks ? (uint32_t)(((uint64_t)busy * 1000) / ((uint64_t)blocks * budgetUs)) : 0;
+    sendSerialResponseF(serial, "PERF:MIX,%lu,%lu,%lu,%lu,%lu",
+                        (unsigned long)blocks, (unsigned long)load,
+                        (unsigned long)(blocks ? busy / blocks : 0),
+                        (unsigned long)mixMaxUs, (unsigned long)budgetUs);
+
+    const PerfHist* reads[2] = { &sdReads, &flashReads };
+    const char* names[2] = { "SD", "FLASH" };
+    for (int r = 0; r < 2; r++) {
+        const PerfHist &h = *reads[r];
+        sendSerialResponseF(serial, "PERF:%s,%lu,%lu,%lu,%lu,%lu", names[r],
+                            (unsigned long)h.count, (unsigned long)histPercentile(h, 50),
+                            (unsigned long)histPercentile(h, 90), (unsigned long)histPercentile(h, 99),
+                            (unsigned long)h.max);
+    }
+
+    for (int f = 0; f < FX_STAGE_COUNT; f++) {
+        const PerfFx &p = fxStages[f];
+        uint32_t n = p.blocks;
+        uint32_t us = p.busyUs;
+        sendSerialResponseF(serial, "PERF:FX,%s,%lu,%lu,%lu,%lu", fxStageNames[f], (unsigned long)n,
+                            (unsigned long)(n ? (uint32_t)(((uint64_t)us * 1000) / ((uint64_t)n * budgetUs)) : 0),
+                            (unsigned long)(n ? us / n : 0), (unsigned long)p.maxUs);
+    }
+
+    for (int i = 0; perfStreams && i < maxStreams; i++) {
+        const PerfStream &p = perfStreams[i];
+        sendSerialResponseF(serial, "PERF:S%d,%lu,%lu,%lu,%lu,%lu,%ld,%lu", i,
+                            (unsigned long)p.decode.count, (unsigned long)histPercentile(p.decode, 50),
+                            (unsigned long)histPercentile(p.decode, 90), (unsigned long)histPercentile(p.decode, 99),
+                            (unsigned long)p.decode.max,
+                            (p.lowMs == UINT32_MAX) ? -1L : (long)p.lowMs,
+                            (unsigned long)p.underruns);
+    }
+}
+
+#else // PERF_ENABLE
+
+void perfReport(Stream &serial) {
+    serial.println("ERR:PERF - Built with PERF_ENABLE 0");
+}
+
+#endif // PERF_ENABLE
@@ -0,0 +1,230 @@
+// RAM-resident Bank 1 (Core 0 load, Core 1 playback)
+// With #BANK1_RAM 1 the active Bank 1 page is loaded at boot into one
+// contiguous PSRAM arena, already at SAMPLE_RATE. Bank 1 streams then play
+// as STREAM_TYPE_PCM_RAM: the mixer reads straight from the arena, with no
+// file, ring buffer, flash_mutex or refill work on Core 0. IMA-ADPCM
+// variants in flash (#BANK1_ADPCM) are decoded as they load.
+#include "config.h"
+
+bool bank1RamMode = false;
+
+struct RamSample {
+    uint32_t key;         // pathHash() of the full playback path
+    const int16_t* pcm;   // In the arena, native channels at SAMPLE_RATE
+    uint32_t frames;
+    uint8_t channels;
+};
+
+static RamSample* ramSamples = nullptr;
+static int ramSampleCount = 0;
+static int16_t* arena = nullptr;
+
+static bool isFlashPath(const char* path) {
+    return strncmp(path, "/flash/", 7) == 0;
+}
+
+// Reads the layout of one variant. Takes the file's mutex (or the card).
+static bool probeVariant(const char* path, WavLayout &layout) {
+    bool ok = false;
+    if (isFlashPath(path)) {
+        mutex_enter_blocking(&flash_mutex);
+        File f = LittleFS.open(path, "r");
+        if (f) {
+            ok = readWavLayout(f, layout, true);
+            f.close();
+        }
+        mutex_exit(&flash_mutex);
+    } else {
+        sdIoBegin(SD_IO_BULK);
+        FsFile f = sd.open(path, FILE_READ);
+        if (f) {
+            ok = readWavLayout(f, layout);
+            f.close();
+        }
+        sdIoEnd();
+    }
+    return ok;
+}
+
+// Reads `len` PCM bytes of a variant into dst. Takes the file's mutex (or the card).
+static bool readVariant(const char* path, const WavLayout &layout, uint8_t* dst, uint32_t len) {
+    int n = 0;
+    if (isFlashPath(path)) {
+        mutex_enter_blocking(&flash_mutex);
+        File f = LittleFS.open(path, "r");
+        if (f) {
+            f.seek(layout.dataStart);
+            if (layout.blockAlign) {
+                n = adpcmReadFrames(f, layout, (int16_t*)dst, len / (layout.channels * 2)) * layout.channels * 2;
+            } else {
+                n = f.read(dst, len);
+            }
+            f.close();
+        }
+        mutex_exit(&flash_mutex);
+    } else {
+        sdIoBegin(SD_IO_BULK);
+        FsFile f = sd.open(path, FILE_READ);
+        bool opened = f && f.seek(layout.dataStart);
+        sdIoEnd();
+        if (opened) n = sdIoRead(f, dst, len, SD_IO_BULK);
+        sdIoBegin(SD_IO_BULK);
+        if (f) f.close();
+        sdIoEnd();
+    }
+    return n == (int)len;
+}
+
+// Frames a variant occupies at SAMPLE_RATE
+static uint32_t outputFrames(const WavLayout &layout) {
+    uint32_t inFrames = layout.frames;
+    if (layout.sampleRate == SAMPLE_RATE || layout.sampleRate == 0) return inFrames;
+    return (uint32_t)(((uint64_t)inFrames * SAMPLE_RATE) / layout.sampleRate);
+}
+
+// Arena frames reserved for a variant. Non-native rates are converted in
+// place, so the source is loaded at the end of a region that has room for
+// both it and the converted clip (see resampleBuffer()).
+static uint32_t regionFrames(const WavLayout &layout) {
+    uint32_t inFrames = layout.frames;
+    if (layout.sampleRate == SAMPLE_RATE) return inFrames;
+    uint32_t outFrames = outputFrames(layout);
+    return ((outFrames > inFrames) ? outFrames : inFrames) + RESAMPLER_TAPS;
+}
+
+// ===================================
+// Load Arena (Core 0, boot)
+// ===================================
+// Returns false (and leaves Bank 1 streaming from its files) if the mode is
+// off or the page doesn't fit in free PSRAM.
+bool initBank1Ram() {
+    if (!bank1RamMode) return false;
+
+    int count = 0;
+    for (int i = 0; i < bank1SoundCount; i++) count += bank1Sounds[i].variantCount;
+    if (count == 0) return false;
+
+    uint32_t t0 = millis();
+    WavLayout* layouts = new WavLayout[count];
+    char path[128];
+
+    // 1. Probe every variant, size the arena
+    uint64_t totalBytes = 0;
+    int v = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        for (int k = 0; k < bank1Sounds[i].variantCount; k++, v++) {
+            bank1PlayPath(path, sizeof(path), bank1Sounds[i], k);
+            if (!probeVariant(path, layouts[v]) || layouts[v].sampleRate == 0) {
+                layouts[v].frames = 0; // Unsupported, left to stream from its file
+                continue;
+            }
+            totalBytes += (uint64_t)regionFrames(layouts[v]) * layouts[v].channels * 2;
+        }
+    }
+
+    uint32_t freePsram = rp2040.getFreePSRAMHeap();
+    if (totalBytes + BANK1_RAM_RESERVE > freePsram) {
+        Serial.printf("Bank 1 RAM: Needs %lu KB, only %lu KB PSRAM free. Streaming from files instead.\n",
+                      (unsigned long)(totalBytes / 1024), (unsigned long)(freePsram / 1024));
+        delete[] layouts;
+        return false;
+    }
+
+    arena = (int16_t*)pmalloc((size_t)totalBytes);
+    ramSamples = (RamSample*)pmalloc(count * sizeof(RamSample));
+    if (!arena || !ramSamples) {
+        Serial.println("Bank 1 RAM: ERROR - PSRAM allocation failed. Streaming from files instead.");
+        arena = nullptr;
+        ramSamples = nullptr;
+        delete[] layouts;
+        return false;
+    }
+
+    // 2. Load (and convert) each variant into its region
+    int16_t* region = arena;
+    ramSampleCount = 0;
+    v = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        for (int k = 0; k < bank1Sounds[i].variantCount; k++, v++) {
+            WavLayout &l = layouts[v];
+            if (l.frames == 0) continue;
+            bank1PlayPath(path, sizeof(path), bank1Sounds[i], k);
+
+            uint32_t inFrames = l.frames;
+            uint32_t outFrames = outputFrames(l);
+            uint32_t regFrames = regionFrames(l);
+            int16_t* src = region + (regFrames - inFrames) * l.channels;
+
+            if (!readVariant(path, l, (uint8_t*)src, inFrames * l.channels * 2)) {
+                Serial.printf("Bank 1 RAM: Failed to read %s\n", path);
+                region += regFrames * l.channels;
+                continue;
+            }
+            if (l.sampleRate != SAMPLE_RATE) {
+                resampleBuffer(src, inFrames, l.channels, l.sampleRate, region, outFrames);
+            }
+
+            RamSample &r = ramSamples[ramSampleCount++];
+            r.key = pathHash(path);
+            r.pcm = region;
+            r.frames = outFrames;
+            r.channels = l.channels;
+            region += regFrames * l.channels;
+        }
+    }
+    delete[] layouts;
+
+    Serial.printf("Bank 1 RAM: %d/%d variants loaded (%lu KB, %lu ms)\n", ramSampleCount, count,
+                  (unsigned long)(totalBytes / 1024), millis() - t0);
+    return ramSampleCount > 0;
+}
+
+// ===================================
+// Start RAM Stream (Core 0)
+// ===================================
+// Sets up a stopped stream to play `path` from the arena. Returns false if
+// the path isn't RAM-resident (the caller then opens the file as usual).
+bool startRamStream(AudioStream* s, const char* path, uint32_t startMs) {
+    if (!ramSamples) return false;
+    uint32_t key = pathHash(path);
+    const RamSample* r = nullptr;
+    for (int i = 0; i < ramSampleCount; i++) {
+        if (ramSamples[i].key == key) {
+            r = &ramSamples[i];
+            break;
+        }
+    }
+    if (!r) return false;
+
+    s->type = STREAM_TYPE_PCM_RAM;
+    s->decoderIndex = -1;
+    s->channels = r->channels;
+    s->sampleRate = SAMPLE_RATE;
+    s->ramPcm = r->pcm;
+    s->ramFrames = r->frames;
+    s->ramPos = 0;
+    s->fileFinished = true; // Nothing for Core 0 to refill
+    seekRamStream(s, startMs);
+    return true;
+}
+
+// The flash sync moved a variant between the card and flash. The loaded
+// clip is the same sound either way, so it just takes the new path's key.
+void ramBankRekey(const char* from, const char* to) {
+    uint32_t key = pathHash(from);
+    for (int i = 0; i < ramSampleCount; i++) {
+        if (ramSamples[i].key == key) {
+            ramSamples[i].key = pathHash(to);
+            return;
+        }
+    }
+}
+
+// Jumps a RAM stream (which must not be mixing) to `ms`
+void seekRamStream(AudioStream* s, uint32_t ms) {
+    uint64_t frame = (uint64_t)ms * SAMPLE_RATE / 1000;
+    if (frame > s->ramFrames) frame = s->ramFrames;
+    s->ramPos = (uint32_t)frame;
+    s->startOffsetMs = (uint32_t)((frame * 1000) / SAMPLE_RATE);
+    s->playedFrames = 0;
+}
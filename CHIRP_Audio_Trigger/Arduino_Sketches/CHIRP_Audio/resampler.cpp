@@ -0,0 +1,213 @@
+// Per-stream sample rate conversion for the mixer (Core 1)
+// Converts any source rate (8kHz-48kHz) to SAMPLE_RATE with fixed-point math.
+#include "config.h"
+
+// ===================================
+// Resampler Configuration
+// ===================================
+ResamplerQuality resamplerQuality = RESAMPLER_LINEAR;
+
+// Polyphase FIR: RESAMPLER_PHASES rows of RESAMPLER_TAPS Q15 coefficients.
+// One shared table (1KB) is used for every stream and source rate.
+#define RESAMPLER_PHASE_BITS 6
+#define RESAMPLER_PHASES (1 << RESAMPLER_PHASE_BITS)
+static int16_t polyphaseTable[RESAMPLER_PHASES][RESAMPLER_TAPS];
+
+// Scratch for one block: history frames + new source frames (interleaved).
+// Sized for source rates up to 2x SAMPLE_RATE, only ever touched by Core 1.
+#define RESAMPLER_SCRATCH_FRAMES (MIXER_BLOCK_FRAMES * 2 + RESAMPLER_TAPS)
+static int16_t scratch[RESAMPLER_SCRATCH_FRAMES * 2];
+
+// ===================================
+// Build Polyphase Table (Core 0, once)
+// ===================================
+// Blackman-windowed sinc with its cutoff at 0.42 of the source rate, which
+// keeps the passband flat for upsampling and still rejects most images when
+// 48kHz material is brought down to 44.1kHz. Each row is normalised to unity
+// gain so interpolated DC stays exact.
+void initResampler() {
+    const float fc = 0.42f;
+    const int center = RESAMPLER_TAPS / 2 - 1;
+
+    for (int p = 0; p < RESAMPLER_PHASES; p++) {
+        float frac = (float)p / RESAMPLER_PHASES;
+        float row[RESAMPLER_TAPS];
+        float sum = 0.0f;
+
+        for (int j = 0; j < RESAMPLER_TAPS; j++) {
+            float t = (float)(j - center) - frac; // Distance from output position
+            float x = 2.0f * fc * t;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf((float)M_PI * x) / ((float)M_PI * x);
+            float w = 0.42f + 0.5f * cosf((float)M_PI * t / (RESAMPLER_TAPS / 2))
+                            + 0.08f * cosf(2.0f * (float)M_PI * t / (RESAMPLER_TAPS / 2));
+            if (fabsf(t) >= RESAMPLER_TAPS / 2) w = 0.0f;
+            row[j] = sinc * w;
+            sum += row[j];
+        }
+
+        int32_t total = 0;
+        for (int j = 0; j < RESAMPLER_TAPS; j++) {
+            polyphaseTable[p][j] = (int16_t)lroundf(row[j] / sum * 32767.0f);
+            total += polyphaseTable[p][j];
+        }
+        // Put any rounding error on the center tap
+        polyphaseTable[p][center] += (int16_t)(32767 - total);
+    }
+}
+
+// ===================================
+// Reset (Core 0, stream stopped)
+// ===================================
+void resamplerReset(ResamplerState* rs) {
+    memset(rs, 0, sizeof(ResamplerState));
+}
+
+// ===================================
+// Resample Block (Core 1)
+// ===================================
+// Reads the stream's native PCM from its ring buffer and renders up to
+// `frames` stereo frames at SAMPLE_RATE into dst (mono is upmixed here).
+//
+// The last (taps - 1) source frames are kept in the state as history, so the
+// kernel always runs on one contiguous scratch array. Only frames the output
+// position has fully passed are committed back to the ring buffer; the rest
+// are re-read next block.
+//
+// Cost per output frame and channel: linear = 2 MACs, polyphase = 8 MACs.
+// Returns the number of frames rendered (less than `frames` on underrun).
+int resampleBlock(ResamplerState* rs, RingBuffer* rb, int ch, uint32_t rate, int16_t* dst, int frames) {
+    if (rs->rate != rate) {
+        rs->rate = rate;
+        rs->step = (uint32_t)(((uint64_t)rate << 16) / SAMPLE_RATE);
+    }
+    int taps = (resamplerQuality == RESAMPLER_POLYPHASE) ? RESAMPLER_TAPS : 2;
+    int histFrames = taps - 1;
+    if (rs->taps != taps) {
+        // Quality changed: restart from silence
+        rs->taps = taps;
+        rs->pos = 0;
+        memset(rs->history, 0, sizeof(rs->history));
+    }
+
+    uint32_t step = rs->step;
+    uint32_t pos = rs->pos;
+
+    // New source frames needed so the last output's window is complete
+    int need = (int)((pos + (uint32_t)(frames - 1) * step) >> 16) + 1;
+    if (need > RESAMPLER_SCRATCH_FRAMES - histFrames) need = RESAMPLER_SCRATCH_FRAMES - histFrames;
+
+    const int16_t* spans[2];
+    int spanLen[2];
+    int got = rb->beginRead(need * ch, spans[0], spanLen[0], spans[1], spanLen[1]);
+    int newFrames = got / ch;
+    rs->consumed = 0;
+    if (newFrames == 0) return 0;
+
+    // Scratch = history + new frames
+    int16_t* sp = scratch;
+    memcpy(sp, rs->history, histFrames * ch * sizeof(int16_t));
+    sp += histFrames * ch;
+    int firstLen = (spanLen[0] < newFrames * ch) ? spanLen[0] : newFrames * ch;
+    memcpy(sp, spans[0], firstLen * sizeof(int16_t));
+    if (newFrames * ch > firstLen) {
+        memcpy(sp + firstLen, spans[1], (newFrames * ch - firstLen) * sizeof(int16_t));
+    }
+
+    // Output frame at `pos` uses scratch frames [pos >> 16, (pos >> 16) + taps)
+    int out = 0;
+    uint32_t limit = (uint32_t)newFrames << 16;
+    if (taps == 2) {
+        // --- Linear ---
+        while (out < frames && pos < limit) {
+            int i = pos >> 16;
+            int32_t frac = (pos >> 1) & 0x7FFF; // Q15
+            const int16_t* x = scratch + i * ch;
+            int32_t l = x[0] + ((((int32_t)x[ch] - x[0]) * frac) >> 15);
+            int32_t r = l;
+            if (ch == 2) r = x[1] + ((((int32_t)x[3] - x[1]) * frac) >> 15);
+            dst[out * 2] = (int16_t)l;
+            dst[out * 2 + 1] = (int16_t)r;
+            out++;
+            pos += step;
+        }
+    } else {
+        // --- Polyphase ---
+        while (out < frames && pos < limit) {
+            int i = pos >> 16;
+            const int16_t* h = polyphaseTable[(pos & 0xFFFF) >> (16 - RESAMPLER_PHASE_BITS)];
+            const int16_t* x = scratch + i * ch;
+            int32_t l = 0;
+            int32_t r = 0;
+            if (ch == 2) {
+                for (int j = 0; j < RESAMPLER_TAPS; j++) {
+                    l += (int32_t)x[j * 2] * h[j];
+                    r += (int32_t)x[j * 2 + 1] * h[j];
+                }
+            } else {
+                for (int j = 0; j < RESAMPLER_TAPS; j++) {
+                    l += (int32_t)x[j] * h[j];
+                }
+                r = l;
+            }
+            l >>= 15;
+            r >>= 15;
+            if (l > 32767) l = 32767; else if (l < -32768) l = -32768;
+            if (r > 32767) r = 32767; else if (r < -32768) r = -32768;
+            dst[out * 2] = (int16_t)l;
+            dst[out * 2 + 1] = (int16_t)r;
+            out++;
+            pos += step;
+        }
+    }
+
+    // Release the frames the position has passed, keep the next window's history
+    int shift = pos >> 16;
+    if (shift > newFrames) shift = newFrames;
+    rb->commitRead(shift * ch);
+    rs->consumed = shift;
+    memcpy(rs->history, scratch + shift * ch, histFrames * ch * sizeof(int16_t));
+    rs->pos = pos - ((uint32_t)shift << 16);
+
+    return out;
+}
+
+// ===================================
+// Resample Buffer (Core 0, boot)
+// ===================================
+// Converts a whole in-memory clip to SAMPLE_RATE, keeping its channel
+// count, with the same kernels as resampleBlock(). Frames outside the clip
+// read as silence.
+//
+// dst may share a region with src if src starts at least RESAMPLER_TAPS
+// frames after dst and dstFrames <= (src - dst) + srcFrames - RESAMPLER_TAPS
+// (in frames): every source frame is then read before an output lands on it.
+void resampleBuffer(const int16_t* src, int srcFrames, int ch, uint32_t rate, int16_t* dst, int dstFrames) {
+    uint32_t step = (uint32_t)(((uint64_t)rate << 16) / SAMPLE_RATE);
+    bool poly = (resamplerQuality == RESAMPLER_POLYPHASE);
+    const int center = poly ? RESAMPLER_TAPS / 2 - 1 : 0;
+    uint64_t pos = 0;
+
+    for (int out = 0; out < dstFrames; out++, pos += step) {
+        int i = (int)(pos >> 16) - center;
+        uint32_t frac = (uint32_t)pos & 0xFFFF;
+
+        for (int c = 0; c < ch; c++) {
+            int32_t acc;
+            if (poly) {
+                const int16_t* h = polyphaseTable[frac >> (16 - RESAMPLER_PHASE_BITS)];
+                acc = 0;
+                for (int j = 0; j < RESAMPLER_TAPS; j++) {
+                    int k = i + j;
+                    if (k >= 0 && k < srcFrames) acc += (int32_t)src[k * ch + c] * h[j];
+                }
+                acc >>= 15;
+            } else {
+                int32_t a = (i < srcFrames) ? src[i * ch + c] : 0;
+                int32_t b = (i + 1 < srcFrames) ? src[(i + 1) * ch + c] : 0;
+                acc = a + (((b - a) * (int32_t)(frac >> 1)) >> 15);
+            }
+            if (acc > 32767) acc = 32767; else if (acc < -32768) acc = -32768;
+            dst[out * ch + c] = (int16_t)acc;
+        }
+    }
+}
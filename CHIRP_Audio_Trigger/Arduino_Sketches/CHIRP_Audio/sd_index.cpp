@@ -0,0 +1,491 @@
+// SD Card Index (Core 0, boot)
+// One pass over the SD root finds the valid Bank 1 pages, the active Bank 1
+// folder, Banks 2-6 and the legacy root tracks. The file lists of the bank
+// folders are cached in SD_INDEX_PATH, keyed by a CRC32 of each folder's raw
+// directory entries, so only folders that changed since the last boot are
+// walked again. Reading the entries is one sequential read of the directory
+// file, without opening each file or fetching its name. A folder's modify
+// time is no use as the key: FAT drivers (Windows, macOS, SdFat) leave it
+// alone when files in it are added or deleted. Deleting SD_INDEX_PATH forces
+// a full rescan.
+//
+// Filenames are packed into one PSRAM name pool. nameTable[] holds the pool
+// offset of each name; every bank (and every Bank 1 sound) owns a contiguous
+// range of it, so there are no fixed per-bank file limits.
+#include "config.h"
+#include <CRC32.h>
+
+struct IndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t folderCount;
+};
+
+// Followed in the file by the folder's names, each as <uint8 length><chars>
+struct IndexFolder {
+    char name[64];
+    uint32_t key;       // folderKey() of the folder
+    uint32_t offset;    // File offset of the first name
+    uint16_t fileCount;
+    uint16_t reserved;
+};
+
+// Adds one (already filtered) audio file to a bank
+typedef void (*AddFileFn)(const char* filename, SDBank* bank);
+
+// Name pool
+static char* namePool = nullptr;
+static uint32_t* nameTable = nullptr;
+static uint32_t poolUsed = 0;
+static int nameCount = 0;
+static uint8_t* nameSound = nullptr; // Bank 1 sound of each name, while grouping
+
+// (bank 2-6, page none/A-Z) -> sdBanks index, -1 if none
+static int16_t bankSlot[5][27];
+
+// Folders read from the index at boot, and the ones found on this pass
+static IndexFolder* cached = nullptr;
+static int cachedCount = 0;
+
+struct FoundFolder {
+    const char* name;
+    uint32_t key;
+    SDBank* bank;       // nullptr for Bank 1
+};
+static FoundFolder found[SD_INDEX_MAX_FOLDERS];
+static int foundCount = 0;
+
+// CRC32 of the folder's directory entries, up to the end-of-directory entry.
+// Adding, deleting, renaming or rewriting a file changes its entry (a delete
+// marks it 0xE5). Leaves the folder rewound for scanFolder(); 0 on a read error.
+static uint32_t folderKey(FsFile &dir) {
+    uint8_t buf[512];
+    CRC32 crc;
+    bool end = false;
+    while (!end) {
+        int n = dir.read(buf, sizeof(buf));
+        if (n < 0) return 0;
+        if (n == 0) break;
+        for (int e = 0; e + 32 <= n; e += 32) {
+            if (buf[e] == 0) {
+                n = e + 32;
+                end = true;
+                break;
+            }
+        }
+        crc.update(buf, n);
+        sdIoCheckpoint(SD_IO_SCAN);
+    }
+    dir.rewind();
+    uint32_t key = crc.finalize();
+    return key ? key : 1;
+}
+
+static bool poolHasRoom(size_t len) {
+    if (nameCount < MAX_LIBRARY_FILES && poolUsed + len + 1 <= NAME_POOL_SIZE) return true;
+    static bool warned = false;
+    if (!warned) {
+        Serial.println("WARNING: Filename pool full, some files were not indexed");
+        warned = true;
+    }
+    return false;
+}
+
+// Appends a name (truncated to maxLen) to the pool. Returns its table index,
+// or -1 once the pool or table is full.
+static int addName(const char* name, size_t maxLen) {
+    size_t len = strlen(name);
+    if (len > maxLen) len = maxLen;
+    if (!poolHasRoom(len)) return -1;
+    memcpy(namePool + poolUsed, name, len);
+    namePool[poolUsed + len] = '\0';
+    nameTable[nameCount] = poolUsed;
+    poolUsed += len + 1;
+    return nameCount++;
+}
+
+// ===================================
+// Name Lookups
+// ===================================
+const char* bank1Variant(const SoundFile &sound, int v) {
+    return namePool + nameTable[sound.firstVariant + v];
+}
+
+const char* sdBankFile(const SDBank* bank, int i) {
+    return namePool + nameTable[bank->firstFile + i];
+}
+
+SDBank* findSDBank(uint8_t bank, char page) {
+    if (bank < 2 || bank > 6) return nullptr;
+    int p = 0;
+    if (page >= 'A' && page <= 'Z') p = page - 'A' + 1;
+    else if (page != 0) return nullptr;
+    int idx = bankSlot[bank - 2][p];
+    return (idx >= 0) ? &sdBanks[idx] : nullptr;
+}
+
+const char* getSDFile(uint8_t bank, char page, int index) {
+    SDBank* sdBank = findSDBank(bank, page);
+    if (!sdBank) return nullptr;
+
+    if (index < 1 || index > sdBank->fileCount) return nullptr;
+
+    return sdBankFile(sdBank, index - 1);
+}
+
+// ===================================
+// Bank Builders
+// ===================================
+// Groups "name_NN.ext" variants under one Bank 1 sound. The names are
+// appended in folder order and sorted into per-sound ranges afterwards
+// (see groupBank1()).
+static void addBank1File(const char* filename, SDBank*) {
+    size_t len = strlen(filename);
+    if (!poolHasRoom(len > BANK1_NAME_MAX ? BANK1_NAME_MAX : len)) return;
+
+    int soundIdx = -1;
+    char basename[16];
+    const char* underscore = strchr(filename, '_');
+    if (underscore && isdigit(*(underscore + 1))) {
+        int baseLen = underscore - filename;
+        if (baseLen >= sizeof(basename)) baseLen = sizeof(basename) - 1;
+        strncpy(basename, filename, baseLen);
+        basename[baseLen] = '\0';
+
+        for (int i = 0; i < bank1SoundCount; i++) {
+            if (strcasecmp(bank1Sounds[i].basename, basename) == 0) {
+                soundIdx = i;
+                break;
+            }
+        }
+    }
+    else {
+        strncpy(basename, filename, sizeof(basename) - 1);
+        basename[sizeof(basename) - 1] = '\0';
+        char* dot = strrchr(basename, '.');
+        if (dot) *dot = '\0';
+    }
+
+    if (soundIdx == -1) {
+        if (bank1SoundCount >= MAX_SOUNDS) return;
+        soundIdx = bank1SoundCount++;
+        strncpy(bank1Sounds[soundIdx].basename, basename, sizeof(bank1Sounds[soundIdx].basename) - 1);
+        bank1Sounds[soundIdx].basename[sizeof(bank1Sounds[soundIdx].basename) - 1] = '\0';
+        bank1Sounds[soundIdx].variantCount = 0;
+        bank1Sounds[soundIdx].lastVariantPlayed = -1; // Init non-repeat
+    }
+
+    int n = addName(filename, BANK1_NAME_MAX);
+    nameSound[n] = soundIdx;
+    bank1Sounds[soundIdx].variantCount++;
+}
+
+// Reorders the Bank 1 names [first, nameCount) so each sound's variants are
+// contiguous, keeping folder order within a sound
+static void groupBank1(int first) {
+    int count = nameCount - first;
+    int next = first;
+    int fill[MAX_SOUNDS];
+    for (int s = 0; s < bank1SoundCount; s++) {
+        bank1Sounds[s].firstVariant = next;
+        fill[s] = next - first;
+        next += bank1Sounds[s].variantCount;
+    }
+    if (count <= 0) return;
+
+    uint32_t* sorted = new uint32_t[count];
+    for (int n = first; n < nameCount; n++) {
+        sorted[fill[nameSound[n]]++] = nameTable[n];
+    }
+    memcpy(nameTable + first, sorted, count * sizeof(uint32_t));
+    delete[] sorted;
+}
+
+static void addSdBankFile(const char* filename, SDBank* bank) {
+    if (addName(filename, SD_NAME_MAX) >= 0) bank->fileCount++;
+}
+
+// ===================================
+// Folder Loaders (caller holds the card)
+// ===================================
+// Walks a bank folder on the card
+static void scanFolder(FsFile &dir, AddFileFn add, SDBank* bank) {
+    FsFile file;
+    while (file.openNext(&dir, O_RDONLY)) {
+        if (!file.isDirectory()) {
+            char filename[64];
+            file.getName(filename, sizeof(filename));
+            if (isAudioFile(filename)) add(filename, bank);
+        }
+        file.close();
+        sdIoCheckpoint(SD_IO_SCAN);
+    }
+}
+
+// Replays a folder's file list from the index. False if the index has no
+// entry for it, or the folder's entries have changed since it was written.
+static bool loadFolder(FsFile &indexFile, const char* name, uint32_t key,
+                       AddFileFn add, SDBank* bank) {
+    if (key == 0) return false; // Entries couldn't be read
+    for (int i = 0; i < cachedCount; i++) {
+        if (cached[i].key != key || strcmp(cached[i].name, name) != 0) continue;
+        if (!indexFile.seek(cached[i].offset)) return false;
+        for (int f = 0; f < cached[i].fileCount; f++) {
+            char filename[64];
+            int len = indexFile.read();
+            if (len <= 0 || len >= (int)sizeof(filename) ||
+                indexFile.read(filename, len) != len) {
+                return false;
+            }
+            filename[len] = '\0';
+            add(filename, bank);
+        }
+        return true;
+    }
+    return false;
+}
+
+static int loadIndexTable(FsFile &indexFile) {
+    IndexHeader header;
+    if (indexFile.read(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != SD_INDEX_MAGIC || header.version != SD_INDEX_VERSION ||
+        header.folderCount > SD_INDEX_MAX_FOLDERS) {
+        return 0;
+    }
+    cached = new IndexFolder[header.folderCount > 0 ? header.folderCount : 1];
+    int bytes = header.folderCount * sizeof(IndexFolder);
+    if (indexFile.read(cached, bytes) != bytes) return 0;
+    for (int i = 0; i < header.folderCount; i++) {
+        cached[i].name[sizeof(cached[i].name) - 1] = '\0';
+    }
+    return header.folderCount;
+}
+
+// ===================================
+// Write Index (caller holds the card)
+// ===================================
+// Names of a found folder, as a range of the name table
+static void folderNames(const FoundFolder &folder, int &first, int &count) {
+    if (folder.bank) {
+        first = folder.bank->firstFile;
+        count = folder.bank->fileCount;
+    } else {
+        first = bank1SoundCount ? bank1Sounds[0].firstVariant : 0;
+        count = 0;
+        for (int s = 0; s < bank1SoundCount; s++) count += bank1Sounds[s].variantCount;
+    }
+}
+
+static bool saveIndex() {
+    static const char* tmpPath = SD_INDEX_PATH ".TMP";
+    FsFile f = sd.open(tmpPath, FILE_WRITE | O_TRUNC);
+    if (!f) return false;
+
+    IndexHeader header = { SD_INDEX_MAGIC, SD_INDEX_VERSION, (uint16_t)foundCount };
+    bool ok = f.write(&header, sizeof(header)) == sizeof(header);
+
+    // Folder table, then the names
+    uint32_t offset = sizeof(header) + foundCount * sizeof(IndexFolder);
+    for (int i = 0; i < foundCount && ok; i++) {
+        int first, count;
+        folderNames(found[i], first, count);
+
+        IndexFolder t;
+        memset(&t, 0, sizeof(t));
+        strncpy(t.name, found[i].name, sizeof(t.name) - 1);
+        t.key = found[i].key;
+        t.offset = offset;
+        t.fileCount = count;
+        for (int n = first; n < first + count; n++) offset += 1 + strlen(namePool + nameTable[n]);
+        ok = f.write(&t, sizeof(t)) == sizeof(t);
+    }
+    for (int i = 0; i < foundCount && ok; i++) {
+        int first, count;
+        folderNames(found[i], first, count);
+        for (int n = first; n < first + count && ok; n++) {
+            const char* name = namePool + nameTable[n];
+            uint8_t len = strlen(name);
+            ok = f.write(&len, 1) == 1 && f.write(name, len) == len;
+        }
+    }
+    f.close();
+
+    if (!ok) {
+        sd.remove(tmpPath);
+        return false;
+    }
+    sd.remove(SD_INDEX_PATH);
+    return sd.rename(tmpPath, SD_INDEX_PATH);
+}
+
+// ===================================
+// Scan SD Card
+// ===================================
+void scanSDCard() {
+    // Allocate once
+    if (!namePool) {
+        namePool = (char*)pmalloc(NAME_POOL_SIZE);
+        nameTable = (uint32_t*)pmalloc(MAX_LIBRARY_FILES * sizeof(uint32_t));
+        if (!namePool || !nameTable) {
+            Serial.println("ERROR: Could not allocate filename pool");
+            namePool = nullptr;
+            return;
+        }
+    }
+    poolUsed = 0;
+    nameCount = 0;
+    for (int b = 0; b < 5; b++) {
+        for (int p = 0; p < 27; p++) bankSlot[b][p] = -1;
+    }
+
+    validBank1PageCount = 0;
+    validBank1Pages[0] = '\0';
+    bank1SoundCount = 0;
+    bank1DirName[0] = '\0';
+    sdBankCount = 0;
+    rootTrackCount = 0;
+    foundCount = 0;
+
+    char bank1Prefix[4]; // "1A_"
+    snprintf(bank1Prefix, sizeof(bank1Prefix), "1%c_", activeBank1Page);
+
+    uint32_t t0 = millis();
+    int reused = 0;
+    int rescanned = 0;
+
+    sdIoBegin(SD_IO_SCAN);
+    FsFile root = sd.open("/");
+    if (!root || !root.isDirectory()) {
+        Serial.println("ERROR: Could not open root directory");
+        sdIoEnd();
+        return;
+    }
+
+    FsFile indexFile = sd.open(SD_INDEX_PATH, FILE_READ);
+    cachedCount = indexFile ? loadIndexTable(indexFile) : 0;
+    nameSound = new uint8_t[MAX_LIBRARY_FILES];
+
+    FsFile entry;
+    while (entry.openNext(&root, O_RDONLY)) {
+        char name[64];
+        entry.getName(name, sizeof(name));
+
+        if (!entry.isDirectory()) {
+            // Legacy root tracks: every valid audio file in SD root
+            if (isAudioFile(name) && rootTrackCount < MAX_ROOT_TRACKS) {
+                strncpy(rootTracks[rootTrackCount], name, sizeof(rootTracks[0]) - 1);
+                rootTrackCount++;
+            }
+            entry.close();
+            continue;
+        }
+
+        uint32_t poolMark = poolUsed;
+        int nameMark = nameCount;
+
+        // Bank 1 pages: "1[A-Z]_"
+        if (strlen(name) >= 3 && name[0] == '1' && name[1] >= 'A' && name[1] <= 'Z' && name[2] == '_') {
+            if (!strchr(validBank1Pages, name[1])) {
+                validBank1Pages[validBank1PageCount++] = name[1];
+                validBank1Pages[validBank1PageCount] = '\0';
+            }
+            if (bank1DirName[0] == '\0' && strncmp(name, bank1Prefix, 3) == 0 &&
+                foundCount < SD_INDEX_MAX_FOLDERS) {
+                strncpy(bank1DirName, name, sizeof(bank1DirName) - 1);
+                uint32_t key = folderKey(entry);
+                if (loadFolder(indexFile, name, key, addBank1File, nullptr)) {
+                    reused++;
+                } else {
+                    // Drop anything a partial index read added
+                    bank1SoundCount = 0;
+                    poolUsed = poolMark;
+                    nameCount = nameMark;
+                    scanFolder(entry, addBank1File, nullptr);
+                    rescanned++;
+                }
+                groupBank1(nameMark);
+                found[foundCount++] = { bank1DirName, key, nullptr };
+            }
+        }
+        // Banks 2-6: "[2-6][A-Z]?_[Name]"
+        else if (strlen(name) >= 2 && name[0] >= '2' && name[0] <= '6') {
+            char page = 0;
+            if (strlen(name) >= 3 && name[1] >= 'A' && name[1] <= 'Z' && name[2] == '_') {
+                page = name[1];
+            } else if (name[1] != '_') {
+                entry.close(); // Invalid format
+                continue;
+            }
+
+            if (sdBankCount < MAX_SD_BANKS && foundCount < SD_INDEX_MAX_FOLDERS) {
+                SDBank* bank = &sdBanks[sdBankCount];
+                bank->bankNum = name[0] - '0';
+                bank->page = page;
+                strncpy(bank->dirName, name, sizeof(bank->dirName) - 1);
+                bank->firstFile = nameCount;
+                bank->fileCount = 0;
+                uint32_t key = folderKey(entry);
+                if (loadFolder(indexFile, name, key, addSdBankFile, bank)) {
+                    reused++;
+                } else {
+                    bank->fileCount = 0;
+                    poolUsed = poolMark;
+                    nameCount = nameMark;
+                    scanFolder(entry, addSdBankFile, bank);
+                    rescanned++;
+                }
+
+                // First folder wins if two share a bank/page
+                int16_t &slot = bankSlot[bank->bankNum - 2][page ? page - 'A' + 1 : 0];
+                if (slot < 0) slot = sdBankCount;
+                found[foundCount++] = { bank->dirName, key, bank };
+                sdBankCount++;
+            }
+        }
+        entry.close();
+        sdIoCheckpoint(SD_IO_SCAN);
+    }
+    root.close();
+    if (indexFile) indexFile.close();
+
+    // Rewrite the index if a folder changed, appeared or went away
+    if (rescanned > 0 || reused != cachedCount) {
+        if (!saveIndex()) Serial.println("WARNING: Could not write SD index");
+    }
+    sdIoEnd();
+    delete[] cached;
+    cached = nullptr;
+    delete[] nameSound;
+    nameSound = nullptr;
+
+    // Sort logic (Bubble sort)
+    for (int i = 0; i < validBank1PageCount - 1; i++) {
+        for (int j = 0; j < validBank1PageCount - i - 1; j++) {
+            if (validBank1Pages[j] > validBank1Pages[j+1]) {
+                char temp = validBank1Pages[j];
+                validBank1Pages[j] = validBank1Pages[j+1];
+                validBank1Pages[j+1] = temp;
+            }
+        }
+    }
+    if (validBank1PageCount == 0) {
+        strcpy(validBank1Pages, "A");
+        validBank1PageCount = 1;
+    }
+
+    // Sort the tracks alphabetically to ensure deterministic order
+    // (Bubble sort is fine for < 255 items)
+    for (int i = 0; i < rootTrackCount - 1; i++) {
+        for (int j = 0; j < rootTrackCount - i - 1; j++) {
+            if (strcasecmp(rootTracks[j], rootTracks[j+1]) > 0) {
+                char temp[16];
+                strncpy(temp, rootTracks[j], sizeof(temp));
+                strncpy(rootTracks[j], rootTracks[j+1], sizeof(rootTracks[j]));
+                strncpy(rootTracks[j+1], temp, sizeof(temp));
+            }
+        }
+    }
+
+    Serial.printf("SD Index: %d folders cached, %d rescanned, %d names in %lu KB (%lu ms)\n",
+                  reused, rescanned, nameCount, (unsigned long)(poolUsed / 1024), millis() - t0);
+}
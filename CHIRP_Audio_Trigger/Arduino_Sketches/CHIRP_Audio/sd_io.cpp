@@ -0,0 +1,131 @@
+// SD Card I/O Service (Core 0)
+// All SD access goes through here so the card has one owner and one order of
+// service: stream refills first, then single small files (INI, voice prompts,
+// warm cache), then bulk copies and CRCs, then directory scans. Core 0 is the
+// only SD user, so priority works by yielding: before lower-priority work
+// takes the card, any SD stream running low is refilled first, and bulk reads
+// are split into SD_IO_SLICE_BYTES pieces with the card released between
+// them. sd_mutex is never held for more than one slice or one metadata step.
+// In MSC mode the USB host's sector transfers come through here as well, in
+// a time slice per loop() pass, so the rest of the pass stays with audio.
+#include "config.h"
+
+static bool pumping = false; // Inside a yield's refill, nothing below may yield again
+
+// Buffered audio (ms) below which a stream pre-empts work of each priority
+static const uint32_t yieldMs[] = { 0, SD_IO_FILE_YIELD_MS, SD_IO_BULK_YIELD_MS, SD_IO_SCAN_YIELD_MS };
+
+static uint32_t mscUsedUs = 0; // Card time the USB host used in this loop() pass
+
+bool isSdStream(const AudioStream* s) {
+    switch (s->type) {
+        case STREAM_TYPE_WAV_SD:
+        case STREAM_TYPE_MP3_SD:
+        case STREAM_TYPE_AAC_SD:
+        case STREAM_TYPE_M4A_SD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// True if an SD stream has less than `ms` of audio left and data to read
+static bool streamsNeedCard(uint32_t ms) {
+    if (!streams || g_mscActive) return false;
+    for (int i = 0; i < maxStreams; i++) {
+        AudioStream* s = &streams[i];
+        if (!s->active || s->fileFinished || !isSdStream(s)) continue;
+        if (streamBufferMs(s) < ms) return true;
+    }
+    return false;
+}
+
+// ===================================
+// Yield to Streams
+// ===================================
+// Runs one pass of the refill scheduler (its own time budget applies) if a
+// stream would pre-empt work of this priority. The card must not be held.
+void sdIoYield(SdIoPriority prio) {
+    if (prio == SD_IO_STREAM || pumping) return;
+    if (!streamsNeedCard(yieldMs[prio])) return;
+    pumping = true;
+    fillStreamBuffers();
+    pumping = false;
+}
+
+// ===================================
+// Take / Release the Card
+// ===================================
+// For one short operation (open, close, exists, seek, one directory entry).
+void sdIoBegin(SdIoPriority prio) {
+    sdIoYield(prio);
+    mutex_enter_blocking(&sd_mutex);
+}
+
+void sdIoEnd() {
+    mutex_exit(&sd_mutex);
+}
+
+// Between steps of a long operation that holds the card (a directory walk):
+// lets the card go for a refill if a stream needs it, then takes it back.
+void sdIoCheckpoint(SdIoPriority prio) {
+    if (prio == SD_IO_STREAM || pumping || !streamsNeedCard(yieldMs[prio])) return;
+    mutex_exit(&sd_mutex);
+    sdIoYield(prio);
+    mutex_enter_blocking(&sd_mutex);
+}
+
+// ===================================
+// Read
+// ===================================
+// Reads up to `len` bytes from `f` at its current position, taking the card
+// itself. Stream reads go in one call (their size is already bounded by the
+// staging logic); everything else is sliced with a yield before each slice.
+// Returns the bytes read, or -1 if the first slice failed.
+int sdIoRead(FsFile &f, void* dst, uint32_t len, SdIoPriority prio) {
+    if (prio == SD_IO_STREAM) {
+        mutex_enter_blocking(&sd_mutex);
+        uint32_t tStart = perfNow();
+        int n = f ? f.read(dst, len) : -1;
+        perfRead(true, perfNow() - tStart);
+        mutex_exit(&sd_mutex);
+        return n;
+    }
+
+    uint8_t* p = (uint8_t*)dst;
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t slice = len - done;
+        if (slice > SD_IO_SLICE_BYTES) slice = SD_IO_SLICE_BYTES;
+        sdIoBegin(prio);
+        int n = f ? f.read(p + done, slice) : -1;
+        sdIoEnd();
+        if (n <= 0) return done ? (int)done : n;
+        done += n;
+        if ((uint32_t)n < slice) break; // End of file
+    }
+    return (int)done;
+}
+
+// ===================================
+// USB Mass Storage Sectors
+// ===================================
+// For the MSC callbacks, which run from the USB task and must never block:
+// returns 0 (busy, TinyUSB retries the transfer later) if the card is held,
+// a stream refill is urgent, or this pass's SD_IO_MSC_SLICE_US is used up.
+// One call is one multi-sector command. Returns 1 when done, -1 on error.
+int sdIoSectors(uint32_t lba, uint8_t* buf, uint32_t count, bool write) {
+    if (mscUsedUs >= SD_IO_MSC_SLICE_US || isCpuBusy()) return 0;
+    if (!mutex_try_enter(&sd_mutex, nullptr)) return 0;
+    uint32_t t0 = micros();
+    bool ok = write ? sd.card()->writeSectors(lba, buf, count)
+                    : sd.card()->readSectors(lba, buf, count);
+    mscUsedUs += micros() - t0;
+    mutex_exit(&sd_mutex);
+    return ok ? 1 : -1;
+}
+
+// Opens the next slice (loop(), after the streams were refilled)
+void sdIoMscSlice() {
+    mscUsedUs = 0;
+}
@@ -40,11 +40,18 @@ bool skipToNextArg(char*& ptr) {
 }
 
 // Parses int and advances ptr. If no int found, returns defaultValue.
+// An empty argument ("1,,3") gives its default and consumes its comma, so the
+// arguments after it are still read (parseArgChar() and parseArgPage() do the
+// same). Every command's optional fields rely on this, e.g. PLAY:3,,,80 (bank
+// and page default, volume 80) or CHRP:500,,200 (end 0, 200ms).
 int parseArgInt(char*& ptr, int defaultValue = 0) {
     if (!ptr || *ptr == '\0' || *ptr == '\r' || *ptr == '\n') return defaultValue;
     
-    // Check if empty argument (e.g. "1,,3")
-    if (*ptr == ',') return defaultValue;
+    // Check if empty argument (e.g. "1,,3"): skip its comma
+    if (*ptr == ',') {
+        ptr++;
+        return defaultValue;
+    }
 
     int val = atoi(ptr);
     skipToNextArg(ptr);
@@ -53,34 +60,88 @@ int parseArgInt(char*& ptr, int defaultValue = 0) {
 
 // Parses single char and advances ptr.
 char parseArgChar(char*& ptr, char defaultValue = 0) {
-    if (!ptr || *ptr == '\0' || *ptr == '\r' || *ptr == '\n' || *ptr == ',') return defaultValue;
+    if (!ptr || *ptr == '\0' || *ptr == '\r' || *ptr == '\n') return defaultValue;
+    if (*ptr == ',') {
+        ptr++; // Empty argument
+        return defaultValue;
+    }
     
     char c = *ptr;
     skipToNextArg(ptr);
     return c;
 }
 
-// Helper to find the next available stream
-int getNextAvailableStream() {
-    // 1. Try to find an inactive stream
-    if (streams) {
-        for (int i = 0; i < maxStreams; i++) {
-            if (!streams[i].active) {
-                return i;
-            }
+// ===================================
+// Command Handlers
+// ===================================
+
+// Parses a page letter (A-Z or 0, case-insensitive) and advances ptr.
+// Empty or invalid: defaultValue.
+char parseArgPage(char*& ptr, char defaultValue = 'A') {
+    char page = defaultValue;
+    if (*ptr != '\0' && *ptr != '\r' && *ptr != '\n') {
+        if (*ptr == ',') {
+             ptr++; // Empty page argument, skip comma
+        } else {
+             char c = *ptr;
+             if (c >= 'a' && c <= 'z') c -= 32; // Uppercase
+             
+             if ((c >= 'A' && c <= 'Z') || c == '0') {
+                 page = c;
+             }
+             skipToNextArg(ptr);
         }
     }
-    // 2. All busy? Steal Stream 0.
-    return 0;
+    return page;
 }
 
-// ===================================
-// Command Handlers
-// ===================================
+// Resolves a sound (index in bank/page) to the path a stream plays.
+// Bank 1 picks a random variant, avoiding the last-played one.
+// Prints the ERR reply and returns false if there is no such sound.
+bool resolveSoundPath(Stream &serial, int index, int bank, char page, char* out, size_t len) {
+    if (bank == 1) {
+        if (index < 1 || index > bank1SoundCount) {
+            serial.println("ERR:PARAM - Invalid sound index");
+            return false;
+        }
+        
+        // Pick random variant, avoiding the last-played one
+        SoundFile& sound = bank1Sounds[index - 1];
+        int variantIdx;
+
+        if (sound.variantCount == 1) {
+            variantIdx = 0; 
+        } else {
+            variantIdx = random(sound.variantCount);
+            if (variantIdx == sound.lastVariantPlayed) {
+                variantIdx = (variantIdx + 1) % sound.variantCount;
+            }
+        }
+        
+        sound.lastVariantPlayed = variantIdx;
+        
+        // Flash once the sync has copied it, SD until then
+        bank1PlayPath(out, len, sound, variantIdx);
+        return true;
+    }
+    if (bank >= 2 && bank <= 6) {
+        const char* filename = getSDFile(bank, page, index);
+        if (!filename) {
+            serial.println("ERR:PARAM - Invalid file index");
+            return false;
+        }
+        SDBank* sdBank = findSDBank(bank, page);
+        snprintf(out, len, "/%s/%s", sdBank->dirName, filename);
+        return true;
+    }
+    serial.println("ERR:PARAM - Invalid bank");
+    return false;
+}
 
 void handlePlay(Stream &serial, char* args) {
-    // Format: PLAY:index,bank,page,volume
+    // Format: PLAY:index,bank,page,volume,offsetMs,class
     // or PLAY:index
+    // class: E(ffects), V(ocals) or M(usic), empty = the bank's #BANK_CLASSES default
     
     char* ptr = args;
     
@@ -92,123 +153,154 @@ void handlePlay(Stream &serial, char* args) {
     
     int index = parseArgInt(ptr);
     int bank = parseArgInt(ptr, 1); // Default Bank 1
-    
-    // Parse Page carefully (char)
-    char page = 'A'; // Default Page A
-    if (*ptr != '\0' && *ptr != '\r' && *ptr != '\n') {
-        if (*ptr == ',') {
-             // Empty page argument, use default 'A' or '0'? 
-             // Logic in original was slightly complex. Let's look at ptr directly.
-             ptr++; // Skip comma
-        } else {
-             char c = *ptr;
-             if (c >= 'a' && c <= 'z') c -= 32; // Uppercase
-             
-             if ((c >= 'A' && c <= 'Z') || c == '0') {
-                 page = c;
-             }
-             skipToNextArg(ptr);
-        }
-    }
-
+    char page = parseArgPage(ptr); // Default Page A
     int volume = parseArgInt(ptr, -1); // Default -1 (Current)
+    int offsetMs = parseArgInt(ptr, 0); // Start position in the file
+    if (offsetMs < 0) offsetMs = 0;
+    int cls = streamClassFromChar(parseArgChar(ptr));
+
+    char fullPath[128];
+    if (!resolveSoundPath(serial, index, bank, page, fullPath, sizeof(fullPath))) return;
+    if (cls < 0) cls = bankClass[bank];
     
-    int stream = getNextAvailableStream();
+    int stream = allocateStream(bank, cls);
     if (stream < 0 || stream >= maxStreams) {
-        serial.println("ERR:PARAM - Invalid stream");
+        serial.println("ERR:BUSY - No stream free for this priority");
         return;
     }
-
-    if (bank == 1) {
-        if (index >= 1 && index <= bank1SoundCount) {
-            
-            // Pick random variant, avoiding the last-played one
-            SoundFile& sound = bank1Sounds[index - 1];
-            int variantIdx;
-
-            if (sound.variantCount == 1) {
-                variantIdx = 0; 
-            } else {
-                variantIdx = random(sound.variantCount);
-                if (variantIdx == sound.lastVariantPlayed) {
-                    variantIdx = (variantIdx + 1) % sound.variantCount;
-                }
-            }
-            
-            sound.lastVariantPlayed = variantIdx;
-            const char* filename = sound.variants[variantIdx];
-            
-            // Dynamic path (Flash or SD)
-            char fullPath[80];
-            if (useFlashForBank1) {
-                snprintf(fullPath, sizeof(fullPath), "/flash/%s", filename);
-            } else {
-                snprintf(fullPath, sizeof(fullPath), "/%s/%s", bank1DirName, filename);
-            }
-            
-            // Common Playback Execution
-            sendSerialResponse(serial, "PACK:PLAY");
-            sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
-
-            if (startStream(stream, fullPath)) {
-                if (volume >= 0) {
-                    if (volume > 99) volume = 99;
-                    streams[stream].volume = (float)volume / 99.0f;
-                }
-            } else {
-                serial.println("ERR:NOFILE");
-            }
-        } else {
-            serial.println("ERR:PARAM - Invalid sound index");
+    
+    // Common Playback Execution
+    sendSerialResponse(serial, "PACK:PLAY");
+    sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
+
+    if (startStream(stream, fullPath, offsetMs)) {
+        claimStream(stream, bank, cls);
+        if (volume >= 0) {
+            if (volume > 99) volume = 99;
+            setStreamVolume(stream, (float)volume / 99.0f);
         }
+    } else {
+        serial.println("ERR:NOFILE");
     }
-    else if (bank >= 2 && bank <= 6) {
-        const char* filename = getSDFile(bank, page, index);
-        if (filename) {
-            SDBank* sdBank = findSDBank(bank, page);
-            char fullPath[128];
-            snprintf(fullPath, sizeof(fullPath), "/%s/%s", sdBank->dirName, filename);
-            
-            sendSerialResponse(serial, "PACK:PLAY");
-            sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
-
-            if (startStream(stream, fullPath)) {
-                if (volume >= 0) {
-                    if (volume > 99) volume = 99;
-                    streams[stream].volume = (float)volume / 99.0f;
-                }
-            } else {
-                serial.println("ERR:NOFILE");
-            }
-        } else {
-            serial.println("ERR:PARAM - Invalid file index");
-        }
+}
+
+void handleQueue(Stream &serial, char* args) {
+    // Format: QUEUE:stream,index,bank,page,fadeMs,loop
+    // Plays after what the stream is playing now (right away if it is idle)
+    char* ptr = args;
+    
+    int stream = parseArgInt(ptr, -1);
+    if (stream < 0 || stream >= maxStreams || !streams) {
+        serial.println("ERR:PARAM - Format: QUEUE:stream,index,bank,page,fadeMs,loop");
+        return;
     }
-    else {
-        serial.println("ERR:PARAM - Invalid bank");
+    int index = parseArgInt(ptr);
+    int bank = parseArgInt(ptr, 1);
+    char page = parseArgPage(ptr);
+    int fadeMs = parseArgInt(ptr, 0); // 0 = gapless
+    int loop = parseArgInt(ptr, 0);
+    if (fadeMs < 0) fadeMs = 0;
+    if (fadeMs > STREAM_XFADE_MAX_MS) fadeMs = STREAM_XFADE_MAX_MS;
+
+    char fullPath[128];
+    if (!resolveSoundPath(serial, index, bank, page, fullPath, sizeof(fullPath))) return;
+
+    bool wasIdle = !streams[stream].active;
+    if (queueStream(stream, fullPath, (uint16_t)fadeMs, loop != 0)) {
+        sendSerialResponse(serial, "PACK:QUEUE");
+        if (wasIdle) {
+            claimStream(stream, bank, bankClass[bank]);
+            sendSerialResponseF(serial, "S:%d,ply,-1", stream);
+        }
+    } else {
+        serial.println("ERR:NOFILE");
     }
 }
 
 void handleStop(Stream &serial, char* args) {
-    if (args[0] == '\0' || args[0] == '*') {
+    // Format: STOP:stream[,fadeMs] or STOP:*[,fadeMs]
+    char* comma = strchr(args, ',');
+    int fadeMs = comma ? atoi(comma + 1) : 0;
+    if (fadeMs < 0) fadeMs = 0;
+    if (fadeMs > MIXER_FADE_MAX_MS) fadeMs = MIXER_FADE_MAX_MS;
+
+    if (args[0] == '\0' || args[0] == '*' || args[0] == ',') {
         // Stop all
         for (int i = 0; i < maxStreams; i++) {
-            stopStream(i);
             sendSerialResponse(serial, "PACK:STOP");
-            sendSerialResponseF(serial, "S:%d,idle,,0", i);
+            if (fadeMs > 0 && streams && streams[i].active) {
+                fadeOutStream(i, fadeMs); // Reported idle by STAT once faded
+            } else {
+                stopStream(i);
+                sendSerialResponseF(serial, "S:%d,idle,,0", i);
+            }
         }
     } else {
         int stream = atoi(args);
         if (stream >= 0 && stream < maxStreams) {
-            stopStream(stream);
             sendSerialResponse(serial, "PACK:STOP");
-            sendSerialResponseF(serial, "S:%d,idle,,0", stream);
+            if (fadeMs > 0 && streams && streams[stream].active) {
+                fadeOutStream(stream, fadeMs);
+            } else {
+                stopStream(stream);
+                sendSerialResponseF(serial, "S:%d,idle,,0", stream);
+            }
         } else {
             serial.println("ERR:PARAM - Invalid stream");
         }
     }
 }
 
+void handleSeek(Stream &serial, char* args) {
+    // Format: SEEK:stream,ms
+    char* ptr = args;
+    
+    int stream = parseArgInt(ptr, -1);
+    int ms = parseArgInt(ptr, -1);
+    
+    if (stream < 0 || stream >= maxStreams || !streams) {
+        serial.println("ERR:PARAM - Invalid stream");
+        return;
+    }
+    if (ms < 0) {
+        serial.println("ERR:PARAM - Format: SEEK:stream,ms");
+        return;
+    }
+    if (!streams[stream].active) {
+        serial.println("ERR:PARAM - Stream not playing");
+        return;
+    }
+    
+    if (seekStream(stream, ms)) {
+        sendSerialResponse(serial, "PACK:SEEK");
+    } else {
+        serial.println("ERR:SEEK - Not seekable, restarted");
+    }
+}
+
+void handleFx(Stream &serial, char* args) {
+    // Format: FX:stream,filter,speed (filter N/H/R, speed 50-200 percent)
+    // Applies to what the stream plays now; a new PLAY starts from its bank's filter
+    char* ptr = args;
+    
+    int stream = parseArgInt(ptr, -1);
+    if (stream < 0 || stream >= maxStreams) {
+        serial.println("ERR:PARAM - Format: FX:stream,filter,speed");
+        return;
+    }
+    int filter = fxFilterFromChar(parseArgChar(ptr, 'N'));
+    int speed = parseArgInt(ptr, 100);
+    if (filter < 0) {
+        serial.println("ERR:PARAM - Filter must be N, H or R");
+        return;
+    }
+    if (speed < 50) speed = 50;
+    if (speed > 200) speed = 200;
+    
+    mixerSetFx(stream, (uint8_t)filter, (uint32_t)((speed * 65536 + 50) / 100));
+    sendSerialResponse(serial, "PACK:FX");
+}
+
 void handleChirp(Stream &serial, char* args) {
     // Format: CHRP:StartHz,EndHz,DurationMs,Volume
     char* ptr = args;
@@ -222,6 +314,107 @@ void handleChirp(Stream &serial, char* args) {
     sendSerialResponse(serial, "PACK:CHRP");
 }
 
+static int clampArg(int v, int lo, int hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+void handleSynthPatch(Stream &serial, char* args) {
+    // Format: SYNP:slot,wave,attackMs,decayMs,sustain,releaseMs,mod,ratio,depth
+    // wave S/T/Q/W/N, sustain percent, mod N/F/R, ratio percent of the note's frequency,
+    // depth FM index x100 or ring mix percent
+    char* ptr = args;
+
+    int slot = parseArgInt(ptr, -1);
+    if (slot < 0 || slot >= SYNTH_PATCHES) {
+        serial.println("ERR:PARAM - Format: SYNP:slot,wave,attack,decay,sustain,release,mod,ratio,depth");
+        return;
+    }
+    int wave = synthWaveFromChar(parseArgChar(ptr, 'S'));
+    int attack = parseArgInt(ptr, 2);
+    int decay = parseArgInt(ptr, 0);
+    int sustain = parseArgInt(ptr, 100);
+    int release = parseArgInt(ptr, 10);
+    int mod = synthModFromChar(parseArgChar(ptr, 'N'));
+    int ratio = parseArgInt(ptr, 100);
+    int depth = parseArgInt(ptr, 0);
+    if (wave < 0 || mod < 0) {
+        serial.println("ERR:PARAM - Wave must be S, T, Q, W or N, mod N, F or R");
+        return;
+    }
+
+    SynthPatch &p = synthPatches[slot];
+    p.wave = (uint8_t)wave;
+    p.mod = (uint8_t)mod;
+    p.attackMs = (uint16_t)clampArg(attack, 0, 5000);
+    p.decayMs = (uint16_t)clampArg(decay, 0, 5000);
+    p.sustain = (uint8_t)clampArg(sustain, 0, 100);
+    p.releaseMs = (uint16_t)clampArg(release, 0, 5000);
+    p.modRatio = (uint16_t)clampArg(ratio, 1, 1600);
+    p.modDepth = (uint16_t)clampArg(depth, 0, 1000);
+    sendSerialResponse(serial, "PACK:SYNP");
+}
+
+// Steps collected by SYNA for the next SYN
+static SynthStep synthPending[SYNTH_MAX_STEPS];
+static int synthPendingCount = 0;
+
+// Adds "patch,startHz,endHz,ms,vol;..." to the pending sequence. A step with
+// patch "-" is a rest of "-,ms", a "+" in front of a note starts it together
+// with the step before. Returns false if a step is malformed.
+static bool parseSynthSteps(char* args) {
+    char* step = args;
+    while (step && *step != '\0') {
+        char* next = strchr(step, ';');
+        if (next) *next++ = '\0';
+        char* ptr = step;
+        if (*ptr == '+') {
+            ptr++;
+            if (synthPendingCount > 0) synthPending[synthPendingCount - 1].advance = 0;
+        }
+        if (*ptr == '-') {
+            skipToNextArg(ptr);
+            int ms = parseArgInt(ptr, 100);
+            if (synthPendingCount < SYNTH_MAX_STEPS) synthPending[synthPendingCount++] = synthStep(-1, 0, 0, ms, 0);
+        } else if (*ptr != '\0') {
+            int patch = parseArgInt(ptr, -1);
+            int startHz = parseArgInt(ptr, -1);
+            if (patch < 0 || patch >= SYNTH_PATCHES || startHz < 0) return false;
+            int endHz = parseArgInt(ptr, startHz);
+            int ms = parseArgInt(ptr, 100);
+            int vol = parseArgInt(ptr, 128);
+            if (synthPendingCount < SYNTH_MAX_STEPS) synthPending[synthPendingCount++] = synthStep(patch, startHz, endHz, ms, vol);
+        }
+        step = next;
+    }
+    return true;
+}
+
+void handleSynth(Stream &serial, char* args, bool play) {
+    // Format: SYNA:steps (collect) / SYN:steps (collect and play), steps as in parseSynthSteps()
+    // SYN: with nothing collected stops the synth
+    if (!parseSynthSteps(args)) {
+        synthPendingCount = 0;
+        serial.println("ERR:PARAM - Format: SYN:patch,startHz,endHz,ms,vol;...");
+        return;
+    }
+    if (!play) {
+        sendSerialResponse(serial, "PACK:SYNA");
+        return;
+    }
+    if (synthPendingCount == 0) {
+        synthStop();
+        sendSerialResponse(serial, "PACK:SYN");
+        return;
+    }
+    bool ok = synthPlay(synthPending, synthPendingCount);
+    synthPendingCount = 0;
+    if (ok) {
+        sendSerialResponse(serial, "PACK:SYN");
+    } else {
+        serial.println("ERR:BUSY - All synth sequences playing");
+    }
+}
+
 void handleVolume(Stream &serial, char* args) {
     char* ptr = args;
     
@@ -238,7 +431,7 @@ void handleVolume(Stream &serial, char* args) {
         if (volume > 99) volume = 99;
         
         if (stream >= 0 && stream < maxStreams) {
-            if (streams) streams[stream].volume = (float)volume / 99.0f;
+            setStreamVolume(stream, (float)volume / 99.0f);
             sendSerialResponse(serial, "PACK:SVOL");
         } else {
             serial.println("ERR:PARAM - Invalid stream");
@@ -249,10 +442,8 @@ void handleVolume(Stream &serial, char* args) {
         if (volume < 0) volume = 0;
         if (volume > 99) volume = 99;
 
-        if (streams) {
-            for (int i = 0; i < maxStreams; i++) {
-                streams[i].volume = (float)volume / 99.0f;
-            }
+        for (int i = 0; i < maxStreams; i++) {
+            setStreamVolume(i, (float)volume / 99.0f);
         }
         sendSerialResponse(serial, "PACK:SVOL");
     }
@@ -340,6 +531,7 @@ void handleCcrc(Stream &serial) {
     for (int i = 0; i < maxStreams; i++) {
         stopStream(i);
     }
+    stopBank1Sync(); // Bank 1 plays from the SD card until the next boot
     
     int count = 0;
     Dir dir = LittleFS.openDir("/flash");
@@ -352,18 +544,40 @@ void handleCcrc(Stream &serial) {
         }
     }
     
+    LittleFS.remove(FLASH_MANIFEST_PATH);
+    
     serial.printf("Deleted %d files from /flash.\n", count);
     serial.println("Please REBOOT the board to re-sync files.");
     sendSerialResponse(serial, "PACK:CCRC");
 }
 
+void handleSync(Stream &serial) {
+    int onFlash, total;
+    const char* state = bank1SyncState(onFlash, total);
+    sendSerialResponseF(serial, "SYNC:%s,%d,%d", state, onFlash, total);
+}
+
+void handlePerf(Stream &serial, char* args) {
+    // Format: PERF or PERF:RESET
+    if (strcmp(args, ":RESET") == 0) {
+        perfReset();
+    } else if (*args != '\0') {
+        serial.println("ERR:PARAM - Format: PERF or PERF:RESET");
+        return;
+    } else {
+        perfReport(serial);
+    }
+    sendSerialResponse(serial, "PACK:PERF");
+}
+
 void handleStat(Stream &serial, char* args) {
     int stream = atoi(args);
     if (stream >= 0 && stream < maxStreams) {
         if (streams && streams[stream].active) {
             int vol = (int)(streams[stream].volume * 99.0f);
-            serial.printf("STAT:playing,%s,%d\n",
-                         streams[stream].filename, vol);
+            serial.printf("STAT:playing,%s,%d,%lu\n",
+                         streams[stream].filename, vol,
+                         (unsigned long)streamPositionMs(&streams[stream]));
         } else {
             serial.printf("STAT:idle,,0\n");
         }
@@ -476,15 +690,33 @@ void processSerialCommands(Stream &serial) {
                 if (strncmp(cmdBuffer, "PLAY:", 5) == 0) {
                     handlePlay(serial, cmdBuffer + 5);
                 }
+                else if (strncmp(cmdBuffer, "QUEUE:", 6) == 0) {
+                    handleQueue(serial, cmdBuffer + 6);
+                }
                 else if (strncmp(cmdBuffer, "STOP", 4) == 0) {
                     // STOP or STOP: param
                     char* args = cmdBuffer + 4;
                     if (*args == ':') args++;
                     handleStop(serial, args);
                 }
+                else if (strncmp(cmdBuffer, "SEEK:", 5) == 0) {
+                    handleSeek(serial, cmdBuffer + 5);
+                }
+                else if (strncmp(cmdBuffer, "FX:", 3) == 0) {
+                    handleFx(serial, cmdBuffer + 3);
+                }
                 else if (strncmp(cmdBuffer, "CHRP:", 5) == 0) {
                     handleChirp(serial, cmdBuffer + 5);
                 }
+                else if (strncmp(cmdBuffer, "SYNP:", 5) == 0) {
+                    handleSynthPatch(serial, cmdBuffer + 5);
+                }
+                else if (strncmp(cmdBuffer, "SYNA:", 5) == 0) {
+                    handleSynth(serial, cmdBuffer + 5, false);
+                }
+                else if (strncmp(cmdBuffer, "SYN:", 4) == 0) {
+                    handleSynth(serial, cmdBuffer + 4, true);
+                }
                 else if (strncmp(cmdBuffer, "VOL:", 4) == 0) {
                     handleVolume(serial, cmdBuffer + 4);
                 }
@@ -500,9 +732,15 @@ void processSerialCommands(Stream &serial) {
                 else if (strcmp(cmdBuffer, "CCRC") == 0) {
                     handleCcrc(serial);
                 }
+                else if (strcmp(cmdBuffer, "SYNC") == 0) {
+                    handleSync(serial);
+                }
                 else if (strncmp(cmdBuffer, "STAT:", 5) == 0) {
                     handleStat(serial, cmdBuffer + 5);
                 }
+                else if (strncmp(cmdBuffer, "PERF", 4) == 0) {
+                    handlePerf(serial, cmdBuffer + 4);
+                }
                 else if (strncmp(cmdBuffer, "BAUD:", 5) == 0) {
                     handleBaud(serial, cmdBuffer + 5);
                 }
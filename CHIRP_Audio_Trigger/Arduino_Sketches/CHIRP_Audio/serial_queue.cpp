@@ -49,26 +49,16 @@ bool queueSerial2Message(const char* msg) {
 // Check if CPU is Busy
 // ===================================
 bool isCpuBusy() {
-    // Check if any MP3 stream has a buffer running low
-    if (streams) {
-        for (int i = 0; i < maxStreams; i++) {
-            if (streams[i].active && streams[i].type == STREAM_TYPE_MP3_SD) {
-                int available = streams[i].ringBuffer->availableForRead();
-                // If buffer is less than 25% full, CPU should prioritize refilling
-                if (available < (streamBufferSize / 4)) {
-                    return true; // Buffer running low, CPU is busy
-                }
-            }
-        }
-    }
-    return false; // All buffers healthy, can send messages
+    // The refill scheduler tracks the smallest time-to-empty over all
+    // streams it is refilling; if any is close to running dry, back off.
+    return refillUrgencyMs < REFILL_URGENT_MS;
 }
 
 // ===================================
 // Try to Send Queued Messages
 // ===================================
 void trySendQueuedMessages(int maxMessages) {
-    // Don't send if CPU is busy with MP3 decoding
+    // Don't send if a stream is close to running dry
     if (isCpuBusy()) {
         return;
     }
@@ -0,0 +1,96 @@
+// Stream Allocation (Core 0)
+// Picks the stream a PLAY (or legacy root track) plays on. Every playing
+// stream is tagged with the bank it came from and a priority class (effects
+// < vocals < music, per PLAY or the bank's #BANK_CLASSES default). A free
+// stream is used if one is left after the #BANK_RESERVE reservations of
+// other banks; otherwise the lowest-priority, then oldest, stream of the
+// same or a lower class is faded out and taken. A bank below its reservation
+// may take any stream that isn't covering another bank's reservation.
+#include "config.h"
+
+uint8_t bankClass[7] = { STREAM_CLASS_MUSIC,   // 0: SD root / legacy tracks
+                         STREAM_CLASS_VOCALS,  // 1: Droid vocals
+                         STREAM_CLASS_EFFECTS, STREAM_CLASS_EFFECTS, STREAM_CLASS_EFFECTS,
+                         STREAM_CLASS_EFFECTS, STREAM_CLASS_EFFECTS };
+uint8_t bankReserve[7] = { 0, 0, 0, 0, 0, 0, 0 };
+
+static const char classLetters[STREAM_CLASS_COUNT] = { 'E', 'V', 'M' };
+
+// INI / PLAY letter (E, V or M) to class, -1 if not one
+int streamClassFromChar(char c) {
+    if (c >= 'a' && c <= 'z') c -= 32;
+    for (int i = 0; i < STREAM_CLASS_COUNT; i++) {
+        if (classLetters[i] == c) return i;
+    }
+    return -1;
+}
+
+char streamClassChar(uint8_t cls) {
+    return (cls < STREAM_CLASS_COUNT) ? classLetters[cls] : '?';
+}
+
+void claimStream(int streamIdx, uint8_t bank, uint8_t cls) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return;
+    AudioStream* s = &streams[streamIdx];
+    s->ownerBank = (bank <= 6) ? bank : 0;
+    s->streamClass = (cls < STREAM_CLASS_COUNT) ? cls : STREAM_CLASS_EFFECTS;
+    s->claimTime = millis();
+    mixerSetFx(streamIdx, bankFilter[s->ownerBank], 65536); // Bank's filter, normal speed
+}
+
+// Fades a stream out over STREAM_STEAL_FADE_MS and stops it
+static void stealStream(int i) {
+    AudioStream* s = &streams[i];
+    log_message(String("Stream ") + i + ": Stolen (" + streamClassChar(s->streamClass) + ", Bank " + s->ownerBank +
+                ", Age " + (millis() - s->claimTime) + "ms)");
+    stopStream(i, STREAM_STEAL_FADE_MS);
+}
+
+// ===================================
+// Allocate a Stream
+// ===================================
+// Returns a stopped stream for a sound of `bank` and class `cls`, stealing
+// one if needed, or -1 if every stream plays something it may not take.
+int allocateStream(uint8_t bank, uint8_t cls) {
+    if (!streams) return -1;
+    if (bank > 6) bank = 0;
+
+    int inUse[7] = { 0 };
+    int freeCount = 0;
+    for (int i = 0; i < maxStreams; i++) {
+        if (streams[i].active) inUse[streams[i].ownerBank]++;
+        else freeCount++;
+    }
+
+    // Free streams still owed to other banks' reservations
+    int held = 0;
+    for (int b = 0; b <= 6; b++) {
+        if (b != bank && inUse[b] < bankReserve[b]) held += bankReserve[b] - inUse[b];
+    }
+    if (freeCount > held) {
+        for (int i = 0; i < maxStreams; i++) {
+            if (!streams[i].active) return i;
+        }
+    }
+
+    // Steal: lowest class first, then the oldest
+    bool underReserve = inUse[bank] < bankReserve[bank];
+    int victim = -1;
+    uint32_t now = millis();
+    for (int i = 0; i < maxStreams; i++) {
+        AudioStream* s = &streams[i];
+        if (!s->active) continue;
+        if (s->ownerBank != bank && inUse[s->ownerBank] <= bankReserve[s->ownerBank]) continue; // Covers a reservation
+        if (!underReserve && s->streamClass > cls) continue;
+        if (victim == -1) { victim = i; continue; }
+        AudioStream* v = &streams[victim];
+        if (s->streamClass < v->streamClass ||
+            (s->streamClass == v->streamClass && now - s->claimTime > now - v->claimTime)) {
+            victim = i;
+        }
+    }
+    if (victim == -1) return -1;
+
+    stealStream(victim);
+    return victim;
+}
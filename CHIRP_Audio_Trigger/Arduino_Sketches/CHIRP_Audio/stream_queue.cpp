@@ -0,0 +1,271 @@
+// Stream Queue (Core 0)
+// Each stream can hold one queued next item (QUEUE command). As soon as the
+// current file has been read to the end, the next file is opened on the same
+// stream and its PCM goes into the same ring, straight after the last sample
+// of the current one: no stop, no ring clear, no fade-in.
+//
+// With a crossfade the tail of the current item is still in the ring when the
+// next one starts decoding, so the first fadeMs of the new item are mixed into
+// that tail in place (equal-power, cos/sin) instead of being appended. The
+// overlap is kept STREAM_XFADE_GUARD_MS ahead of the mixer's read position;
+// if the mixer gets there first the rest is appended unfaded.
+//
+// The ring holds one sample rate, so an item at a different rate (or a WAV
+// with a different channel count, or anything following a RAM-resident clip)
+// waits for the ring to drain and then starts fresh like a PLAY.
+#include "config.h"
+
+static int16_t xfadeCurve[STREAM_XFADE_STEPS + 1]; // sin(0..pi/2), Q15
+static bool xfadeCurveReady = false;
+
+static void initXfadeCurve() {
+    for (int i = 0; i <= STREAM_XFADE_STEPS; i++) {
+        xfadeCurve[i] = (int16_t)(sinf((float)i * (float)M_PI / (2.0f * STREAM_XFADE_STEPS)) * 32767.0f);
+    }
+    xfadeCurveReady = true;
+}
+
+// Curve at x (0 .. STREAM_XFADE_STEPS * 256), linearly interpolated
+static inline int32_t xfadeGain(uint32_t x) {
+    uint32_t i = x >> 8;
+    if (i >= STREAM_XFADE_STEPS) return xfadeCurve[STREAM_XFADE_STEPS];
+    int32_t a = xfadeCurve[i];
+    int32_t b = xfadeCurve[i + 1];
+    return a + (((b - a) * (int32_t)(x & 255)) >> 8);
+}
+
+static bool ringIsDrained(AudioStream* s) {
+    if (s->type == STREAM_TYPE_PCM_RAM) return s->ramPos >= s->ramFrames;
+    return s->ringBuffer->availableForRead() == 0;
+}
+
+void resetStreamQueue(AudioStream* s) {
+    s->nextFile[0] = '\0';
+    s->nextFadeMs = 0;
+    s->nextLoop = false;
+    s->joinPending = false;
+    s->restartPending = false;
+    s->xfadeLen = 0;
+    s->xfadeDone = 0;
+}
+
+// ===================================
+// Queue an Item
+// ===================================
+// Replaces whatever was queued on the stream. An idle stream starts the item
+// right away (and with `loop` keeps it queued behind itself).
+bool queueStream(int streamIdx, const char* filename, uint16_t fadeMs, bool loop) {
+    if (streamIdx < 0 || streamIdx >= maxStreams || !streams) return false;
+    AudioStream* s = &streams[streamIdx];
+    if (fadeMs > STREAM_XFADE_MAX_MS) fadeMs = STREAM_XFADE_MAX_MS;
+
+    if (!s->active) {
+        if (!startStream(streamIdx, filename)) return false;
+        if (!loop) return true;
+    }
+
+    strncpy(s->nextFile, filename, sizeof(s->nextFile) - 1);
+    s->nextFile[sizeof(s->nextFile) - 1] = '\0';
+    s->nextFadeMs = fadeMs;
+    s->nextLoop = loop;
+    log_message(String("Stream ") + streamIdx + ": Queued " + s->nextFile + " (Fade: " + fadeMs + "ms" + (loop ? ", Loop)" : ")"));
+    return true;
+}
+
+// ===================================
+// Join the Next Item (Core 0)
+// ===================================
+// Switches a stream whose file has been read to `path`, keeping the ring and
+// mixer state. Returns false if the item has to wait for the ring to drain.
+// A file that can't be opened is dropped and the stream plays out.
+static bool joinNext(AudioStream* s, int i, const char* path, uint16_t fadeMs) {
+    if (s->type == STREAM_TYPE_PCM_RAM) return false; // No ring to join
+
+    AudioFormat format = getAudioFormat(path);
+    bool isFlash = (strncmp(path, "/flash/", 7) == 0);
+    if (format == FORMAT_UNKNOWN || (g_mscActive && !isFlash)) {
+        log_message(String("Stream ") + i + ": ERROR - Can't queue " + path);
+        s->nextFile[0] = '\0';
+        return true;
+    }
+
+    // The ring keeps its layout; the new file's comes back from the open
+    uint8_t ch = s->channels;
+    uint32_t rate = s->sampleRate;
+    closeStreamSource(s);
+    if (!openStreamSource(s, i, path, format, isFlash)) {
+        s->channels = ch;
+        s->sampleRate = rate;
+        s->nextFile[0] = '\0'; // Don't retry a looped item that's gone
+        return true;
+    }
+
+    bool isWav = (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH || s->type == STREAM_TYPE_ADPCM_FLASH);
+    if (isWav && (s->channels != ch || s->sampleRate != rate)) {
+        closeStreamSource(s);
+        s->channels = ch;
+        s->sampleRate = rate;
+        return false;
+    }
+    s->channels = ch;
+    s->sampleRate = rate;
+    s->joinPending = !isWav; // Decoded rate is only known from the first frame
+    if (!isWav) s->bytesPerSec = DEFAULT_COMPRESSED_BYTES_PER_SEC;
+
+    strncpy(s->filename, path, sizeof(s->filename) - 1);
+    s->filename[sizeof(s->filename) - 1] = '\0';
+    s->stagingLen = 0;
+    s->stagingPos = 0;
+    s->discardFrames = 0;
+    s->fileFinished = false;
+
+    // Crossfade over the tail that is still buffered, short of the guard
+    RingBuffer* rb = s->ringBuffer;
+    int avail = rb->availableForRead();
+    uint32_t len = 0;
+    if (fadeMs > 0) {
+        if (!xfadeCurveReady) initXfadeCurve();
+        uint32_t want = (uint32_t)(((uint64_t)fadeMs * rate) / 1000) * ch;
+        int guard = (int)(((uint64_t)STREAM_XFADE_GUARD_MS * rate) / 1000) * ch;
+        int room = avail - guard;
+        len = (room > 0) ? (uint32_t)room : 0;
+        if (len > want) len = want;
+        len -= len % ch;
+    }
+    s->xfadeLen = len;
+    s->xfadeDone = 0;
+    s->xfadeStart = (rb->writePos - (int)len) & streamBufferMask;
+
+    // Position of the new file counts from where it becomes audible
+    s->startOffsetMs = 0;
+    s->joinFrames = s->playedFrames + (uint32_t)(avail - (int)len) / ch;
+
+    uint32_t fadeShown = rate ? (uint32_t)(((uint64_t)(len / ch) * 1000) / rate) : 0;
+    log_message(String("Stream ") + i + ": Joined " + path + " (Crossfade: " + fadeShown + "ms)");
+    return true;
+}
+
+// Starts the stream's current filename from scratch, keeping what's queued
+static void restartItem(AudioStream* s, int i) {
+    char path[64];
+    strncpy(path, s->filename, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    char next[64];
+    memcpy(next, s->nextFile, sizeof(next));
+    uint16_t fadeMs = s->nextFadeMs;
+    bool loop = s->nextLoop;
+
+    if (!startStream(i, path)) return; // Stream stays stopped, queue dropped
+    memcpy(s->nextFile, next, sizeof(next));
+    s->nextFadeMs = fadeMs;
+    s->nextLoop = loop;
+}
+
+// ===================================
+// Service (Core 0)
+// ===================================
+// Moves streams on to their queued item. Runs from fillStreamBuffers()
+// before its auto-stop, so a finished file with something queued is never
+// stopped.
+void serviceStreamQueues() {
+    if (!streams) return;
+    for (int i = 0; i < maxStreams; i++) {
+        AudioStream* s = &streams[i];
+        if (!s->active) continue;
+
+        if (s->restartPending) {
+            if (ringIsDrained(s)) restartItem(s, i);
+            continue;
+        }
+        if (!s->fileFinished || s->openPending || s->nextFile[0] == '\0') continue;
+
+        char path[64];
+        memcpy(path, s->nextFile, sizeof(path));
+        uint16_t fadeMs = s->nextFadeMs;
+        if (!s->nextLoop) s->nextFile[0] = '\0';
+
+        if (!joinNext(s, i, path, fadeMs)) {
+            strncpy(s->filename, path, sizeof(s->filename) - 1);
+            s->filename[sizeof(s->filename) - 1] = '\0';
+            s->restartPending = true;
+            log_message(String("Stream ") + i + ": " + path + " can't join the running ring, restarting after it");
+        }
+    }
+}
+
+// ===================================
+// Stream PCM Input (Core 0)
+// ===================================
+// Lands decoded / read PCM in the stream's ring: mixed into the crossfade
+// overlap while one is running, appended after it. `rate` is the source
+// rate, checked once for a joined compressed file.
+int pushStreamPcm(AudioStream* s, const int16_t* src, int count, int srcChannels, uint32_t rate) {
+    if (s->restartPending) return 0;
+    if (s->joinPending) {
+        if (rate != 0 && rate != s->sampleRate) {
+            // Rest of this file is decoded for nothing; it restarts once the ring drains
+            s->joinPending = false;
+            s->xfadeLen = 0;
+            s->fileFinished = true;
+            s->restartPending = true;
+            log_message(String("Stream ") + (int)(s - streams) + ": " + rate + "Hz can't join a " + s->sampleRate + "Hz ring, restarting after it");
+            return 0;
+        }
+        s->joinPending = false;
+    }
+
+    RingBuffer* rb = s->ringBuffer;
+    int ch = s->channels;
+    if (s->xfadeDone >= s->xfadeLen) return pushPcm(rb, src, count, srcChannels, ch);
+
+    int frames = count / srcChannels;
+    int f = 0;
+    int guard = (int)(((uint64_t)STREAM_XFADE_GUARD_MS * s->sampleRate) / 1000) * ch;
+    uint32_t full = (uint32_t)STREAM_XFADE_STEPS << 8;
+
+    while (f < frames && s->xfadeDone < s->xfadeLen) {
+        // Still ahead of Core 1? (checked per block of frames, the guard covers one)
+        int pos = (s->xfadeStart + (int)s->xfadeDone) & streamBufferMask;
+        int r = __atomic_load_n(&rb->readPos, __ATOMIC_ACQUIRE);
+        int ahead = (pos - r + streamBufferSize) & streamBufferMask;
+        if (ahead < guard || ahead >= rb->availableForRead()) {
+            log_message(String("Stream ") + (int)(s - streams) + ": Crossfade cut short");
+            s->xfadeLen = s->xfadeDone;
+            break;
+        }
+
+        int blockEnd = f + MIXER_BLOCK_FRAMES;
+        if (blockEnd > frames) blockEnd = frames;
+        for (; f < blockEnd && s->xfadeDone < s->xfadeLen; f++) {
+            uint32_t x = (uint32_t)(((uint64_t)s->xfadeDone * full) / s->xfadeLen);
+            int32_t gIn = xfadeGain(x);
+            int32_t gOut = xfadeGain(full - x);
+
+            const int16_t* in = src + f * srcChannels;
+            int16_t head[2];
+            if (srcChannels == ch) {
+                head[0] = in[0];
+                head[1] = (ch == 2) ? in[1] : 0;
+            } else if (ch == 2) {
+                head[0] = head[1] = in[0]; // Mono -> stereo
+            } else {
+                head[0] = (int16_t)(((int32_t)in[0] + in[1]) >> 1); // Stereo -> mono
+            }
+
+            for (int c = 0; c < ch; c++) {
+                int p = (pos + c) & streamBufferMask;
+                int32_t v = ((int32_t)rb->buffer[p] * gOut + (int32_t)head[c] * gIn) >> 15;
+                if (v > 32767) v = 32767;
+                else if (v < -32768) v = -32768;
+                rb->buffer[p] = (int16_t)v;
+            }
+            pos = (pos + ch) & streamBufferMask;
+            s->xfadeDone += ch;
+        }
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    int pushed = f * srcChannels;
+    if (f < frames) pushed += pushPcm(rb, src + pushed, (frames - f) * srcChannels, srcChannels, ch);
+    return pushed;
+}
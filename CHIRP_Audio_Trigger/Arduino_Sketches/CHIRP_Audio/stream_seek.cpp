@@ -0,0 +1,351 @@
+// Stream seeking (Core 0)
+// Positions an open stream's file at a time offset: WAV by byte math, M4A
+// from the cached sample tables, MP3 from a Xing/VBRI TOC (or the CBR
+// bitrate) and raw AAC from the average ADTS frame size.
+#include "config.h"
+
+// Bytes scanned for a frame sync after a byte-estimated MP3/AAC jump
+#define SEEK_SYNC_WINDOW 4096
+
+static bool streamOnSd(AudioStream* s) {
+    return s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD ||
+           s->type == STREAM_TYPE_AAC_SD || s->type == STREAM_TYPE_M4A_SD;
+}
+
+// ===================================
+// File Helpers (caller holds the stream's mutex)
+// ===================================
+static int readAt(AudioStream* s, uint32_t pos, uint8_t* buf, int len) {
+    if (streamOnSd(s)) {
+        if (!s->sdFile.seek(pos)) return 0;
+        return s->sdFile.read(buf, len);
+    }
+    if (!s->flashFile.seek(pos)) return 0;
+    return s->flashFile.read(buf, len);
+}
+
+static uint32_t streamFileSize(AudioStream* s) {
+    return streamOnSd(s) ? s->sdFile.size() : s->flashFile.size();
+}
+
+static void seekFile(AudioStream* s, uint32_t pos) {
+    if (streamOnSd(s)) s->sdFile.seek(pos);
+    else s->flashFile.seek(pos);
+}
+
+// Skips an ID3v2 tag at the start of the file. Returns the audio start offset.
+static uint32_t skipId3(AudioStream* s) {
+    uint8_t h[10];
+    if (readAt(s, 0, h, 10) != 10 || memcmp(h, "ID3", 3) != 0) return 0;
+    uint32_t size = ((h[6] & 0x7F) << 21) | ((h[7] & 0x7F) << 14) | ((h[8] & 0x7F) << 7) | (h[9] & 0x7F);
+    return 10 + size + ((h[5] & 0x10) ? 10 : 0); // Footer flag
+}
+
+// ===================================
+// MP3 Frame Headers
+// ===================================
+// Parses a Layer III frame header. Returns false if `h` isn't one.
+bool parseMp3Header(const uint8_t* h, Mp3FrameHeader &out) {
+    static const uint16_t kbpsV1[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+    static const uint16_t kbpsV2[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+    static const uint32_t ratesV1[3] = {44100, 48000, 32000};
+
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+    int version = (h[1] >> 3) & 0x03; // 0 = 2.5, 2 = 2, 3 = 1
+    int layer = (h[1] >> 1) & 0x03;   // 1 = Layer III
+    int bitrateIdx = h[2] >> 4;
+    int rateIdx = (h[2] >> 2) & 0x03;
+    if (version == 1 || layer != 1 || bitrateIdx == 0 || bitrateIdx == 15 || rateIdx == 3) return false;
+
+    out.mpeg1 = (version == 3);
+    out.sampleRate = ratesV1[rateIdx] >> (out.mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    out.bitrate = (out.mpeg1 ? kbpsV1[bitrateIdx] : kbpsV2[bitrateIdx]) * 1000;
+    out.samplesPerFrame = out.mpeg1 ? 1152 : 576;
+    out.frameLen = (out.mpeg1 ? 144 : 72) * out.bitrate / out.sampleRate + ((h[2] >> 1) & 0x01);
+    out.channels = ((h[3] >> 6) == 3) ? 1 : 2;
+    return true;
+}
+
+// ADTS header: frame length in bytes (0 if `h` isn't a header)
+static uint32_t adtsFrameLen(const uint8_t* h) {
+    if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0) return 0;
+    uint32_t len = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+    return (len > 7) ? len : 0;
+}
+
+static uint32_t adtsSampleRate(const uint8_t* h) {
+    static const uint32_t rates[13] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                       22050, 16000, 12000, 11025, 8000, 7350};
+    int idx = (h[2] >> 2) & 0x0F;
+    return (idx < 13) ? rates[idx] : 0;
+}
+
+// Finds the first frame header at or after `pos` that is followed by a
+// second header where its length says it should be (rules out sync words
+// inside audio data). Returns the file offset, or `pos` if none is found.
+static uint32_t resyncFrame(AudioStream* s, uint32_t pos, bool adts) {
+    uint8_t local[1024];
+    uint8_t* buf = s->staging ? s->staging : local;
+    int cap = s->staging ? SEEK_SYNC_WINDOW : (int)sizeof(local);
+
+    int n = readAt(s, pos, buf, cap);
+    for (int i = 0; i + 4 <= n; i++) {
+        uint32_t len = 0;
+        if (adts) {
+            if (i + 7 > n) break;
+            len = adtsFrameLen(buf + i);
+        } else {
+            Mp3FrameHeader hdr;
+            if (parseMp3Header(buf + i, hdr)) len = hdr.frameLen;
+        }
+        if (len == 0) continue;
+
+        uint32_t next = i + len;
+        if (next + 4 > (uint32_t)n) return pos + i; // Can't confirm, take it
+        bool confirmed = false;
+        if (adts) {
+            confirmed = adtsFrameLen(buf + next) != 0;
+        } else {
+            Mp3FrameHeader hdr;
+            confirmed = parseMp3Header(buf + next, hdr);
+        }
+        if (confirmed) return pos + i;
+    }
+    return pos;
+}
+
+// ===================================
+// Seek: WAV
+// ===================================
+static bool seekWav(AudioStream* s, uint32_t ms) {
+    uint32_t block = s->channels * 2;
+    uint64_t frame = (uint64_t)ms * s->sampleRate / 1000;
+    uint64_t off = frame * block;
+    uint32_t maxOff = s->dataSize - (s->dataSize % block);
+    if (off > maxOff) off = maxOff;
+    seekFile(s, s->dataStart + (uint32_t)off);
+    return true;
+}
+
+// ===================================
+// Seek: IMA-ADPCM
+// ===================================
+// To the block holding the frame; the frames in front of it are dropped
+// after decoding.
+static bool seekAdpcm(AudioStream* s, uint32_t ms) {
+    uint32_t spb = s->adpcmSamplesPerBlock;
+    uint64_t frame = (uint64_t)ms * s->sampleRate / 1000;
+    if (frame > s->adpcmFrames) frame = s->adpcmFrames;
+    uint32_t block = (uint32_t)frame / spb;
+    seekFile(s, s->dataStart + block * s->adpcmBlockAlign);
+    s->adpcmFramesLeft = s->adpcmFrames - block * spb;
+    s->discardFrames = (uint32_t)frame - block * spb;
+    return true;
+}
+
+// ===================================
+// Seek: MP3
+// ===================================
+// Xing/Info TOC: 100 entries mapping percent of duration -> 1/256 of bytes.
+// VBRI TOC: per-entry byte deltas for a fixed number of frames each.
+// Neither: the file is CBR, so frames sit at a fixed byte pitch.
+static bool seekMp3(AudioStream* s, uint32_t ms) {
+    uint32_t audioStart = skipId3(s);
+    uint32_t fileSize = streamFileSize(s);
+
+    uint8_t f[192];
+    int n = readAt(s, audioStart, f, sizeof(f));
+    uint32_t first = resyncFrame(s, audioStart, false);
+    if (first != audioStart) n = readAt(s, first, f, sizeof(f));
+
+    Mp3FrameHeader hdr;
+    if (n < 4 || !parseMp3Header(f, hdr)) return false;
+    uint32_t targetFrame = (uint32_t)((uint64_t)ms * hdr.sampleRate / 1000 / hdr.samplesPerFrame);
+    uint32_t streamBytes = fileSize - first;
+    uint32_t pos = 0;
+    bool exact = false;
+
+    // Xing/Info sits after the side info of the first frame
+    int xingOff = 4 + (hdr.mpeg1 ? (hdr.channels == 2 ? 32 : 17) : (hdr.channels == 2 ? 17 : 9));
+
+    if (n >= xingOff + 8 && (memcmp(f + xingOff, "Xing", 4) == 0 || memcmp(f + xingOff, "Info", 4) == 0)) {
+        uint32_t flags = (f[xingOff + 4] << 24) | (f[xingOff + 5] << 16) | (f[xingOff + 6] << 8) | f[xingOff + 7];
+        int p = xingOff + 8;
+        uint32_t frames = 0;
+        if (flags & 0x1) { frames = (f[p] << 24) | (f[p + 1] << 16) | (f[p + 2] << 8) | f[p + 3]; p += 4; }
+        if (flags & 0x2) { streamBytes = (f[p] << 24) | (f[p + 1] << 16) | (f[p + 2] << 8) | f[p + 3]; p += 4; }
+
+        if ((flags & 0x4) && frames > 0 && p + 100 <= n) {
+            // Interpolate the TOC at the target's percentage of the duration
+            float pct = (float)targetFrame * 100.0f / frames;
+            if (pct > 99.999f) pct = 99.999f;
+            int a = (int)pct;
+            float fa = f[p + a];
+            float fb = (a < 99) ? f[p + a + 1] : 256.0f;
+            float frac = fa + (fb - fa) * (pct - a);
+            pos = first + (uint32_t)(frac / 256.0f * streamBytes);
+        } else {
+            // Info (CBR) tag, or Xing without TOC: assume a constant frame pitch
+            uint64_t pitch256 = frames ? ((uint64_t)streamBytes << 8) / frames : (uint64_t)hdr.frameLen << 8;
+            pos = first + hdr.frameLen + (uint32_t)(((uint64_t)targetFrame * pitch256) >> 8);
+            exact = true;
+        }
+    } else if (n >= 36 + 26 && memcmp(f + 36, "VBRI", 4) == 0) {
+        const uint8_t* v = f + 36;
+        streamBytes = (v[10] << 24) | (v[11] << 16) | (v[12] << 8) | v[13];
+        uint16_t entries = (v[18] << 8) | v[19];
+        uint16_t scale = (v[20] << 8) | v[21];
+        uint16_t entrySize = (v[22] << 8) | v[23];
+        uint16_t framesPerEntry = (v[24] << 8) | v[25];
+        if (framesPerEntry == 0 || entrySize < 1 || entrySize > 4) return false;
+
+        // Sum the byte deltas up to the target entry
+        uint32_t want = targetFrame / framesPerEntry;
+        if (want > entries) want = entries;
+        uint32_t tocPos = first + 36 + 26;
+        uint32_t bytes = 0;
+        uint8_t e[64];
+        for (uint32_t i = 0; i < want; ) {
+            uint32_t batch = sizeof(e) / entrySize;
+            if (batch > want - i) batch = want - i;
+            if (readAt(s, tocPos + i * entrySize, e, batch * entrySize) != (int)(batch * entrySize)) return false;
+            for (uint32_t k = 0; k < batch; k++) {
+                uint32_t val = 0;
+                for (int b = 0; b < entrySize; b++) val = (val << 8) | e[k * entrySize + b];
+                bytes += val * scale;
+            }
+            i += batch;
+        }
+        pos = first + hdr.frameLen + bytes;
+    } else {
+        // CBR: average pitch (padding slots make it fractional)
+        exact = true;
+        uint64_t pitch256 = ((uint64_t)(hdr.mpeg1 ? 144 : 72) * hdr.bitrate * 256) / hdr.sampleRate;
+        pos = first + (uint32_t)(((uint64_t)targetFrame * pitch256) >> 8);
+    }
+
+    if (pos >= fileSize) return false;
+    if (pos != first) pos = resyncFrame(s, pos, false);
+    seekFile(s, pos);
+
+    // Byte-exact frame pitch: trim to the sample inside the frame
+    if (exact) {
+        s->discardFrames = (uint32_t)((uint64_t)ms * hdr.sampleRate / 1000) - targetFrame * hdr.samplesPerFrame;
+        s->discardRate = hdr.sampleRate;
+    }
+    return true;
+}
+
+// ===================================
+// Seek: Raw AAC (ADTS)
+// ===================================
+// ADTS has no index; the average frame size over the first frames gives
+// the byte pitch, then we sync to the nearest header.
+static bool seekAdts(AudioStream* s, uint32_t ms) {
+    uint32_t audioStart = skipId3(s);
+    uint32_t first = resyncFrame(s, audioStart, true);
+    uint32_t fileSize = streamFileSize(s);
+
+    uint8_t h[7];
+    if (readAt(s, first, h, 7) != 7 || adtsFrameLen(h) == 0) return false;
+    uint32_t rate = adtsSampleRate(h);
+    if (rate == 0) return false;
+
+    // Average over up to 32 frames
+    uint32_t pos = first;
+    uint32_t frames = 0;
+    while (frames < 32 && readAt(s, pos, h, 7) == 7) {
+        uint32_t len = adtsFrameLen(h);
+        if (len == 0) break;
+        pos += len;
+        frames++;
+    }
+    if (frames == 0) return false;
+    uint32_t avg256 = ((pos - first) * 256) / frames;
+
+    uint32_t targetFrame = (uint32_t)((uint64_t)ms * rate / 1000 / 1024);
+    uint32_t target = first + (uint32_t)(((uint64_t)targetFrame * avg256) >> 8);
+    if (target >= fileSize) return false;
+    if (target != first) target = resyncFrame(s, target, true);
+    seekFile(s, target);
+    return true;
+}
+
+// ===================================
+// Seek: M4A
+// ===================================
+static bool seekM4a(AudioStream* s, uint32_t ms) {
+    uint32_t rate = s->mp4Parser.getSampleRate();
+    if (rate == 0) return false;
+    uint64_t targetPcm = (uint64_t)ms * rate / 1000;
+    uint32_t sample = (uint32_t)(targetPcm / 1024);
+    if (!s->mp4Parser.seekToSample(sample)) return false;
+
+    s->discardFrames = (uint32_t)(targetPcm - (uint64_t)sample * 1024);
+    s->discardRate = rate;
+    return true;
+}
+
+// ===================================
+// Seek Stream File (Core 0)
+// ===================================
+// Positions the stream's file at `ms`. The stream must not be mixing
+// (startStream before it goes active, or seekStream with it paused).
+// Takes the stream's file mutex. The decoder's input is reset and any
+// sub-frame remainder is left in discardFrames for the decoder callbacks.
+// Returns false (file rewound to the start) if the format can't be seeked.
+bool seekStreamFile(AudioStream* s, uint32_t ms) {
+    s->discardFrames = 0;
+    s->discardRate = 0;
+
+    bool sd = streamOnSd(s);
+    if (sd) sdIoBegin(SD_IO_STREAM);
+    else mutex_enter_blocking(&flash_mutex);
+
+    bool ok = false;
+    switch (s->type) {
+        case STREAM_TYPE_WAV_SD:
+        case STREAM_TYPE_WAV_FLASH:
+            ok = seekWav(s, ms);
+            break;
+        case STREAM_TYPE_ADPCM_FLASH:
+            ok = seekAdpcm(s, ms);
+            break;
+        case STREAM_TYPE_MP3_SD:
+        case STREAM_TYPE_MP3_FLASH:
+            ok = seekMp3(s, ms);
+            break;
+        case STREAM_TYPE_AAC_SD:
+        case STREAM_TYPE_AAC_FLASH:
+            ok = seekAdts(s, ms);
+            break;
+        case STREAM_TYPE_M4A_SD:
+        case STREAM_TYPE_M4A_FLASH:
+            ok = seekM4a(s, ms);
+            break;
+        default:
+            break;
+    }
+
+    // Failed: back to the start of the audio, so the stream still plays
+    if (!ok) {
+        s->discardFrames = 0;
+        if (s->type == STREAM_TYPE_M4A_SD || s->type == STREAM_TYPE_M4A_FLASH) s->mp4Parser.seekToSample(0);
+        else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH) seekFile(s, s->dataStart);
+        else if (s->type == STREAM_TYPE_ADPCM_FLASH) seekAdpcm(s, 0);
+        else seekFile(s, 0);
+    }
+
+    if (sd) sdIoEnd();
+    else mutex_exit(&flash_mutex);
+
+    // Restart the decoder on the new frame boundary
+    if (s->decoderIndex != -1) restartDecoder(s->decoderIndex);
+
+    s->stagingLen = 0;
+    s->stagingPos = 0;
+    s->fileFinished = false;
+    s->startOffsetMs = ok ? ms : 0;
+    s->playedFrames = 0;
+    return ok;
+}
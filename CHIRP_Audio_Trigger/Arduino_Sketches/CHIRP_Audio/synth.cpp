@@ -0,0 +1,403 @@
+// Synth (Core 1 render, sequences handed over from Core 0)
+// Procedural droid beeps, whistles and chatter, played without opening a
+// file. SYNTH_VOICES notes sound at once, each with a wavetable oscillator
+// (sine, triangle, square, saw or pitched noise), a pitch sweep, an ADSR
+// envelope and optional FM or ring modulation by a sine at a ratio of the
+// note's frequency. The instruments are the SYNP patches.
+//
+// A sequence is a list of notes and rests played back to back, or together
+// for chords (SYN). Core 0 fills one of SYNTH_SEQUENCES slots and hands it
+// over through the mixer command queue; Core 1 then starts every note on the
+// sample it is due, so timing doesn't depend on when loop() gets round to it.
+// A note's release overlaps the next one. CHRP is a one-note sequence with a
+// fixed sine patch. Rendering is timed by the bench (SYNTH rows).
+#include "config.h"
+
+#define SYNTH_TABLE_BITS 8
+#define SYNTH_TABLE_SIZE (1 << SYNTH_TABLE_BITS)
+#define SYNTH_ENV_FULL (1 << 24)
+#define SYNTH_MAX_NOTE_MS 60000
+
+enum SynthEnvStage : uint8_t { ENV_IDLE = 0, ENV_ATTACK, ENV_DECAY, ENV_SUSTAIN, ENV_RELEASE };
+
+// Sounding note (Core 1)
+struct SynthVoice {
+    uint8_t stage;          // SynthEnvStage
+    uint8_t wave;
+    uint8_t mod;
+    uint8_t volume;         // 0..255
+    uint32_t phase;
+    uint32_t inc;           // Phase increment per sample
+    uint32_t endInc;        // Where the sweep stops
+    int32_t incStep;        // Sweep per sample
+    uint32_t modPhase;
+    uint32_t modRatio;      // Modulator increment per carrier increment, Q16
+    int64_t fmScale;        // Phase offset at a full-scale modulator sample
+    int32_t ringMix;        // Q8
+    int32_t env;            // Q24
+    int32_t envStep;        // Change per sample in the current stage
+    uint32_t envLeft;       // Samples left in the stage
+    int32_t sustain;        // Q24
+    uint32_t decaySamples;
+    uint32_t releaseSamples;
+    uint32_t gateLeft;      // Samples until the release starts
+    uint32_t noise;         // xorshift32 state
+    int16_t noiseHold;      // Noise sample held for one oscillator cycle
+    uint32_t started;       // Trigger order, the oldest note is stolen first
+};
+
+// Filled in by Core 0 while free, played by Core 1 while busy
+struct SynthSeq {
+    volatile bool busy;
+    bool playing;           // Core 1
+    uint8_t count;
+    uint8_t next;           // Core 1: step to start next
+    uint32_t wait;          // Core 1: samples until then
+    SynthPatch patches[SYNTH_PATCHES + 1]; // As they were at SYN time, + the CHRP patch
+    SynthStep steps[SYNTH_MAX_STEPS];
+};
+
+// Default instruments (SYNP replaces them until the next boot)
+SynthPatch synthPatches[SYNTH_PATCHES] = {
+    // wave                mod             sus  att  dec  rel  ratio depth
+    { SYNTH_WAVE_SINE,     SYNTH_MOD_NONE, 100,   2,   0,  10, 100,    0 }, // 0: Beep
+    { SYNTH_WAVE_SQUARE,   SYNTH_MOD_NONE,  60,   1,  20,  15, 100,    0 }, // 1: Blip
+    { SYNTH_WAVE_SINE,     SYNTH_MOD_FM,   100,   3,   0,  20,  50,  300 }, // 2: Warble
+    { SYNTH_WAVE_TRIANGLE, SYNTH_MOD_RING,  80,   2,  30,  20, 150,  100 }, // 3: Chatter
+    { SYNTH_WAVE_NOISE,    SYNTH_MOD_NONE,  70,   1,  40,  30, 100,    0 }, // 4: Raspberry
+    { SYNTH_WAVE_SAW,      SYNTH_MOD_FM,    80,   5,  50,  40, 200,  150 }, // 5: Buzz
+    { SYNTH_WAVE_SINE,     SYNTH_MOD_FM,   100,  20,   0,  80,   3,  400 }, // 6: Whistle (slow wobble)
+    { SYNTH_WAVE_SINE,     SYNTH_MOD_NONE,   0,   1, 150,   0, 100,    0 }, // 7: Ping (decays away)
+};
+
+// CHRP: the plain sine sweep it always was, with a de-click edge
+static const SynthPatch chirpPatch = { SYNTH_WAVE_SINE, SYNTH_MOD_NONE, 100, 1, 0, 3, 100, 0 };
+
+static const char waveLetters[SYNTH_WAVE_COUNT] = { 'S', 'T', 'Q', 'W', 'N' };
+static const char modLetters[SYNTH_MOD_COUNT] = { 'N', 'F', 'R' };
+
+// One cycle per table, +1 guard entry for the interpolation (noise has none)
+static int16_t tables[SYNTH_WAVE_NOISE][SYNTH_TABLE_SIZE + 1];
+static SynthVoice synthVoices[SYNTH_VOICES];
+static SynthSeq seqs[SYNTH_SEQUENCES];
+static uint32_t triggerCount = 0;
+
+static int letterIndex(const char* letters, int count, char c) {
+    if (c >= 'a' && c <= 'z') c -= 32;
+    for (int i = 0; i < count; i++) {
+        if (letters[i] == c) return i;
+    }
+    return -1;
+}
+
+// SYNP letters: S(ine), T(riangle), Q (square), W (saw), N(oise)
+int synthWaveFromChar(char c) {
+    return letterIndex(waveLetters, SYNTH_WAVE_COUNT, c);
+}
+
+// SYNP letters: N(one), F(M), R(ing)
+int synthModFromChar(char c) {
+    return letterIndex(modLetters, SYNTH_MOD_COUNT, c);
+}
+
+// ===================================
+// Init (Core 0, before Core 1 mixes)
+// ===================================
+void initSynth() {
+    for (int i = 0; i <= SYNTH_TABLE_SIZE; i++) {
+        float x = (float)(i % SYNTH_TABLE_SIZE) / SYNTH_TABLE_SIZE; // 0..1 of a cycle
+        float tri = (x < 0.25f) ? 4.0f * x : (x < 0.75f) ? 2.0f - 4.0f * x : 4.0f * x - 4.0f;
+        tables[SYNTH_WAVE_SINE][i] = (int16_t)lroundf(sinf(2.0f * (float)M_PI * x) * 32767.0f);
+        tables[SYNTH_WAVE_TRIANGLE][i] = (int16_t)lroundf(tri * 32767.0f);
+        tables[SYNTH_WAVE_SQUARE][i] = (x < 0.5f) ? 32767 : -32767;
+        tables[SYNTH_WAVE_SAW][i] = (int16_t)lroundf((2.0f * x - 1.0f) * 32767.0f);
+    }
+    memset(synthVoices, 0, sizeof(synthVoices));
+    for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+        seqs[i].busy = false;
+        seqs[i].playing = false;
+    }
+}
+
+// ===================================
+// Sequences (Core 0)
+// ===================================
+// One note of `ms` sweeping from startHz to endHz, or a rest (patch < 0)
+SynthStep synthStep(int patch, int startHz, int endHz, int ms, int vol) {
+    SynthStep st = {};
+    st.patch = (patch < 0 || patch > SYNTH_PATCH_CHIRP) ? SYNTH_STEP_REST : (uint8_t)patch;
+    st.volume = (uint8_t)((vol < 0) ? 0 : (vol > 255) ? 255 : vol);
+
+    const int maxHz = SAMPLE_RATE / 2;
+    if (startHz < 0) startHz = 0;
+    if (startHz > maxHz) startHz = maxHz;
+    if (endHz < 0) endHz = 0;
+    if (endHz > maxHz) endHz = maxHz;
+    double incPerHz = 4294967296.0 / (double)SAMPLE_RATE;
+    st.startInc = (uint32_t)(startHz * incPerHz);
+    st.endInc = (uint32_t)(endHz * incPerHz);
+
+    if (ms < 0) ms = 0;
+    if (ms > SYNTH_MAX_NOTE_MS) ms = SYNTH_MAX_NOTE_MS;
+    st.samples = (uint32_t)(((uint64_t)ms * SAMPLE_RATE) / 1000);
+    st.advance = st.samples;
+    return st;
+}
+
+// Hands `steps` to Core 1 in a free slot, with the patches as they are now
+bool synthPlay(const SynthStep* steps, int count) {
+    if (count <= 0) return true;
+    if (count > SYNTH_MAX_STEPS) count = SYNTH_MAX_STEPS;
+    for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+        SynthSeq &q = seqs[i];
+        if (__atomic_load_n(&q.busy, __ATOMIC_ACQUIRE)) continue;
+        memcpy(q.patches, synthPatches, sizeof(synthPatches));
+        q.patches[SYNTH_PATCH_CHIRP] = chirpPatch;
+        memcpy(q.steps, steps, count * sizeof(SynthStep));
+        q.count = (uint8_t)count;
+        q.busy = true;
+        mixerSynth(i); // Publishes the slot along with the command
+        return true;
+    }
+    return false;
+}
+
+// Ends every sequence and releases every note
+void synthStop() {
+    mixerSynth(-1);
+}
+
+// True while any sequence is still playing its steps
+bool synthBusy() {
+    for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+        if (__atomic_load_n(&seqs[i].busy, __ATOMIC_ACQUIRE)) return true;
+    }
+    return false;
+}
+
+// ===================================
+// HELPER: Trigger a Chirp
+// ===================================
+// startFreq: Start Frequency in Hz
+// endFreq:   End Frequency in Hz
+// durationMs: Duration in Milliseconds
+// vol:        Volume (0-255)
+void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol) {
+    if (durationMs <= 0) return;
+    SynthStep st = synthStep(SYNTH_PATCH_CHIRP, startFreq, endFreq, durationMs, vol);
+    if (!synthPlay(&st, 1)) Serial.println("Synth: All sequences busy, chirp dropped");
+}
+
+// ===================================
+// Voices (Core 1)
+// ===================================
+static inline uint32_t msToSamples(uint16_t ms) {
+    return (uint32_t)ms * SAMPLE_RATE / 1000;
+}
+
+// Table value at `phase`, linearly interpolated
+static inline int32_t lookup(const int16_t* table, uint32_t phase) {
+    uint32_t i = phase >> (32 - SYNTH_TABLE_BITS);
+    int32_t frac = (int32_t)((phase >> (32 - SYNTH_TABLE_BITS - 15)) & 0x7FFF);
+    int32_t a = table[i];
+    int32_t b = table[i + 1];
+    return a + (((b - a) * frac) >> 15);
+}
+
+// A free voice, else the oldest releasing note, else the oldest note
+static int pickVoice() {
+    int best = -1;
+    for (int i = 0; i < SYNTH_VOICES; i++) {
+        SynthVoice &v = synthVoices[i];
+        if (v.stage == ENV_IDLE) return i;
+        if (best == -1) { best = i; continue; }
+        SynthVoice &b = synthVoices[best];
+        bool vRel = (v.stage == ENV_RELEASE);
+        bool bRel = (b.stage == ENV_RELEASE);
+        if (vRel != bRel) {
+            if (vRel) best = i;
+        } else if ((int32_t)(v.started - b.started) < 0) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void releaseVoice(SynthVoice &v) {
+    uint32_t r = v.releaseSamples ? v.releaseSamples : 1;
+    v.stage = ENV_RELEASE;
+    v.envLeft = r;
+    v.envStep = -v.env / (int32_t)r;
+}
+
+// Called when a stage has run its length
+static void nextStage(SynthVoice &v) {
+    switch (v.stage) {
+        case ENV_ATTACK:
+            v.env = SYNTH_ENV_FULL;
+            if (v.decaySamples) {
+                v.stage = ENV_DECAY;
+                v.envLeft = v.decaySamples;
+                v.envStep = (v.sustain - SYNTH_ENV_FULL) / (int32_t)v.decaySamples;
+                break;
+            }
+            // fall through
+        case ENV_DECAY:
+            v.env = v.sustain;
+            v.envStep = 0;
+            v.stage = (v.sustain > 0) ? ENV_SUSTAIN : ENV_IDLE; // Nothing left to release
+            break;
+        default:
+            v.env = 0;
+            v.stage = ENV_IDLE;
+            break;
+    }
+}
+
+static void triggerNote(const SynthSeq &q, const SynthStep &st) {
+    const SynthPatch &p = q.patches[st.patch];
+    SynthVoice &v = synthVoices[pickVoice()];
+
+    v.wave = (p.wave < SYNTH_WAVE_COUNT) ? p.wave : (uint8_t)SYNTH_WAVE_SINE;
+    v.mod = (p.mod < SYNTH_MOD_COUNT) ? p.mod : (uint8_t)SYNTH_MOD_NONE;
+    v.volume = st.volume;
+    v.phase = 0;
+    v.modPhase = 0;
+    v.inc = st.startInc;
+    v.endInc = st.endInc;
+    v.incStep = st.samples ? (int32_t)(((int64_t)st.endInc - (int64_t)st.startInc) / (int64_t)st.samples) : 0;
+    v.modRatio = ((uint32_t)p.modRatio << 16) / 100;
+    v.fmScale = (int64_t)p.modDepth * 6835653; // Index / 100, in 2^32-per-cycle phase (2^32 / 2pi / 100)
+    v.ringMix = (p.modDepth >= 100) ? 256 : (p.modDepth * 256) / 100;
+    v.sustain = (int32_t)(((int64_t)((p.sustain > 100) ? 100 : p.sustain) << 24) / 100);
+    v.decaySamples = msToSamples(p.decayMs);
+    v.releaseSamples = msToSamples(p.releaseMs);
+    v.gateLeft = st.samples ? st.samples : 1;
+    v.noise = 0x9E3779B9u ^ (triggerCount * 0x85EBCA6Bu);
+    v.noiseHold = 0;
+    v.started = ++triggerCount;
+
+    uint32_t a = msToSamples(p.attackMs);
+    if (a == 0) a = 1;
+    v.env = 0;
+    v.stage = ENV_ATTACK;
+    v.envLeft = a;
+    v.envStep = SYNTH_ENV_FULL / (int32_t)a;
+}
+
+// Adds `frames` of one voice to the accumulator (mono, centred)
+static void renderVoice(SynthVoice &v, int32_t* acc, int frames) {
+    const int16_t* table = (v.wave < SYNTH_WAVE_NOISE) ? tables[v.wave] : nullptr;
+    const int16_t* sine = tables[SYNTH_WAVE_SINE];
+    uint32_t modInc = (uint32_t)(((uint64_t)v.inc * v.modRatio) >> 16); // Follows the sweep per chunk
+
+    for (int f = 0; f < frames; f++) {
+        // Envelope
+        if (v.gateLeft && --v.gateLeft == 0 && v.stage < ENV_RELEASE) releaseVoice(v);
+        v.env += v.envStep;
+        if (v.stage != ENV_SUSTAIN && --v.envLeft == 0) {
+            nextStage(v);
+            if (v.stage == ENV_IDLE) return;
+        }
+
+        // Oscillator
+        int32_t m = 0;
+        uint32_t ph = v.phase;
+        if (v.mod != SYNTH_MOD_NONE) {
+            m = lookup(sine, v.modPhase);
+            v.modPhase += modInc;
+            if (v.mod == SYNTH_MOD_FM) ph += (uint32_t)((m * v.fmScale) >> 15);
+        }
+        int32_t w;
+        if (table) {
+            w = lookup(table, ph);
+        } else {
+            if (v.phase + v.inc < v.phase) {
+                // New noise value once per cycle: pitched noise
+                v.noise ^= v.noise << 13;
+                v.noise ^= v.noise >> 17;
+                v.noise ^= v.noise << 5;
+                v.noiseHold = (int16_t)(v.noise >> 16);
+            }
+            w = v.noiseHold;
+        }
+        if (v.mod == SYNTH_MOD_RING) w += ((((w * m) >> 15) - w) * v.ringMix) >> 8;
+        v.phase += v.inc;
+
+        // Sweep
+        if (v.incStep != 0) {
+            v.inc += v.incStep;
+            if (v.incStep > 0 && v.inc > v.endInc) v.inc = v.endInc;
+            if (v.incStep < 0 && v.inc < v.endInc) v.inc = v.endInc;
+        }
+
+        int32_t amp = ((v.env >> 9) * v.volume) >> 8; // Q15
+        int32_t s = (w * amp) >> 15;
+        acc[0] += s;
+        acc[1] += s;
+        acc += 2;
+    }
+}
+
+// ===================================
+// Render (Core 1)
+// ===================================
+// Slot filled in by synthPlay(): start it with the next block. -1 stops all
+// that have started; a slot whose start is still queued behind the stop is
+// left busy, so Core 0 can't refill it before it plays.
+void synthStartSequence(int slot) {
+    if (slot == -1) {
+        for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+            if (!seqs[i].playing) continue;
+            seqs[i].playing = false;
+            __atomic_store_n(&seqs[i].busy, false, __ATOMIC_RELEASE);
+        }
+        for (int v = 0; v < SYNTH_VOICES; v++) {
+            if (synthVoices[v].stage != ENV_IDLE && synthVoices[v].stage != ENV_RELEASE) releaseVoice(synthVoices[v]);
+        }
+        return;
+    }
+    if (slot < 0 || slot >= SYNTH_SEQUENCES) return;
+    SynthSeq &q = seqs[slot];
+    q.next = 0;
+    q.wait = 0;
+    q.playing = true;
+}
+
+// Adds one block of every sounding note to `acc`, splitting the block where
+// a sequence step is due. Returns false if nothing was playing.
+bool synthRenderBlock(int32_t* acc, int frames) {
+    bool any = false;
+    int pos = 0;
+    while (pos < frames) {
+        // Start the steps due now, run up to the next one
+        int chunk = frames - pos;
+        for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+            SynthSeq &q = seqs[i];
+            if (!q.playing) continue;
+            any = true;
+            while (q.wait == 0) {
+                if (q.next >= q.count) {
+                    q.playing = false;
+                    __atomic_store_n(&q.busy, false, __ATOMIC_RELEASE);
+                    break;
+                }
+                const SynthStep &st = q.steps[q.next++];
+                if (st.patch != SYNTH_STEP_REST) triggerNote(q, st);
+                q.wait = st.advance;
+            }
+            if (q.playing && q.wait < (uint32_t)chunk) chunk = (int)q.wait;
+        }
+
+        for (int v = 0; v < SYNTH_VOICES; v++) {
+            if (synthVoices[v].stage == ENV_IDLE) continue;
+            renderVoice(synthVoices[v], acc + pos * 2, chunk);
+            any = true;
+        }
+        for (int i = 0; i < SYNTH_SEQUENCES; i++) {
+            if (seqs[i].playing) seqs[i].wait -= chunk;
+        }
+        pos += chunk;
+    }
+    return any;
+}
@@ -0,0 +1,351 @@
+// Voice Feedback (Core 0)
+// Spoken prompts from /0_System are queued as a playlist and played on
+// VOICE_STREAM by serviceVoice() from loop(), so serial commands keep being
+// handled while the board talks. Clips with the same layout are appended to
+// the running stream as soon as the previous file has been read, putting
+// their PCM back to back in the ring (no gap, no fade-in). Pauses are pushed
+// into the ring as that many frames of silence. Boot code that has nothing
+// else to do calls waitForVoice() to play the queue out.
+#include "config.h"
+
+struct VoiceItem {
+    char name[24];    // Clip in /0_System, empty for a pause
+    uint16_t pauseMs;
+};
+
+static VoiceItem voiceQueue[VOICE_QUEUE_SIZE];
+static int queueHead = 0;  // Next item to play
+static int queueCount = 0;
+
+static bool running = false;       // Sequence in progress (g_allowAudio is ours to restore)
+static bool owning = false;        // VOICE_STREAM is playing our clips
+static bool restartPending = false;// Next clip can't be appended, waiting for the stream to drain
+static bool prevAllowAudio = false;
+static uint32_t holdStart = 0;     // Lead-in / pause while no stream is running
+static uint32_t holdMs = 0;
+static uint32_t pauseFrames = 0;   // Silence still to push into the running stream
+static char currentPath[64];
+
+static void queueItem(const char* name, uint16_t pauseMs) {
+    if (queueCount >= VOICE_QUEUE_SIZE) {
+        Serial.println("Voice: Queue full, prompt dropped");
+        return;
+    }
+    VoiceItem &it = voiceQueue[(queueHead + queueCount) % VOICE_QUEUE_SIZE];
+    it.name[0] = '\0';
+    if (name) strncpy(it.name, name, sizeof(it.name) - 1);
+    it.name[sizeof(it.name) - 1] = '\0';
+    it.pauseMs = pauseMs;
+    queueCount++;
+}
+
+static void popItem() {
+    queueHead = (queueHead + 1) % VOICE_QUEUE_SIZE;
+    queueCount--;
+}
+
+static void clipPath(char* out, size_t len, const char* name) {
+    snprintf(out, len, "/0_System/%s", name);
+}
+
+// Ends the sequence. Audio goes back to muted if it was when we started,
+// unless something else took the stream over.
+static void finishSequence(bool restoreAudio) {
+    running = false;
+    owning = false;
+    restartPending = false;
+    pauseFrames = 0;
+    if (restoreAudio) g_allowAudio = prevAllowAudio;
+}
+
+// Pushes as much of the pending pause as the ring has room for
+static void pushSilence(AudioStream* s) {
+    static const int16_t zeros[256] = {0};
+    while (pauseFrames > 0) {
+        int ch = s->channels;
+        uint32_t space = s->ringBuffer->availableForWrite() / ch;
+        uint32_t frames = sizeof(zeros) / sizeof(zeros[0]) / ch;
+        if (frames > pauseFrames) frames = pauseFrames;
+        if (frames > space) frames = space;
+        if (frames == 0) return;
+        pushPcm(s->ringBuffer, zeros, frames * ch, ch, ch);
+        pauseFrames -= frames;
+    }
+}
+
+// Starts the next clip on a stopped VOICE_STREAM. Missing clips are skipped
+// silently, a leading pause just waits.
+static void startNext() {
+    if ((uint32_t)(millis() - holdStart) < holdMs) return;
+    holdMs = 0;
+
+    while (queueCount > 0) {
+        VoiceItem it = voiceQueue[queueHead];
+        popItem();
+        if (it.name[0] == '\0') {
+            holdStart = millis();
+            holdMs = it.pauseMs;
+            return;
+        }
+
+        char path[64];
+        clipPath(path, sizeof(path), it.name);
+        sdIoBegin(SD_IO_FILE);
+        bool exists = sd.exists(path);
+        sdIoEnd();
+        if (exists && startStream(VOICE_STREAM, path)) {
+            claimStream(VOICE_STREAM, 0, STREAM_CLASS_VOCALS);
+            strncpy(currentPath, streams[VOICE_STREAM].filename, sizeof(currentPath) - 1);
+            currentPath[sizeof(currentPath) - 1] = '\0';
+            owning = true;
+            return;
+        }
+    }
+    finishSequence(true);
+}
+
+// ===================================
+// Service (Core 0, every loop)
+// ===================================
+void serviceVoice() {
+    if (!streams) return;
+
+    if (!running) {
+        if (queueCount == 0) return;
+        running = true;
+        prevAllowAudio = g_allowAudio;
+        holdStart = millis();
+        holdMs = 0;
+        if (!g_allowAudio) {
+            g_allowAudio = true;
+            holdMs = VOICE_LEAD_IN_MS; // Let I2S start before the first clip (prevents a pop)
+        }
+    }
+
+    if (!owning) {
+        startNext();
+        return;
+    }
+
+    AudioStream* s = &streams[VOICE_STREAM];
+    if (s->active && strcmp(s->filename, currentPath) != 0) {
+        // Another PLAY took the stream over: drop the rest of the prompt
+        queueCount = 0;
+        finishSequence(false);
+        return;
+    }
+    if (!s->active) {
+        // Drained for a clip with a different layout, or stopped (end of the
+        // sequence, or a STOP, which cancels what's left)
+        owning = false;
+        if (restartPending) {
+            restartPending = false;
+            startNext();
+        } else {
+            queueCount = 0;
+            finishSequence(true);
+        }
+        return;
+    }
+
+    if (!s->fileFinished || restartPending) return; // Still reading the current clip
+    if (pauseFrames > 0) {
+        pushSilence(s);
+        if (pauseFrames > 0) return;
+    }
+
+    while (queueCount > 0) {
+        VoiceItem &it = voiceQueue[queueHead];
+        if (it.name[0] == '\0') {
+            pauseFrames = (uint32_t)(((uint64_t)it.pauseMs * s->sampleRate) / 1000);
+            popItem();
+            pushSilence(s);
+            if (pauseFrames > 0) return;
+            continue;
+        }
+
+        char path[64];
+        clipPath(path, sizeof(path), it.name);
+        if (!appendStreamFile(VOICE_STREAM, path)) {
+            // Different format (or missing): let the ring play out, then start it fresh
+            restartPending = true;
+            return;
+        }
+        strncpy(currentPath, s->filename, sizeof(currentPath) - 1);
+        currentPath[sizeof(currentPath) - 1] = '\0';
+        popItem();
+        return;
+    }
+}
+
+// True while the playlist still needs VOICE_STREAM kept open once its
+// current file is read out (the auto-stop leaves it alone)
+bool voiceHoldsStream(int streamIdx) {
+    return streamIdx == VOICE_STREAM && owning && !restartPending && (queueCount > 0 || pauseFrames > 0);
+}
+
+bool voiceBusy() {
+    return running || queueCount > 0;
+}
+
+// Plays the queue out, pumping the audio tasks loop() would (boot only)
+void waitForVoice() {
+    while (voiceBusy()) {
+        serviceVoice();
+        fillStreamBuffers();
+        if (streams[VOICE_STREAM].stopRequested) {
+            stopStream(VOICE_STREAM, 0); // Drained
+            streams[VOICE_STREAM].stopRequested = false;
+        }
+        delay(1);
+    }
+}
+
+// ===================================
+// Queue Prompts
+// ===================================
+void playVoiceFeedback(const char* filename) {
+    queueItem(filename, 0);
+}
+
+void queueVoicePause(uint32_t ms) {
+    if (ms > 0) queueItem(nullptr, (uint16_t)(ms > 60000 ? 60000 : ms));
+}
+
+// Play a number file (0000.wav to 0099.wav)
+// For numbers >= 100, we could implement valid logic or just limit it.
+// Files are named 0000.wav ... 0100.wav based on the listing.
+void playVoiceNumber(int number) {
+    if (number < 0) return;
+    if (number > 100) number = 100; // Cap at 100 for now based on file list
+
+    char numFile[16];
+    snprintf(numFile, sizeof(numFile), "%04d.wav", number);
+    playVoiceFeedback(numFile);
+}
+
+void playBaudFeedback(long rate) {
+    playVoiceFeedback("setting.wav");
+    playVoiceFeedback("serial.wav");
+    playVoiceFeedback("baud_rate.wav");
+
+    // User Requested Logic:
+    // 2400 -> "24" "hundred"
+    // 115200 -> "11" "52" "hundred"
+
+    long hundreds = rate / 100;
+
+    if (hundreds > 100) {
+        // e.g. 1152 -> 11, 52
+        int p1 = hundreds / 100;
+        int p2 = hundreds % 100;
+        playVoiceNumber(p1);
+        playVoiceNumber(p2);
+    } else {
+        // e.g. 24 -> 24
+        playVoiceNumber((int)hundreds);
+    }
+
+    playVoiceFeedback("hundred.wav");
+
+    queueVoicePause(100);
+    // "Hz"
+    playVoiceFeedback("hz.wav");
+}
+
+void playBankNameFeedback(char page) {
+    // this spells out the folder name of the currently selected Bank 1 page
+    // 1. Find the directory: "1<Page>_*"
+    char pattern[4];
+    snprintf(pattern, sizeof(pattern), "1%c_", page);
+
+    char suffix[64] = "";
+    bool found = false;
+
+    sdIoBegin(SD_IO_SCAN);
+    FsFile root = sd.open("/");
+    if (root) {
+        FsFile file;
+        while(file.openNext(&root, O_RDONLY)) {
+            if(file.isDirectory()) {
+                 char name[64];
+                 file.getName(name, sizeof(name));
+                 if(strncasecmp(name, pattern, 3) == 0) {
+                     // Found it
+                     strncpy(suffix, name + 3, sizeof(suffix)-1);
+                     found = true;
+                     file.close(); // Close current
+                     break;
+                 }
+            }
+            file.close();
+            sdIoCheckpoint(SD_IO_SCAN);
+        }
+        root.close();
+    }
+    sdIoEnd();
+
+    if (!found || suffix[0] == '\0') return;
+
+    // 2. Spell it out
+    for(int i=0; suffix[i] != '\0'; i++) {
+        char c = suffix[i];
+        if (isdigit(c)) {
+            playVoiceNumber(c - '0');
+        } else if (isalpha(c)) {
+            char letterFile[16];
+            char lower = (c >= 'A' && c <= 'Z') ? (c + 32) : c;
+            snprintf(letterFile, sizeof(letterFile), "_%c.wav", lower);
+            playVoiceFeedback(letterFile);
+        }
+    }
+}
+
+// ===================================
+// Play Firmware Update Feedback
+// ===================================
+void playFirmwareUpdateFeedback(bool fwUpdated) {
+    if (!fwUpdated) {
+        Serial.println("  Firmware Feedback: Skipped (No update detected)");
+        return;
+    }
+
+    // Check for Voice Feedback Directory
+    bool hasVoiceFeedback = false;
+    sdIoBegin(SD_IO_FILE);
+    if (sd.exists("/0_System")) {
+        hasVoiceFeedback = true;
+    }
+    sdIoEnd();
+
+    if (hasVoiceFeedback) {
+        playVoiceFeedback("chirp.wav");
+        playVoiceFeedback("audio_engine.wav");
+        queueVoicePause(200);
+        playVoiceFeedback("firmware.wav");
+        playVoiceFeedback("updated.wav");
+        playVoiceFeedback("0002.wav");
+        playVoiceFeedback("new_version.wav");
+        queueVoicePause(200);
+
+        // Speak version stored in VERSION_STRING (e.g. 20251221)
+        // Skip first 2 digits ("20"), read pairs: "25", "12", "21"
+        if (strlen(VERSION_STRING) >= 8) {
+           // 25
+           int year = (VERSION_STRING[2] - '0') * 10 + (VERSION_STRING[3] - '0');
+           playVoiceNumber(year);
+           queueVoicePause(100);
+
+           // 12
+           int month = (VERSION_STRING[4] - '0') * 10 + (VERSION_STRING[5] - '0');
+           playVoiceNumber(month);
+           queueVoicePause(100);
+
+           // 21
+           int day = (VERSION_STRING[6] - '0') * 10 + (VERSION_STRING[7] - '0');
+           playVoiceNumber(day);
+           queueVoicePause(150);
+        }
+        waitForVoice(); // Boot: finish before the sync starts
+    }
+}
@@ -0,0 +1,278 @@
+// Warm cache for Bank 1 sounds (Core 0)
+// Keeps the WAV layout and the first WARM_CACHE_MS of PCM of Bank 1
+// variants in PSRAM. A PLAY that hits the cache pushes that PCM straight
+// into the stream's ring buffer and defers the file open to the first
+// refill, so the mixer can start the sound on its next block. IMA-ADPCM
+// variants in flash (#BANK1_ADPCM) are cached decoded, in whole blocks.
+#include "config.h"
+
+int warmCacheKB = DEFAULT_WARM_CACHE_KB;
+
+struct WarmEntry {
+    uint32_t key;        // pathHash() of the full playback path
+    bool headerKnown;    // Layout below is valid
+    uint8_t channels;
+    int16_t slot;        // PCM slot, -1 if not cached
+    uint32_t sampleRate;
+    uint32_t dataStart;
+    uint32_t dataSize;
+    uint16_t blockAlign; // IMA-ADPCM, 0 for PCM
+    uint16_t samplesPerBlock;
+    uint32_t frames;
+};
+
+struct WarmSlot {
+    int entry;           // Owning entry, -1 if free
+    uint32_t bytes;      // Valid PCM bytes
+    uint32_t lastUsed;   // LRU stamp
+};
+
+static WarmEntry* entries = nullptr;
+static int entryCount = 0;
+static WarmSlot* slots = nullptr;
+static uint8_t* slotData = nullptr;
+static int slotCount = 0;
+static uint32_t useClock = 0;
+static int pendingEntry = -1; // Entry waiting for its PCM to be loaded
+
+// Bytes per slot: WARM_CACHE_MS of 44.1kHz stereo (longer for mono / lower rates)
+static const uint32_t slotBytes = (WARM_CACHE_MS * SAMPLE_RATE / 1000) * 4;
+
+static int findEntry(const char* path) {
+    if (!entries) return -1;
+    uint32_t h = pathHash(path);
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].key == h) return i;
+    }
+    return -1;
+}
+
+// ===================================
+// Load PCM Into a Slot
+// ===================================
+// Opens the file, walks the WAV header if the entry doesn't know its layout
+// yet, and reads the first slotBytes of PCM. Takes the file's mutex.
+template <typename F>
+static bool loadFromFile(F &f, WarmEntry &e, uint8_t* dst, uint32_t &got, bool allowAdpcm) {
+    if (!e.headerKnown) {
+        WavLayout layout;
+        if (!readWavLayout(f, layout, allowAdpcm)) return false;
+        e.channels = layout.channels;
+        e.sampleRate = layout.sampleRate;
+        e.dataStart = layout.dataStart;
+        e.dataSize = layout.dataSize;
+        e.blockAlign = layout.blockAlign;
+        e.samplesPerBlock = layout.samplesPerBlock;
+        e.frames = layout.frames;
+        e.headerKnown = true;
+    }
+
+    uint32_t block = e.channels * 2;
+    if (e.blockAlign) {
+        // As many whole blocks as fit, so the stream resumes on a block boundary
+        WavLayout l;
+        l.channels = e.channels;
+        l.blockAlign = e.blockAlign;
+        l.samplesPerBlock = e.samplesPerBlock;
+        l.frames = e.frames;
+        uint32_t frames = (slotBytes / block / e.samplesPerBlock) * e.samplesPerBlock;
+        f.seek(e.dataStart);
+        got = adpcmReadFrames(f, l, (int16_t*)dst, frames) * block;
+        return got > 0;
+    }
+    uint32_t want = (e.dataSize < slotBytes) ? e.dataSize : slotBytes;
+    want -= want % block;
+    f.seek(e.dataStart);
+    int n = f.read(dst, want);
+    if (n <= 0) return false;
+    got = n - (n % block);
+    return got > 0;
+}
+
+static bool loadSlot(int entryIdx, int slotIdx, const char* path) {
+    WarmEntry &e = entries[entryIdx];
+    uint8_t* dst = slotData + (size_t)slotIdx * slotBytes;
+    uint32_t got = 0;
+    bool ok = false;
+
+    if (strncmp(path, "/flash/", 7) == 0) {
+        mutex_enter_blocking(&flash_mutex);
+        File f = LittleFS.open(path, "r");
+        if (f) {
+            ok = loadFromFile(f, e, dst, got, true);
+            f.close();
+        }
+        mutex_exit(&flash_mutex);
+    } else {
+        if (g_mscActive) return false;
+        sdIoBegin(SD_IO_FILE);
+        FsFile f = sd.open(path, FILE_READ);
+        if (f) {
+            ok = loadFromFile(f, e, dst, got, false);
+            f.close();
+        }
+        sdIoEnd();
+    }
+    if (!ok) return false;
+
+    // Evict the previous owner
+    if (slots[slotIdx].entry >= 0) entries[slots[slotIdx].entry].slot = -1;
+    slots[slotIdx].entry = entryIdx;
+    slots[slotIdx].bytes = got;
+    slots[slotIdx].lastUsed = ++useClock;
+    e.slot = slotIdx;
+    return true;
+}
+
+// Free slot if any, else the least recently used one
+static int pickSlot() {
+    int best = 0;
+    for (int i = 0; i < slotCount; i++) {
+        if (slots[i].entry < 0) return i;
+        if (slots[i].lastUsed < slots[best].lastUsed) best = i;
+    }
+    return best;
+}
+
+// ===================================
+// Init (Core 0, after Bank 1 is scanned/synced)
+// ===================================
+// One entry per Bank 1 variant. Slots are filled in Bank 1 order until the
+// budget (#WARM_CACHE_KB) runs out; after that the most recently played
+// sounds take over slots (LRU) as they are triggered.
+void initWarmCache() {
+    entryCount = 0;
+    for (int i = 0; i < bank1SoundCount; i++) entryCount += bank1Sounds[i].variantCount;
+
+    slotCount = (warmCacheKB * 1024) / slotBytes;
+    if (entryCount == 0 || slotCount == 0) {
+        Serial.println("Warm Cache: Disabled");
+        return;
+    }
+    if (slotCount > entryCount) slotCount = entryCount;
+
+    // Allocate once (Bank 1 is fixed until reboot)
+    if (!entries) {
+        entries = (WarmEntry*)pmalloc(entryCount * sizeof(WarmEntry));
+        slots = (WarmSlot*)pmalloc(slotCount * sizeof(WarmSlot));
+        slotData = (uint8_t*)pmalloc((size_t)slotCount * slotBytes);
+        if (!entries || !slots || !slotData) {
+            Serial.println("Warm Cache: ERROR - PSRAM allocation failed, disabled");
+            entries = nullptr;
+            entryCount = 0;
+            slotCount = 0;
+            return;
+        }
+    }
+
+    char path[128];
+    int e = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        for (int v = 0; v < bank1Sounds[i].variantCount; v++, e++) {
+            bank1PlayPath(path, sizeof(path), bank1Sounds[i], v);
+            entries[e].key = pathHash(path);
+            entries[e].headerKnown = false;
+            entries[e].slot = -1;
+        }
+    }
+    for (int i = 0; i < slotCount; i++) {
+        slots[i].entry = -1;
+        slots[i].bytes = 0;
+        slots[i].lastUsed = 0;
+    }
+
+    // Prefill
+    uint32_t t0 = millis();
+    int loaded = 0;
+    e = 0;
+    for (int i = 0; i < bank1SoundCount && loaded < slotCount; i++) {
+        for (int v = 0; v < bank1Sounds[i].variantCount && loaded < slotCount; v++, e++) {
+            bank1PlayPath(path, sizeof(path), bank1Sounds[i], v);
+            if (loadSlot(e, loaded, path)) loaded++;
+        }
+    }
+    Serial.printf("Warm Cache: %d/%d variants cached (%d KB, %lu ms)\n",
+                  loaded, entryCount, (int)((slotCount * slotBytes) / 1024), millis() - t0);
+}
+
+// ===================================
+// Lookup (Core 0, from startStream)
+// ===================================
+// True if the path is a Bank 1 variant whose WAV layout is known. `pcm` is
+// null if its PCM isn't cached right now; the load is then queued for
+// serviceWarmCache(). The PCM pointer stays valid until the next service.
+bool warmCacheLookup(const char* path, WarmCacheHit &hit) {
+    int idx = findEntry(path);
+    if (idx < 0) return false;
+    WarmEntry &e = entries[idx];
+    if (!e.headerKnown) {
+        pendingEntry = idx;
+        return false;
+    }
+
+    hit.channels = e.channels;
+    hit.sampleRate = e.sampleRate;
+    hit.dataStart = e.dataStart;
+    hit.dataSize = e.dataSize;
+    hit.blockAlign = e.blockAlign;
+    hit.samplesPerBlock = e.samplesPerBlock;
+    hit.frames = e.frames;
+    hit.pcm = nullptr;
+    hit.pcmBytes = 0;
+
+    if (e.slot >= 0) {
+        hit.pcm = (const int16_t*)(slotData + (size_t)e.slot * slotBytes);
+        hit.pcmBytes = slots[e.slot].bytes;
+        slots[e.slot].lastUsed = ++useClock;
+    } else {
+        pendingEntry = idx;
+    }
+    return true;
+}
+
+// ===================================
+// Rekey (Core 0, from the flash sync)
+// ===================================
+// Variant `idx` plays from `path` now (its flash copy, or the card again).
+// A plain copy is the same bytes, so the entry carries over; an IMA-ADPCM
+// copy has another layout, so the entry starts over and refills from there.
+void warmCacheRekey(int idx, const char* path) {
+    if (!entries || idx < 0 || idx >= entryCount) return;
+    WarmEntry &e = entries[idx];
+    e.key = pathHash(path);
+    if (!bank1Adpcm) return;
+
+    e.headerKnown = false;
+    if (e.slot >= 0) {
+        slots[e.slot].entry = -1;
+        slots[e.slot].bytes = 0;
+        slots[e.slot].lastUsed = 0;
+        e.slot = -1;
+        if (pendingEntry < 0) pendingEntry = idx;
+    }
+}
+
+// ===================================
+// Service (Core 0, main loop)
+// ===================================
+// Loads the PCM of the last variant that missed, evicting the LRU slot.
+// Skipped while any stream is close to running dry.
+void serviceWarmCache() {
+    if (pendingEntry < 0 || !entries || isCpuBusy()) return;
+    int idx = pendingEntry;
+    pendingEntry = -1;
+    if (entries[idx].slot >= 0) return;
+
+    // Recover the path from Bank 1 (entries are in variant order)
+    char path[128] = "";
+    int e = 0;
+    for (int i = 0; i < bank1SoundCount; i++) {
+        if (idx < e + bank1Sounds[i].variantCount) {
+            bank1PlayPath(path, sizeof(path), bank1Sounds[i], idx - e);
+            break;
+        }
+        e += bank1Sounds[i].variantCount;
+    }
+    // Evicting is safe: a hit copies the PCM into the stream's ring right away
+    loadSlot(idx, pickSlot(), path);
+}
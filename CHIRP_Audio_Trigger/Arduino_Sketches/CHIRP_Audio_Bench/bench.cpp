@@ -0,0 +1,253 @@
+// CHIRP Audio Host Benchmark
+// Times the Core 1 mixer (upmix + resampler + effects + synth), the Core 0 PCM ring input and
+// M4A frame extraction on a desktop, built from the unmodified CHIRP_Audio
+// sources against the shims in host/. Numbers are for comparing changes to
+// those paths against each other, not a prediction of RP2350 timings.
+// The sources linked below must keep working without the device (no SD,
+// flash, I2S or USB calls); anything else they need is stubbed here.
+//
+// Build (from this folder, one command line):
+//   g++ -std=gnu++17 -O2 -Ihost -I../CHIRP_Audio -o chirp_bench bench.cpp
+//       ../CHIRP_Audio/mixer.cpp ../CHIRP_Audio/effects.cpp ../CHIRP_Audio/synth.cpp
+//       ../CHIRP_Audio/resampler.cpp ../CHIRP_Audio/mp4_parser.cpp
+//
+// Run:
+//   ./chirp_bench [file.m4a ...]
+#include "config.h"
+
+// ===================================
+// Globals the linked sources expect
+// ===================================
+SdFat sd;
+AudioStream* streams = nullptr;
+int maxStreams = 0;
+int streamBufferSize = 0;
+int streamBufferMask = 0;
+volatile int16_t masterAttenMultiplier = (97 * 256) / 100;
+
+#if PERF_ENABLE
+void perfUnderrun(int) {}
+void perfFxStage(int, uint32_t) {}
+void perfResetMixer() {}
+#endif
+
+// ===================================
+// Bench Configuration
+// ===================================
+#define BENCH_MAX_STREAMS 8
+#define BENCH_RING_SAMPLES 8192        // Per stream ring, a power of two
+#define BENCH_MIX_FRAMES (SAMPLE_RATE * 20) // Output frames timed per mixer case
+#define BENCH_PUSH_SAMPLES (4 * 1024 * 1024)
+#define BENCH_PUSH_CHUNK 1024          // Samples per pushPcm() call
+#define BENCH_M4A_PASSES 5
+
+static RingBuffer rings[BENCH_MAX_STREAMS];
+static int16_t noise[BENCH_RING_SAMPLES];
+static volatile uint32_t sink; // Keeps the optimiser from dropping the work
+
+static inline uint64_t nowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void fillNoise() {
+    uint32_t x = 0x12345678;
+    for (int i = 0; i < BENCH_RING_SAMPLES; i++) {
+        x = x * 1664525u + 1013904223u;
+        noise[i] = (int16_t)(x >> 16) / 4; // -12dB so sums of streams still hit the limiter sometimes
+    }
+}
+
+// Tops a ring up with noise, a whole number of frames
+static void topUp(RingBuffer* rb, int ch) {
+    int space = rb->availableForWrite();
+    space -= space % ch;
+    if (space > 0) pushPcm(rb, noise, space, ch, ch);
+}
+
+// ===================================
+// Mixer (Core 1 path)
+// ===================================
+// ns per output frame for `n` active streams of the given layout and rate.
+// Refilling the rings between blocks is not part of the timing.
+static void benchMixer(int n, int ch, uint32_t rate, ResamplerQuality quality, const char* label = nullptr) {
+    resamplerQuality = quality;
+    for (int i = 0; i < n; i++) {
+        AudioStream* s = &streams[i];
+        s->type = STREAM_TYPE_WAV_FLASH;
+        s->volume = 1.0f;
+        s->ringBuffer = &rings[i];
+        s->ringBuffer->clear();
+        s->channels = ch;
+        s->sampleRate = rate;
+        s->fileFinished = false;
+        s->playedFrames = 0;
+        resamplerReset(&s->resampler);
+        mixerStart(i, 1.0f, 0); // No fade-in, applied by the first block
+    }
+
+    static uint32_t out[MIXER_BLOCK_FRAMES];
+    uint64_t busyNs = 0;
+    int blocks = BENCH_MIX_FRAMES / MIXER_BLOCK_FRAMES;
+    for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < n; i++) topUp(streams[i].ringBuffer, ch);
+        uint64_t t0 = nowNs();
+        Mixer::processBlock(out, MIXER_BLOCK_FRAMES);
+        busyNs += nowNs() - t0;
+        sink += out[b & (MIXER_BLOCK_FRAMES - 1)];
+    }
+    for (int i = 0; i < n; i++) mixerStop(i);
+    Mixer::applyCommands();
+
+    double perFrame = (double)busyNs / ((double)blocks * MIXER_BLOCK_FRAMES);
+    if (!label) label = (rate == SAMPLE_RATE) ? "native" : (quality == RESAMPLER_POLYPHASE ? "polyphase" : "linear");
+    printf("MIX  streams=%d %-6s %5lu Hz %-9s %8.2f ns/frame %8.2f ns/frame/stream\n",
+           n, ch == 2 ? "stereo" : "mono", (unsigned long)rate, label, perFrame, perFrame / n);
+}
+
+// ===================================
+// Effects (Core 1 path)
+// ===================================
+// The 3-stream stereo native mix with one effects stage switched on, to
+// compare against the plain "native" line above it.
+static void benchEffects() {
+    const int n = 3;
+    for (int i = 0; i < n; i++) mixerSetFx(i, FX_FILTER_RADIO, 65536);
+    benchMixer(n, 2, SAMPLE_RATE, RESAMPLER_LINEAR, "biquad");
+    for (int i = 0; i < n; i++) mixerSetFx(i, FX_FILTER_NONE, 78643); // 120%
+    benchMixer(n, 2, SAMPLE_RATE, RESAMPLER_LINEAR, "pitch");
+    for (int i = 0; i < n; i++) mixerSetFx(i, FX_FILTER_NONE, 65536);
+    limiterEnabled = true;
+    benchMixer(n, 2, SAMPLE_RATE, RESAMPLER_LINEAR, "limiter");
+    limiterEnabled = false;
+    Mixer::applyCommands();
+}
+
+// ===================================
+// Synth (Core 1 path)
+// ===================================
+// ns per output frame with every synth voice sounding one patch (a chord
+// held for longer than the timing runs), no streams.
+static void benchSynth(int patch) {
+    SynthStep steps[SYNTH_VOICES];
+    for (int v = 0; v < SYNTH_VOICES; v++) {
+        steps[v] = synthStep(patch, 300 + v * 250, 2000 + v * 400, 60000, 64);
+        steps[v].advance = 0;
+    }
+    synthPlay(steps, SYNTH_VOICES);
+
+    static uint32_t out[MIXER_BLOCK_FRAMES];
+    uint64_t busyNs = 0;
+    int blocks = BENCH_MIX_FRAMES / MIXER_BLOCK_FRAMES;
+    for (int b = 0; b < blocks; b++) {
+        uint64_t t0 = nowNs();
+        Mixer::processBlock(out, MIXER_BLOCK_FRAMES);
+        busyNs += nowNs() - t0;
+        sink += out[b & (MIXER_BLOCK_FRAMES - 1)];
+    }
+
+    const SynthPatch &p = synthPatches[patch];
+    static const char* const waves[SYNTH_WAVE_COUNT] = { "sine", "triangle", "square", "saw", "noise" };
+    static const char* const mods[SYNTH_MOD_COUNT] = { "", "+fm", "+ring" };
+    char label[24];
+    snprintf(label, sizeof(label), "%s%s", waves[p.wave], mods[p.mod]);
+    double perFrame = (double)busyNs / ((double)blocks * MIXER_BLOCK_FRAMES);
+    printf("SYNTH voices=%d patch=%d %-13s %8.2f ns/frame %8.2f ns/frame/voice\n", SYNTH_VOICES, patch,
+           label, perFrame, perFrame / SYNTH_VOICES);
+
+    synthStop();
+    for (int b = 0; b * MIXER_BLOCK_FRAMES < SAMPLE_RATE / 5; b++) Mixer::processBlock(out, MIXER_BLOCK_FRAMES); // Release tails
+}
+
+// ===================================
+// PCM Ring Input (Core 0 path)
+// ===================================
+// ns per input sample through pushPcm(), which the WAV refill and both
+// decoder callbacks use to land PCM in a stream's ring.
+static void benchPush(int srcCh, int dstCh) {
+    RingBuffer* rb = &rings[0];
+    rb->clear();
+    uint64_t busyNs = 0;
+    uint64_t total = 0;
+    for (int done = 0; done < BENCH_PUSH_SAMPLES; done += BENCH_PUSH_CHUNK) {
+        uint64_t t0 = nowNs();
+        total += pushPcm(rb, noise, BENCH_PUSH_CHUNK, srcCh, dstCh);
+        busyNs += nowNs() - t0;
+        rb->commitRead(rb->availableForRead()); // Drain, as the mixer would
+    }
+    printf("PUSH %-6s -> %-6s %8.2f ns/sample\n", srcCh == 2 ? "stereo" : "mono",
+           dstCh == 2 ? "stereo" : "mono", (double)busyNs / (double)total);
+}
+
+// ===================================
+// M4A Frame Extraction
+// ===================================
+// Reads every access unit of the file BENCH_M4A_PASSES times through
+// MP4Parser::readNextFrame(), with the same buffer size as the refill path.
+static void benchM4a(const char* path) {
+    static MP4Parser parser; // Sample table windows are allocated once, as on a stream
+    static uint8_t frame[2048];
+    uint64_t busyNs = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+
+    for (int pass = 0; pass < BENCH_M4A_PASSES; pass++) {
+        uint64_t t0 = nowNs();
+        if (!parser.open(path, false)) {
+            printf("M4A  %s: failed to open/parse\n", path);
+            return;
+        }
+        size_t n;
+        while ((n = parser.readNextFrame(frame, sizeof(frame))) > 0) {
+            frames++;
+            bytes += n;
+            sink += frame[0];
+        }
+        parser.close();
+        busyNs += nowNs() - t0;
+    }
+    if (frames == 0) {
+        printf("M4A  %s: no frames\n", path);
+        return;
+    }
+    printf("M4A  %s: %llu frames/pass, %8.2f ns/frame, %7.2f MB/s (open + parse included)\n", path,
+           (unsigned long long)(frames / BENCH_M4A_PASSES), (double)busyNs / (double)frames,
+           (double)bytes * 1000.0 / (double)busyNs);
+}
+
+int main(int argc, char** argv) {
+    streamBufferSize = BENCH_RING_SAMPLES;
+    streamBufferMask = BENCH_RING_SAMPLES - 1;
+    maxStreams = BENCH_MAX_STREAMS;
+    streams = new AudioStream[BENCH_MAX_STREAMS]();
+    initMixer();
+    for (int i = 0; i < BENCH_MAX_STREAMS; i++) {
+        rings[i].buffer = (int16_t*)pmalloc(BENCH_RING_SAMPLES * sizeof(int16_t));
+        rings[i].clear();
+    }
+    fillNoise();
+    initResampler();
+
+    printf("CHIRP Audio bench: SAMPLE_RATE %d, MIXER_BLOCK_FRAMES %d\n", SAMPLE_RATE, MIXER_BLOCK_FRAMES);
+
+    const int counts[] = { 1, 2, 3, 4, 8 };
+    for (int n : counts) {
+        for (int ch = 1; ch <= 2; ch++) {
+            benchMixer(n, ch, SAMPLE_RATE, RESAMPLER_LINEAR);
+            benchMixer(n, ch, 22050, RESAMPLER_LINEAR);
+            benchMixer(n, ch, 22050, RESAMPLER_POLYPHASE);
+        }
+    }
+
+    benchMixer(3, 2, SAMPLE_RATE, RESAMPLER_LINEAR);
+    benchEffects();
+    for (int p = 0; p < SYNTH_PATCHES - 1; p++) benchSynth(p); // 7 (ping) decays to silence
+
+    benchPush(1, 1);
+    benchPush(2, 2);
+    benchPush(1, 2);
+    benchPush(2, 1);
+
+    for (int i = 1; i < argc; i++) benchM4a(argv[i]);
+    return 0;
+}
@@ -0,0 +1,12 @@
+// Host shim for arduino-libhelix: the types config.h names, no decoder
+#pragma once
+#include <Arduino.h>
+
+struct AACFrameInfo { int bitRate; int nChans; int sampRateCore; int sampRateOut; int bitsPerSample; int outputSamps; int profile; int tnsUsed; int pnsUsed; };
+
+namespace libhelix {
+class AACDecoderHelix {
+public:
+    size_t write(const void*, size_t len) { return len; }
+};
+}
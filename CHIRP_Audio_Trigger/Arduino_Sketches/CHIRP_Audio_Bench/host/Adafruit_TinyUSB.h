@@ -0,0 +1,4 @@
+// Host shim for Adafruit TinyUSB (MSC is not part of the bench)
+#pragma once
+
+class Adafruit_USBD_MSC {};
@@ -0,0 +1,64 @@
+// Host shim for the Arduino core: just enough of Print/Stream/String, the
+// timing calls and the PSRAM allocator for the CHIRP_Audio sources that the
+// bench links (mixer.cpp, resampler.cpp, mp4_parser.cpp).
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+
+inline uint64_t hostMicros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - t0).count();
+}
+inline unsigned long millis() { return (unsigned long)(hostMicros() / 1000); }
+inline unsigned long micros() { return (unsigned long)hostMicros(); }
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+
+// PSRAM is never freed on the board, the bench does the same
+inline void* pmalloc(size_t size) { return malloc(size); }
+
+class String {
+public:
+    String(const char* c = "") : s(c ? c : "") {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return (unsigned)s.size(); }
+    friend String operator+(const String& a, const String& b) { return String((a.s + b.s).c_str()); }
+private:
+    std::string s;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t* p, size_t n) { return fwrite(p, 1, n, stdout); }
+    size_t printf(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        return n < 0 ? 0 : (size_t)n;
+    }
+    size_t print(const char* s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+    size_t println(const String& s) { return println(s.c_str()); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+class HardwareSerial : public Stream {};
+inline HardwareSerial Serial;
@@ -0,0 +1,8 @@
+// Host shim for the I2S library (the bench never touches the output)
+#pragma once
+#include <Arduino.h>
+
+class I2S : public Print {
+public:
+    I2S(int, int, int, int) {}
+};
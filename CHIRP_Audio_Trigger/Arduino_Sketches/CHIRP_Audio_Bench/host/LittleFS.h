@@ -0,0 +1,30 @@
+// Host shim for LittleFS: File reads a local file through stdio
+#pragma once
+#include <SdFat.h>
+
+class File : public Stream {
+public:
+    explicit operator bool() const { return (bool)f; }
+    int read(uint8_t* buf, size_t len) { return f.read(buf, len); }
+    int read() override { return f.read(); }
+    bool seek(uint32_t pos) { return f.seek(pos); }
+    size_t position() const { return (size_t)f.position(); }
+    size_t size() const { return (size_t)f.size(); }
+    int available() override { return f.available(); }
+    void close() { f.close(); }
+
+    static File openPath(const char* path) {
+        File r;
+        r.f = FsFile::openPath(path);
+        return r;
+    }
+
+private:
+    FsFile f;
+};
+
+class LittleFSFS {
+public:
+    File open(const char* path, const char*) { return File::openPath(path); }
+};
+inline LittleFSFS LittleFS;
@@ -0,0 +1,12 @@
+// Host shim for arduino-libhelix: the types config.h names, no decoder
+#pragma once
+#include <Arduino.h>
+
+struct MP3FrameInfo { int bitrate; int nChans; int samprate; int bitsPerSample; int outputSamps; int layer; int version; };
+
+namespace libhelix {
+class MP3DecoderHelix {
+public:
+    size_t write(const void*, size_t len) { return len; }
+};
+}
@@ -0,0 +1,40 @@
+// Host shim for SdFat: FsFile reads a local file through stdio
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ 0
+
+class FsFile : public Stream {
+public:
+    explicit operator bool() const { return (bool)fp; }
+    int read(void* buf, size_t len) { return fp ? (int)fread(buf, 1, len, fp.get()) : -1; }
+    int read() override { uint8_t b; return read(&b, 1) == 1 ? b : -1; }
+    bool seek(uint64_t pos) { return fp && fseek(fp.get(), (long)pos, SEEK_SET) == 0; }
+    uint64_t position() const { return fp ? (uint64_t)ftell(fp.get()) : 0; }
+    uint64_t size() const {
+        if (!fp) return 0;
+        long here = ftell(fp.get());
+        fseek(fp.get(), 0, SEEK_END);
+        long end = ftell(fp.get());
+        fseek(fp.get(), here, SEEK_SET);
+        return (uint64_t)end;
+    }
+    uint64_t fileSize() const { return size(); }
+    int available() override { return (int)(size() - position()); }
+    void close() { fp.reset(); }
+
+    static FsFile openPath(const char* path) {
+        FsFile f;
+        if (FILE* h = fopen(path, "rb")) f.fp.reset(h, fclose);
+        return f;
+    }
+
+private:
+    std::shared_ptr<FILE> fp;
+};
+
+class SdFat {
+public:
+    FsFile open(const char* path, int = FILE_READ) { return FsFile::openPath(path); }
+};
@@ -0,0 +1,7 @@
+// Host shim for pico/mutex.h (the bench is single threaded)
+#pragma once
+
+typedef struct { int unused; } mutex_t;
+inline void mutex_init(mutex_t*) {}
+inline void mutex_enter_blocking(mutex_t*) {}
+inline void mutex_exit(mutex_t*) {}